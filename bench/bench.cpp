@@ -0,0 +1,356 @@
+// Renders a fixed corpus of locations at several sizes and iteration limits
+// on every headless engine, and the deep locations with each perturbation
+// engine, and writes the timings as JSON.
+//
+// Usage: mandelbrot-bench [--sizes 320x240,960x720] [--max-iterations 256,2048]
+//                         [--deep-sizes 320x240] [--repeats 3]
+//                         [--engines cpu-1t,cpu-mt,pert-rebase,...]
+//                         [--locations default_view,...] [--output file.json]
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+#include "config.hpp"
+#include "engines.hpp"
+#include "reference_locations.hpp"
+
+namespace chrono = std::chrono;
+
+using std::string;
+
+struct Size {
+  int w;
+  int h;
+};
+
+struct Options {
+  std::vector<Size> sizes = { { 320, 240 }, { 960, 720 } };
+  std::vector<int> maxIterations = { 256, 2048 };
+  // Deep locations have their own iteration limits
+  std::vector<Size> deepSizes = { { 320, 240 } };
+  int repeats = 3;
+  std::vector<string> engines;
+  std::vector<string> locations;
+  string outputPath;
+};
+
+struct Result {
+  string engine;
+  string location;
+  Size size;
+  int maxIterations;
+  double bestSeconds;
+  double medianSeconds;
+  unsigned long long iterations;
+  // Reference orbits per frame, for the perturbation engine
+  int references = 0;
+};
+
+static std::vector<string> split(const string& str, char delim) {
+  std::vector<string> parts;
+  std::stringstream ss(str);
+  string part;
+
+  while (std::getline(ss, part, delim)) {
+    if (!part.empty()) {
+      parts.push_back(part);
+    }
+  }
+
+  return parts;
+}
+
+static bool contains(const std::vector<string>& v, const string& s) {
+  return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+static void usage() {
+  std::cerr << "Usage: mandelbrot-bench [--sizes WxH,...] "
+               "[--max-iterations N,...] [--deep-sizes WxH,...] "
+               "[--repeats N] [--engines NAME,...] "
+               "[--locations NAME,...] [--output FILE]" << std::endl;
+}
+
+static bool parseSizes(const string& value, std::vector<Size>& sizes) {
+  sizes.clear();
+  for (const string& s : split(value, ',')) {
+    auto dims = split(s, 'x');
+    if (dims.size() != 2) {
+      return false;
+    }
+    sizes.push_back(Size{ std::stoi(dims[0]), std::stoi(dims[1]) });
+  }
+
+  return true;
+}
+
+static bool parseArgs(int argc, char** argv, Options& opts) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    string value = argv[++i];
+
+    if (arg == "--sizes") {
+      if (!parseSizes(value, opts.sizes)) {
+        return false;
+      }
+    }
+    else if (arg == "--deep-sizes") {
+      if (!parseSizes(value, opts.deepSizes)) {
+        return false;
+      }
+    }
+    else if (arg == "--max-iterations") {
+      opts.maxIterations.clear();
+      for (const string& s : split(value, ',')) {
+        opts.maxIterations.push_back(std::stoi(s));
+      }
+    }
+    else if (arg == "--repeats") {
+      opts.repeats = std::max(1, std::stoi(value));
+    }
+    else if (arg == "--engines") {
+      opts.engines = split(value, ',');
+    }
+    else if (arg == "--locations") {
+      opts.locations = split(value, ',');
+    }
+    else if (arg == "--output") {
+      opts.outputPath = value;
+    }
+    else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Peak resident set size of the whole process so far, in KB. It only ever
+// grows, so it's reported once for the whole run rather than per result.
+static long peakRssKb() {
+#ifdef WIN32
+  return 0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static unsigned long long countIterations(const IterationData& data) {
+  unsigned long long n = 0;
+  for (const PixelResult& px : data.pixels) {
+    n += static_cast<unsigned long long>(px.i);
+  }
+  return n;
+}
+
+static Result runBenchmark(const Engine& engine, const ReferenceLocation& loc,
+                           const Size& size, int maxIterations, int repeats) {
+  IterationParams params = referenceParams(loc, size.w, size.h, maxIterations);
+  IterationData data(size.w, size.h);
+
+  // Untimed warm-up, so thread start-up and first-touch page faults aren't
+  // counted
+  engine.render(params, data);
+
+  std::vector<double> times;
+  for (int i = 0; i < repeats; ++i) {
+    auto t0 = chrono::steady_clock::now();
+    engine.render(params, data);
+    chrono::duration<double> span = chrono::steady_clock::now() - t0;
+
+    times.push_back(span.count());
+  }
+
+  std::sort(times.begin(), times.end());
+
+  Result result;
+  result.engine = engine.name;
+  result.location = loc.name;
+  result.size = size;
+  result.maxIterations = maxIterations;
+  result.bestSeconds = times.front();
+  result.medianSeconds = times[times.size() / 2];
+  result.iterations = countIterations(data);
+
+  return result;
+}
+
+static Result runDeepBenchmark(const DeepEngine& engine,
+                               const DeepLocation& loc, const Size& size,
+                               int repeats) {
+  PerturbationParams params = deepParams(loc, size.w, size.h);
+  IterationData data(size.w, size.h);
+
+  engine.render(params, data);
+
+  std::vector<double> times;
+  PerturbationEngine::Stats stats;
+  for (int i = 0; i < repeats; ++i) {
+    auto t0 = chrono::steady_clock::now();
+    stats = engine.render(params, data);
+    chrono::duration<double> span = chrono::steady_clock::now() - t0;
+
+    times.push_back(span.count());
+  }
+
+  std::sort(times.begin(), times.end());
+
+  Result result;
+  result.engine = engine.name;
+  result.location = loc.name;
+  result.size = size;
+  result.maxIterations = loc.maxIterations;
+  result.bestSeconds = times.front();
+  result.medianSeconds = times[times.size() / 2];
+  result.iterations = countIterations(data);
+  result.references = stats.references;
+
+  return result;
+}
+
+static void writeJson(std::ostream& os, const Options& opts,
+                      const std::vector<string>& engineNames,
+                      const std::vector<Result>& results) {
+  os << std::setprecision(6);
+
+  os << "{\n";
+  os << "  \"version\": \"" << Mandelbrot_VERSION_MAJOR << "."
+     << Mandelbrot_VERSION_MINOR << "\",\n";
+  os << "  \"hardware_threads\": " << std::thread::hardware_concurrency()
+     << ",\n";
+  os << "  \"repeats\": " << opts.repeats << ",\n";
+  os << "  \"peak_rss_kb\": " << peakRssKb() << ",\n";
+
+  os << "  \"engines\": [";
+  for (size_t i = 0; i < engineNames.size(); ++i) {
+    os << (i > 0 ? ", " : "") << "\"" << engineNames[i] << "\"";
+  }
+  os << "],\n";
+
+  os << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    double pixels = static_cast<double>(r.size.w) * r.size.h;
+
+    os << "    {"
+       << "\"engine\": \"" << r.engine << "\", "
+       << "\"location\": \"" << r.location << "\", "
+       << "\"width\": " << r.size.w << ", "
+       << "\"height\": " << r.size.h << ", "
+       << "\"max_iterations\": " << r.maxIterations << ", "
+       << "\"wall_seconds\": " << r.bestSeconds << ", "
+       << "\"median_wall_seconds\": " << r.medianSeconds << ", "
+       << "\"mpixels_per_second\": " << pixels / r.bestSeconds / 1.0e6 << ", "
+       << "\"iterations\": " << r.iterations << ", "
+       << "\"iterations_per_second\": " << r.iterations / r.bestSeconds << ", "
+       << "\"references\": " << r.references
+       << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n";
+  os << "}\n";
+}
+
+int main(int argc, char** argv) {
+  Options opts;
+  bool validArgs = false;
+
+  try {
+    validArgs = parseArgs(argc, argv, opts);
+  }
+  catch (const std::exception&) {}
+
+  if (!validArgs) {
+    usage();
+    return 1;
+  }
+
+  std::vector<Engine> engines;
+  for (const Engine& engine : headlessEngines()) {
+    if (opts.engines.empty() || contains(opts.engines, engine.name)) {
+      engines.push_back(engine);
+    }
+  }
+
+  std::vector<string> engineNames;
+  for (const Engine& engine : engines) {
+    engineNames.push_back(engine.name);
+  }
+
+  std::vector<DeepEngine> deep;
+  for (const DeepEngine& engine : deepEngines()) {
+    if (opts.engines.empty() || contains(opts.engines, engine.name)) {
+      deep.push_back(engine);
+      engineNames.push_back(engine.name);
+    }
+  }
+
+  std::vector<Result> results;
+
+  for (const Engine& engine : engines) {
+    for (const ReferenceLocation& loc : REFERENCE_LOCATIONS) {
+      if (!opts.locations.empty() && !contains(opts.locations, loc.name)) {
+        continue;
+      }
+
+      for (const Size& size : opts.sizes) {
+        for (int maxI : opts.maxIterations) {
+          std::cerr << engine.name << " " << loc.name << " " << size.w << "x"
+                    << size.h << " maxI=" << maxI << std::endl;
+
+          results.push_back(runBenchmark(engine, loc, size, maxI,
+                                         opts.repeats));
+        }
+      }
+    }
+  }
+
+  // Each deep engine handles glitches differently, so they're compared on
+  // reference orbits per frame as well as time
+  for (const DeepEngine& engine : deep) {
+    for (const DeepLocation& loc : DEEP_LOCATIONS) {
+      if (!opts.locations.empty() && !contains(opts.locations, loc.name)) {
+        continue;
+      }
+
+      for (const Size& size : opts.deepSizes) {
+        std::cerr << engine.name << " " << loc.name << " " << size.w << "x"
+                  << size.h << " maxI=" << loc.maxIterations << std::endl;
+
+        results.push_back(runDeepBenchmark(engine, loc, size, opts.repeats));
+      }
+    }
+  }
+
+  if (opts.outputPath.empty()) {
+    writeJson(std::cout, opts, engineNames, results);
+  }
+  else {
+    std::ofstream fout(opts.outputPath);
+    if (!fout.good()) {
+      std::cerr << "Failed to open " << opts.outputPath << std::endl;
+      return 1;
+    }
+    writeJson(fout, opts, engineNames, results);
+  }
+
+  return 0;
+}
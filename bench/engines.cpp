@@ -0,0 +1,91 @@
+#include <memory>
+#include "engines.hpp"
+#include "cpu_engine.hpp"
+
+std::vector<Engine> headlessEngines() {
+  std::vector<Engine> engines;
+
+  auto singleThreaded = std::make_shared<CpuEngine>(1);
+  engines.push_back(Engine{"cpu-1t", [singleThreaded](const IterationParams& p,
+                                                      IterationData& data) {
+    singleThreaded->render(p, data);
+  }});
+
+  auto multiThreaded = std::make_shared<CpuEngine>();
+  engines.push_back(Engine{"cpu-mt", [multiThreaded](const IterationParams& p,
+                                                     IterationData& data) {
+    multiThreaded->render(p, data);
+  }});
+
+  // Formula variants, benchmarked on the same locations
+  struct Variant {
+    const char* name;
+    Formula formula;
+    int power;
+    bool smooth;
+  };
+
+  static const Variant VARIANTS[] = {
+    { "cpu-mt-nosmooth", MANDELBROT, 2, false },
+    { "cpu-mt-cubic", MANDELBROT, 3, true },
+    { "cpu-mt-burning-ship", BURNING_SHIP, 2, true },
+    { "cpu-mt-tricorn", TRICORN, 2, true }
+  };
+
+  for (const Variant& v : VARIANTS) {
+    engines.push_back(Engine{v.name, [multiThreaded, v](IterationParams p,
+                                                        IterationData& data) {
+      p.formula = v.formula;
+      p.power = v.power;
+      p.smooth = v.smooth;
+      multiThreaded->render(p, data);
+    }, false});
+  }
+
+  return engines;
+}
+
+std::vector<DeepEngine> deepEngines() {
+  std::vector<DeepEngine> engines;
+
+  struct Variant {
+    const char* name;
+    PerturbationParams::GlitchMethod glitchMethod;
+    bool nucleusReference;
+    // Otherwise every render computes its references from scratch
+    bool reuseReferences;
+    SimdLevel maxSimd;
+  };
+
+  static const Variant VARIANTS[] = {
+    { "pert-rebase", PerturbationParams::REBASE, true, false, SIMD_AVX512 },
+    { "pert-rebase-avx2", PerturbationParams::REBASE, true, false, SIMD_AVX2 },
+    { "pert-rebase-scalar", PerturbationParams::REBASE, true, false,
+      SIMD_NONE },
+    { "pert-rebase-centre", PerturbationParams::REBASE, false, false,
+      SIMD_AVX512 },
+    { "pert-rebase-cached", PerturbationParams::REBASE, true, true,
+      SIMD_AVX512 },
+    { "pert-multi", PerturbationParams::MULTI_REFERENCE, false, false,
+      SIMD_AVX512 }
+  };
+
+  for (const Variant& v : VARIANTS) {
+    // Each has its own, so none reuses another's references
+    auto engine = std::make_shared<PerturbationEngine>();
+
+    engines.push_back(DeepEngine{v.name, [engine, v](PerturbationParams p,
+                                                     IterationData& data) {
+      if (!v.reuseReferences) {
+        engine->clearCache();
+      }
+
+      p.glitchMethod = v.glitchMethod;
+      p.nucleusReference = v.nucleusReference;
+      p.maxSimd = v.maxSimd;
+      return engine->render(p, data);
+    }});
+  }
+
+  return engines;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include "iteration_data.hpp"
+#include "perturbation_engine.hpp"
+
+// An iteration engine that can run without a window or GL context
+struct Engine {
+  std::string name;
+  std::function<void(const IterationParams&, IterationData&)> render;
+  // False for engines that render something other than the smooth
+  // Mandelbrot set, which the regression test can't check
+  bool matchesReference = true;
+};
+
+std::vector<Engine> headlessEngines();
+
+// A perturbation engine, for the views too deep for the others
+struct DeepEngine {
+  std::string name;
+  std::function<PerturbationEngine::Stats(const PerturbationParams&,
+                                          IterationData&)> render;
+};
+
+std::vector<DeepEngine> deepEngines();
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include "iteration_data.hpp"
+#include "perturbation_engine.hpp"
+
+// A fixed set of views used by the benchmarks and regression tests, chosen
+// to cover the different kinds of work an engine does. Magnification is
+// relative to the app's initial view, which is 4 units high.
+struct ReferenceLocation {
+  const char* name;
+  double x;
+  double y;
+  double magnification;
+};
+
+const std::vector<ReferenceLocation> REFERENCE_LOCATIONS = {
+  // Mostly cheap, quickly escaping points
+  { "default_view", -0.5, 0.0, 1.0 },
+  // Dense boundary detail
+  { "seahorse_valley", -0.743643887037151, 0.131825904205330, 5000.0 },
+  { "elephant_valley", 0.2925, 0.0149, 200.0 },
+  // Small copies of the set, surrounded by slowly escaping points
+  { "minibrot_period_3", -1.7548776662466927, 0.0, 400.0 },
+  { "deep_minibrot", -1.9855403716541305, 0.0, 1.0e9 },
+  // Almost entirely interior, so every pixel runs to maxIterations
+  { "cardioid_interior", -0.1, 0.1, 8.0 }
+};
+
+inline IterationParams referenceParams(const ReferenceLocation& loc, int w,
+                                       int h, int maxIterations) {
+  double yRange = 4.0 / loc.magnification;
+  double xRange = yRange * static_cast<double>(w) / static_cast<double>(h);
+
+  IterationParams params;
+  params.w = w;
+  params.h = h;
+  params.maxIterations = maxIterations;
+  params.xmin = loc.x - 0.5 * xRange;
+  params.xmax = loc.x + 0.5 * xRange;
+  params.ymin = loc.y - 0.5 * yRange;
+  params.ymax = loc.y + 0.5 * yRange;
+
+  return params;
+}
+
+// Views too deep for double precision, rendered by perturbation. Coordinates
+// are decimal strings, as they need more digits than a double holds, and each
+// has the iteration limit it needs to be resolved.
+struct DeepLocation {
+  const char* name;
+  const char* x;
+  const char* y;
+  const char* magnification;
+  int maxIterations;
+};
+
+#define SEAHORSE_X "-0.743643887037158704752191506114774"
+#define SEAHORSE_Y "0.131825904205311970493132056385139"
+
+const std::vector<DeepLocation> DEEP_LOCATIONS = {
+  // Spirals in seahorse valley, at increasing depth
+  { "seahorse_1e14", SEAHORSE_X, SEAHORSE_Y, "1e14", 20000 },
+  { "seahorse_1e20", SEAHORSE_X, SEAHORSE_Y, "1e20", 20000 },
+  { "seahorse_1e26", SEAHORSE_X, SEAHORSE_Y, "1e26", 30000 }
+};
+
+#undef SEAHORSE_X
+#undef SEAHORSE_Y
+
+inline PerturbationParams deepParams(const DeepLocation& loc, int w, int h) {
+  PerturbationParams params;
+  params.w = w;
+  params.h = h;
+  params.maxIterations = loc.maxIterations;
+  params.view = View::fromStrings(loc.x, loc.y, loc.magnification);
+
+  return params;
+}
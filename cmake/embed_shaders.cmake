@@ -0,0 +1,60 @@
+# Generates a header embedding every shader in SHADER_DIR as string constants.
+# Shaders containing SUBSTITUTION_MARKER are split around it, so substituting
+# the colour scheme at runtime is a concatenation.
+#
+# Usage: cmake -DSHADER_DIR=<dir> -DOUTPUT=<header> -P embed_shaders.cmake
+
+cmake_minimum_required(VERSION 3.10)
+
+set(SUBSTITUTION_MARKER "COMPUTE_COLOUR_IMPL")
+string(LENGTH "${SUBSTITUTION_MARKER}" MARKER_LENGTH)
+
+file(GLOB SHADER_FILES "${SHADER_DIR}/*.glsl")
+list(SORT SHADER_FILES)
+
+set(CONTENT "// Generated from data/*.glsl by cmake/embed_shaders.cmake\n\n")
+string(APPEND CONTENT "#pragma once\n\n")
+string(APPEND CONTENT "#include <map>\n#include <string>\n\n")
+string(APPEND CONTENT "struct EmbeddedShader {\n")
+string(APPEND CONTENT "  // Text before the substitution marker, or the whole shader\n")
+string(APPEND CONTENT "  const char* prefix;\n")
+string(APPEND CONTENT "  // Text after the substitution marker\n")
+string(APPEND CONTENT "  const char* suffix;\n")
+string(APPEND CONTENT "  bool hasMarker;\n")
+string(APPEND CONTENT "};\n\n")
+string(APPEND CONTENT "const std::map<std::string, EmbeddedShader> EMBEDDED_SHADERS = {\n")
+
+foreach(SHADER_FILE IN LISTS SHADER_FILES)
+  get_filename_component(SHADER_NAME "${SHADER_FILE}" NAME)
+  file(READ "${SHADER_FILE}" TEXT)
+
+  string(FIND "${TEXT}" "${SUBSTITUTION_MARKER}" MARKER_IDX)
+
+  if (MARKER_IDX EQUAL -1)
+    set(PREFIX "${TEXT}")
+    set(SUFFIX "")
+    set(HAS_MARKER "false")
+  else()
+    math(EXPR SUFFIX_IDX "${MARKER_IDX} + ${MARKER_LENGTH}")
+    string(SUBSTRING "${TEXT}" 0 ${MARKER_IDX} PREFIX)
+    string(SUBSTRING "${TEXT}" ${SUFFIX_IDX} -1 SUFFIX)
+    set(HAS_MARKER "true")
+  endif()
+
+  string(APPEND CONTENT "  {\n    \"${SHADER_NAME}\",\n    {\n")
+  string(APPEND CONTENT "      R\"glsl(${PREFIX})glsl\",\n")
+  string(APPEND CONTENT "      R\"glsl(${SUFFIX})glsl\",\n")
+  string(APPEND CONTENT "      ${HAS_MARKER}\n    }\n  },\n")
+endforeach()
+
+string(APPEND CONTENT "};\n")
+
+# Only touch the header when it changes, to avoid needless rebuilds
+set(EXISTING "")
+if (EXISTS "${OUTPUT}")
+  file(READ "${OUTPUT}" EXISTING)
+endif()
+
+if (NOT "${EXISTING}" STREQUAL "${CONTENT}")
+  file(WRITE "${OUTPUT}" "${CONTENT}")
+endif()
@@ -0,0 +1,41 @@
+#version 330 core
+
+precision highp float;
+precision highp int;
+
+uniform int u_maxIterations;
+uniform sampler2D u_data;
+
+layout(location = 0) out vec3 out_colour;
+
+vec3 hueToRgb(float hue) {
+  float h = mod(hue, 1.0) * 6.0;
+  float x = 1.0 - abs(mod(h, 2) - 1.0);
+  if (h < 1.0) {
+    return vec3(1.0, x, 0.0);
+  }
+  else if (h < 2.0) {
+    return vec3(x, 1.0, 0.0);
+  }
+  else if (h < 3.0) {
+    return vec3(0.0, 1.0, x);
+  }
+  else if (h < 4.0) {
+    return vec3(0.0, x, 1.0);
+  }
+  else if (h < 5.0) {
+    return vec3(x, 0.0, 1.0);
+  }
+  else {
+    return vec3(1.0, 0.0, x);
+  }
+}
+
+vec3 computeColour(int i, int maxI, vec2 lastZ) {
+COMPUTE_COLOUR_IMPL
+}
+
+void main() {
+  vec3 data = texelFetch(u_data, ivec2(gl_FragCoord.xy), 0).xyz;
+  out_colour = computeColour(int(data.x), u_maxIterations, data.yz);
+}
@@ -3,33 +3,69 @@
 precision highp float;
 precision highp int;
 
-const float RADIUS = 10000.0;
+// Defined, with the GL_ARB_gpu_shader_fp64 extension enabled, for the
+// double precision variant used at deep zoom
+#ifdef USE_FP64
+#define real double
+#define real2 dvec2
+#else
+#define real float
+#define real2 vec2
+#endif
+
+const real RADIUS = 10000.0;
 
 uniform float u_w;
 uniform float u_h;
 uniform int u_maxIterations;
-uniform float u_xmin;
-uniform float u_xmax;
-uniform float u_ymin;
-uniform float u_ymax;
+uniform real u_xmin;
+uniform real u_xmax;
+uniform real u_ymin;
+uniform real u_ymax;
+
+// Adaptive anti-aliasing. When u_aaMaxSamples is greater than 1 this is the
+// refinement pass, and u_firstPass holds the single sample render (colour
+// plus normalised iteration count) with an extra row above and below.
+uniform int u_aaMaxSamples;
+uniform float u_aaThreshold;
+uniform sampler2D u_firstPass;
+
+// Colour scheme baked into a lookup table, with the interior colour last
+uniform bool u_usePalette;
+uniform bool u_smoothPalette;
+uniform sampler2D u_palette;
 
-layout(location = 0) out vec3 out_colour;
+// Orbit state from the previous render at the same view: final z,
+// iteration count, and 1 if the point escaped. If u_resume is true, points
+// that hadn't escaped carry on from where they stopped.
+uniform bool u_resume;
+uniform sampler2D u_state;
+
+layout(location = 0) out vec4 out_colour;
+layout(location = 1) out vec4 out_state;
+
+#ifdef USE_FP64
+// The final z again, as the bits of two doubles, so a resumed orbit carries
+// on exactly where it stopped
+uniform usampler2D u_stateFp64;
+layout(location = 2) out uvec4 out_stateFp64;
+#endif
 
 struct Result {
   int i;
-  vec2 zn;
+  real2 zn;
 };
 
-Result testPoint(vec2 p) {
-  float x0 = p.x;
-  float y0 = p.y;
-  float x = x0;
-  float y = y0;
+// Iterates from z, which is the orbit of p after i iterations
+Result iterate(real2 p, real2 z, int i) {
+  real x0 = p.x;
+  real y0 = p.y;
+  real x = z.x;
+  real y = z.y;
 
-  int i = 0;
   for (; i < u_maxIterations; ++i) {
-    float nextX = x * x - y * y + x0;
-    float nextY = 2.0 * x * y + y0;
+    real nextX = x * x - y * y + x0;
+    real nextY = 2.0 * x * y + y0;
 
     x = nextX;
     y = nextY;
@@ -39,14 +75,36 @@ Result testPoint(vec2 p) {
     }
   }
 
-  return Result(i, vec2(x, y));
+  return Result(i, real2(x, y));
+}
+
+Result testPoint(real2 p) {
+  return iterate(p, p, 0);
+}
+
+Result resumePoint(real2 p) {
+  vec4 s = texelFetch(u_state, ivec2(gl_FragCoord.xy), 0);
+
+  if (s.w > 0.5) {
+    return Result(int(s.z), real2(s.xy));
+  }
+
+#ifdef USE_FP64
+  uvec4 bits = texelFetch(u_stateFp64, ivec2(gl_FragCoord.xy), 0);
+  real2 z = real2(packDouble2x32(bits.xy), packDouble2x32(bits.zw));
+#else
+  real2 z = s.xy;
+#endif
+
+  return iterate(p, z, int(s.z));
 }
 
-vec2 screenToWorld(vec2 p) {
-  float w = u_xmax - u_xmin;
-  float h = u_ymax - u_ymin;
+real2 screenToWorld(vec2 p) {
+  real w = u_xmax - u_xmin;
+  real h = u_ymax - u_ymin;
 
-  return vec2(u_xmin + w * p.x / u_w, u_ymin + h * p.y / u_h);
+  return real2(u_xmin + w * real(p.x) / real(u_w),
+               u_ymin + h * real(p.y) / real(u_h));
 }
 
 vec3 hueToRgb(float hue) {
@@ -76,8 +134,105 @@ vec3 computeColour(int i, int maxI, vec2 lastZ) {
 COMPUTE_COLOUR_IMPL
 }
 
+// Colours a result with the baked palette if there is one, otherwise with
+// computeColour directly
+vec3 shade(int i, vec2 lastZ) {
+  if (!u_usePalette) {
+    return computeColour(i, u_maxIterations, lastZ);
+  }
+
+  int entries = textureSize(u_palette, 0).x - 1;
+  if (i >= u_maxIterations) {
+    return texelFetch(u_palette, ivec2(entries, 0), 0).rgb;
+  }
+
+  float f = float(i);
+  if (u_smoothPalette) {
+    f -= log2(0.5 * log(dot(lastZ, lastZ)));
+  }
+
+  float x = clamp(f / float(u_maxIterations) * float(entries), 0.0,
+                  float(entries - 1));
+  return texture(u_palette, vec2((x + 0.5) / float(entries + 1), 0.5)).rgb;
+}
+
+float luminance(vec3 c) {
+  return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Offset of the nth extra sample within the pixel. Uses the R2 low
+// discrepancy sequence, shifted per pixel to avoid visible patterns.
+vec2 sampleOffset(int n) {
+  vec2 shift = fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) *
+                     vec2(43758.5453, 22578.1459));
+
+  return fract(shift + float(n) * vec2(0.7548776662, 0.5698402910)) - 0.5;
+}
+
+void refine() {
+  ivec2 p = ivec2(gl_FragCoord.xy) + ivec2(0, 1);
+  ivec2 maxP = textureSize(u_firstPass, 0) - 1;
+
+  float colourSum = 0.0;
+  float colourSumSq = 0.0;
+  float iterSum = 0.0;
+  float iterSumSq = 0.0;
+
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      vec4 s = texelFetch(u_firstPass, clamp(p + ivec2(dx, dy), ivec2(0), maxP),
+                          0);
+      float l = luminance(s.rgb);
+
+      colourSum += l;
+      colourSumSq += l * l;
+      iterSum += s.a;
+      iterSumSq += s.a * s.a;
+    }
+  }
+
+  float colourMean = colourSum / 9.0;
+  float iterMean = iterSum / 9.0;
+  float colourDev = sqrt(max(colourSumSq / 9.0 - colourMean * colourMean, 0.0));
+  float iterDev = sqrt(max(iterSumSq / 9.0 - iterMean * iterMean, 0.0));
+  float dev = max(colourDev, iterDev);
+
+  vec3 colour = texelFetch(u_firstPass, p, 0).rgb;
+  int samples = 1;
+
+  if (dev > u_aaThreshold) {
+    float f = dev / (4.0 * u_aaThreshold);
+    int extra = clamp(int(ceil(f * float(u_aaMaxSamples - 1))), 1,
+                      u_aaMaxSamples - 1);
+
+    for (int n = 0; n < extra; ++n) {
+      real2 q = screenToWorld(gl_FragCoord.xy + sampleOffset(n));
+      Result res = testPoint(q);
+      colour += shade(res.i, vec2(res.zn));
+    }
+
+    samples += extra;
+  }
+
+  // The sample count is returned in the alpha channel for statistics
+  out_colour = vec4(colour / float(samples), float(samples) / 255.0);
+}
+
 void main() {
-  vec2 p = screenToWorld(gl_FragCoord.xy);
-  Result res = testPoint(p);
-  out_colour = vec3(computeColour(res.i, u_maxIterations, res.zn));
+  if (u_aaMaxSamples > 1) {
+    refine();
+    return;
+  }
+
+  real2 p = screenToWorld(gl_FragCoord.xy);
+  Result res = u_resume ? resumePoint(p) : testPoint(p);
+  out_colour = vec4(shade(res.i, vec2(res.zn)),
+                    float(res.i) / float(u_maxIterations));
+
+  float escaped = res.i < u_maxIterations ? 1.0 : 0.0;
+  out_state = vec4(vec2(res.zn), float(res.i), escaped);
+#ifdef USE_FP64
+  out_stateFp64 = uvec4(unpackDouble2x32(res.zn.x),
+                        unpackDouble2x32(res.zn.y));
+#endif
 }
@@ -0,0 +1,52 @@
+#version 330 core
+
+precision highp float;
+precision highp int;
+
+// Bakes computeColour into a lookup table. The maximum iteration count is
+// u_entries. Texel k < u_entries holds the colour for iteration count
+// k + u_iterationOffset with final z u_lastZ, and the last texel holds the
+// interior colour.
+uniform int u_entries;
+uniform int u_iterationOffset;
+uniform vec2 u_lastZ;
+
+layout(location = 0) out vec3 out_colour;
+
+vec3 hueToRgb(float hue) {
+  float h = mod(hue, 1.0) * 6.0;
+  float x = 1.0 - abs(mod(h, 2) - 1.0);
+  if (h < 1.0) {
+    return vec3(1.0, x, 0.0);
+  }
+  else if (h < 2.0) {
+    return vec3(x, 1.0, 0.0);
+  }
+  else if (h < 3.0) {
+    return vec3(0.0, 1.0, x);
+  }
+  else if (h < 4.0) {
+    return vec3(0.0, x, 1.0);
+  }
+  else if (h < 5.0) {
+    return vec3(x, 0.0, 1.0);
+  }
+  else {
+    return vec3(1.0, 0.0, x);
+  }
+}
+
+vec3 computeColour(int i, int maxI, vec2 lastZ) {
+COMPUTE_COLOUR_IMPL
+}
+
+void main() {
+  int k = int(gl_FragCoord.x);
+
+  if (k >= u_entries) {
+    out_colour = computeColour(u_entries, u_entries, u_lastZ);
+  }
+  else {
+    out_colour = computeColour(k + u_iterationOffset, u_entries, u_lastZ);
+  }
+}
@@ -0,0 +1,155 @@
+#version 330 core
+
+precision highp float;
+precision highp int;
+
+// Deep views. The reference orbit is computed on the CPU in arbitrary
+// precision, and each pixel is iterated here as a small offset from it.
+
+// Defined, with the GL_ARB_gpu_shader_fp64 extension enabled, for the
+// double precision variant, which is preferred where the driver has it
+#ifdef USE_FP64
+#define real double
+#define real2 dvec2
+#else
+#define real float
+#define real2 vec2
+#endif
+
+const real RADIUS = 10000.0;
+
+uniform int u_maxIterations;
+
+// Z_-1 = 0 to Z_length of the reference orbit, in rows of the texture's
+// width. Each texel holds (re, im) rounded to floats, and then what that
+// rounding lost, so the double precision variant gets most of a double.
+uniform sampler2D u_orbit;
+uniform int u_orbitLength;
+
+// The reference in pixels from the bottom left corner, and the height of a
+// pixel in graph units
+uniform vec2 u_reference;
+uniform real u_pixelSize;
+
+// Colour scheme baked into a lookup table, with the interior colour last
+uniform bool u_usePalette;
+uniform bool u_smoothPalette;
+uniform sampler2D u_palette;
+
+layout(location = 0) out vec4 out_colour;
+layout(location = 1) out vec4 out_state;
+
+struct Result {
+  int i;
+  vec2 zn;
+};
+
+real2 orbitPoint(int m) {
+  int w = textureSize(u_orbit, 0).x;
+  int k = m + 1;
+  vec4 t = texelFetch(u_orbit, ivec2(k % w, k / w), 0);
+
+#ifdef USE_FP64
+  return real2(t.xy) + real2(t.zw);
+#else
+  return t.xy;
+#endif
+}
+
+real magnitude(real2 z) {
+  return max(abs(z.x), abs(z.y));
+}
+
+// As the CPU engine's rebasing loop. When the pixel comes closer to zero than
+// to the reference, it's rebased onto the start of the orbit, so the offset
+// never needs more precision than the pixel's own value. Sizes are compared
+// by their larger parts, as the squares of deep offsets underflow.
+Result iterate(real2 dc) {
+  real2 dz = dc;
+  real2 Z = orbitPoint(0);
+  real2 z = Z + dz;
+  int m = 0;
+
+  int i = 0;
+  for (; i < u_maxIterations; ++i) {
+    if (magnitude(z) < magnitude(dz) || m >= u_orbitLength) {
+      dz = z;
+      Z = real2(0.0);
+      m = -1;
+    }
+
+    // dz -> 2 Z dz + dz^2 + dc
+    dz = real2(2.0 * (Z.x * dz.x - Z.y * dz.y) + dz.x * dz.x - dz.y * dz.y,
+               2.0 * (Z.x * dz.y + Z.y * dz.x) + 2.0 * dz.x * dz.y) + dc;
+    ++m;
+
+    Z = orbitPoint(m);
+    z = Z + dz;
+
+    if (dot(z, z) > RADIUS) {
+      break;
+    }
+  }
+
+  return Result(i, vec2(z));
+}
+
+vec3 hueToRgb(float hue) {
+  float h = mod(hue, 1.0) * 6.0;
+  float x = 1.0 - abs(mod(h, 2.0) - 1.0);
+  if (h < 1.0) {
+    return vec3(1.0, x, 0.0);
+  }
+  else if (h < 2.0) {
+    return vec3(x, 1.0, 0.0);
+  }
+  else if (h < 3.0) {
+    return vec3(0.0, 1.0, x);
+  }
+  else if (h < 4.0) {
+    return vec3(0.0, x, 1.0);
+  }
+  else if (h < 5.0) {
+    return vec3(x, 0.0, 1.0);
+  }
+  else {
+    return vec3(1.0, 0.0, x);
+  }
+}
+
+vec3 computeColour(int i, int maxI, vec2 lastZ) {
+COMPUTE_COLOUR_IMPL
+}
+
+// Colours a result with the baked palette if there is one, otherwise with
+// computeColour directly
+vec3 shade(int i, vec2 lastZ) {
+  if (!u_usePalette) {
+    return computeColour(i, u_maxIterations, lastZ);
+  }
+
+  int entries = textureSize(u_palette, 0).x - 1;
+  if (i >= u_maxIterations) {
+    return texelFetch(u_palette, ivec2(entries, 0), 0).rgb;
+  }
+
+  float f = float(i);
+  if (u_smoothPalette) {
+    f -= log2(0.5 * log(dot(lastZ, lastZ)));
+  }
+
+  float x = clamp(f / float(u_maxIterations) * float(entries), 0.0,
+                  float(entries - 1));
+  return texture(u_palette, vec2((x + 0.5) / float(entries + 1), 0.5)).rgb;
+}
+
+void main() {
+  real2 dc = real2(gl_FragCoord.xy - u_reference) * u_pixelSize;
+  Result res = iterate(dc);
+
+  out_colour = vec4(shade(res.i, res.zn),
+                    float(res.i) / float(u_maxIterations));
+
+  float escaped = res.i < u_maxIterations ? 1.0 : 0.0;
+  out_state = vec4(res.zn, float(res.i), escaped);
+}
@@ -3,11 +3,16 @@
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec2 in_tex;
 
+// Maps the quad onto the part of the texture to show, for a frame held
+// while the view has moved
+uniform vec2 u_texOffset;
+uniform vec2 u_texScale;
+
 out vec2 vv_tex;
 
 void main() {
   gl_Position.xyz = in_pos;
   gl_Position.w = 1.0;
 
-  vv_tex = in_tex;
+  vv_tex = u_texOffset + in_tex * u_texScale;
 }
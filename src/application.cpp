@@ -20,6 +20,8 @@ static void doWithLogging(std::function<void()> fn) {
 }
 
 bool Application::OnInit() {
+  wxInitAllImageHandlers();
+
   MainWindow* frame = new MainWindow(versionString(),
                                      wxSize(WINDOW_W, WINDOW_H));
   frame->Show();
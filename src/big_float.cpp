@@ -0,0 +1,141 @@
+#include <cmath>
+#include <stdexcept>
+#include "big_float.hpp"
+
+using std::string;
+
+// Decimal exponents in this range are written out in full rather than in
+// scientific notation
+static const long MIN_FIXED_EXPONENT = -5;
+static const long MAX_FIXED_EXPONENT = 15;
+
+BigFloat::BigFloat(unsigned long precisionBits) {
+  mpf_init2(m_value, precisionBits);
+}
+
+BigFloat::BigFloat(double value, unsigned long precisionBits) {
+  mpf_init2(m_value, precisionBits);
+  mpf_set_d(m_value, value);
+}
+
+BigFloat::BigFloat(const BigFloat& cpy) {
+  mpf_init2(m_value, mpf_get_prec(cpy.m_value));
+  mpf_set(m_value, cpy.m_value);
+}
+
+BigFloat& BigFloat::operator=(const BigFloat& rhs) {
+  if (this != &rhs) {
+    mpf_set_prec(m_value, mpf_get_prec(rhs.m_value));
+    mpf_set(m_value, rhs.m_value);
+  }
+
+  return *this;
+}
+
+BigFloat::~BigFloat() {
+  mpf_clear(m_value);
+}
+
+BigFloat BigFloat::fromString(const string& s, unsigned long precisionBits) {
+  // GMP doesn't accept an explicit plus sign
+  string digits = s;
+  if (!digits.empty() && digits[0] == '+') {
+    digits.erase(0, 1);
+  }
+
+  BigFloat f(precisionBits);
+  if (digits.empty() || mpf_set_str(f.m_value, digits.c_str(), 10) != 0) {
+    throw std::invalid_argument("'" + s + "' isn't a number");
+  }
+
+  return f;
+}
+
+unsigned long BigFloat::precision() const {
+  return mpf_get_prec(m_value);
+}
+
+void BigFloat::setPrecision(unsigned long precisionBits) {
+  mpf_set_prec(m_value, precisionBits);
+}
+
+void BigFloat::addScaled(double value, long exponent) {
+  mpf_t term;
+  mpf_init2(term, 64);
+  mpf_set_d(term, value);
+
+  if (exponent >= 0) {
+    mpf_mul_2exp(term, term, exponent);
+  }
+  else {
+    mpf_div_2exp(term, term, -exponent);
+  }
+
+  mpf_add(m_value, m_value, term);
+  mpf_clear(term);
+}
+
+double BigFloat::toDouble() const {
+  return mpf_get_d(m_value);
+}
+
+double BigFloat::toDouble(long& exponent) const {
+  return mpf_get_d_2exp(&exponent, m_value);
+}
+
+string BigFloat::toString(size_t digits) const {
+  if (digits == 0) {
+    digits = static_cast<size_t>(std::ceil(precision() * std::log10(2.0)));
+  }
+
+  // The mantissa comes back as digits with the point before the first one
+  mp_exp_t exp = 0;
+  char* raw = mpf_get_str(nullptr, &exp, 10, digits, m_value);
+  string mantissa = raw;
+
+  void (*fnFree)(void*, size_t);
+  mp_get_memory_functions(nullptr, nullptr, &fnFree);
+  fnFree(raw, mantissa.size() + 1);
+
+  string sign;
+  if (!mantissa.empty() && mantissa[0] == '-') {
+    sign = "-";
+    mantissa.erase(0, 1);
+  }
+
+  if (mantissa.empty()) {
+    return "0";
+  }
+
+  // With one digit before the point
+  long e = static_cast<long>(exp) - 1;
+
+  if (e >= MIN_FIXED_EXPONENT && e <= MAX_FIXED_EXPONENT) {
+    if (e < 0) {
+      return sign + "0." + string(-e - 1, '0') + mantissa;
+    }
+
+    size_t intDigits = static_cast<size_t>(e) + 1;
+    if (mantissa.size() <= intDigits) {
+      return sign + mantissa + string(intDigits - mantissa.size(), '0');
+    }
+
+    return sign + mantissa.substr(0, intDigits) + "." +
+           mantissa.substr(intDigits);
+  }
+
+  string s = sign + mantissa.substr(0, 1);
+  if (mantissa.size() > 1) {
+    s += "." + mantissa.substr(1);
+  }
+
+  return s + "e" + std::to_string(e);
+}
+
+mpf_ptr BigFloat::get() {
+  return m_value;
+}
+
+mpf_srcptr BigFloat::get() const {
+  return m_value;
+}
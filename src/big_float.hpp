@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <gmp.h>
+
+// A binary floating point number with as many bits of mantissa as it's given,
+// wrapping GMP's mpf_t. Only what the view and reference orbits need is here;
+// anything else can use get() with the mpf_ functions directly.
+class BigFloat {
+public:
+  explicit BigFloat(unsigned long precisionBits = 64);
+  BigFloat(double value, unsigned long precisionBits);
+  BigFloat(const BigFloat& cpy);
+  BigFloat& operator=(const BigFloat& rhs);
+  ~BigFloat();
+
+  // Parses a decimal number, e.g. "-1.25e-300". Throws
+  // std::invalid_argument if s isn't one.
+  static BigFloat fromString(const std::string& s,
+                             unsigned long precisionBits);
+
+  unsigned long precision() const;
+  // The value is truncated if the precision goes down
+  void setPrecision(unsigned long precisionBits);
+
+  // Adds value * 2^exponent. The product is formed in full precision, so it
+  // can be far smaller than a double could hold.
+  void addScaled(double value, long exponent);
+
+  double toDouble() const;
+  // Returns d, with the value being d * 2^exponent, for values that would
+  // underflow or overflow a double
+  double toDouble(long& exponent) const;
+
+  // Decimal, with digits significant figures, or as many as the precision
+  // holds if zero
+  std::string toString(size_t digits = 0) const;
+
+  mpf_ptr get();
+  mpf_srcptr get() const;
+
+private:
+  mpf_t m_value;
+};
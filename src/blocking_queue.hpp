@@ -0,0 +1,80 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+// A bounded FIFO for passing work between pipeline stages. Once closed, push
+// fails and pop drains whatever is left.
+template<typename T>
+class BlockingQueue {
+public:
+  explicit BlockingQueue(size_t capacity)
+    : m_capacity(capacity) {}
+
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notFull.wait(lock, [this]() {
+      return m_closed || m_items.size() < m_capacity;
+    });
+
+    if (m_closed) {
+      return false;
+    }
+
+    m_items.push_back(std::move(item));
+    m_notEmpty.notify_one();
+    return true;
+  }
+
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notEmpty.wait(lock, [this]() {
+      return m_closed || !m_items.empty();
+    });
+
+    return popLocked(item);
+  }
+
+  template<typename Rep, typename Period>
+  bool popFor(T& item, const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_notEmpty.wait_for(lock, timeout, [this]() {
+      return m_closed || !m_items.empty();
+    });
+
+    return popLocked(item);
+  }
+
+  bool full() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_items.size() >= m_capacity;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_notEmpty.notify_all();
+    m_notFull.notify_all();
+  }
+
+private:
+  bool popLocked(T& item) {
+    if (m_items.empty()) {
+      return false;
+    }
+
+    item = std::move(m_items.front());
+    m_items.pop_front();
+    m_notFull.notify_one();
+    return true;
+  }
+
+  size_t m_capacity;
+  std::deque<T> m_items;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_notEmpty;
+  std::condition_variable m_notFull;
+  bool m_closed = false;
+};
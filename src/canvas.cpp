@@ -3,11 +3,19 @@
 #include "renderer.hpp"
 #include "wx_helpers.hpp"
 #include "defaults.hpp"
+#include "nucleus.hpp"
 
 namespace chrono = std::chrono;
 
 wxDEFINE_EVENT(FLY_THROUGH_MODE_TOGGLE_EVENT, wxCommandEvent);
 
+static const int MINIBROT_SEARCH_TIMER_ID = wxID_HIGHEST + 1;
+static const int MINIBROT_SEARCH_POLL_INTERVAL = 50;
+static const int REFERENCE_TIMER_ID = wxID_HIGHEST + 2;
+static const int REFERENCE_POLL_INTERVAL = 50;
+static const int STATS_TIMER_ID = wxID_HIGHEST + 3;
+static const int STATS_POLL_INTERVAL = 20;
+
 wxBEGIN_EVENT_TABLE(Canvas, wxGLCanvas)
   EVT_PAINT(Canvas::onPaint)
   EVT_SIZE(Canvas::onResize)
@@ -15,9 +23,18 @@ wxBEGIN_EVENT_TABLE(Canvas, wxGLCanvas)
   EVT_LEFT_DOWN(Canvas::onLeftMouseBtnDown)
   EVT_LEFT_UP(Canvas::onLeftMouseBtnUp)
   EVT_MOTION(Canvas::onMouseMove)
+  EVT_TIMER(MINIBROT_SEARCH_TIMER_ID, Canvas::onMinibrotSearchTick)
+  EVT_TIMER(REFERENCE_TIMER_ID, Canvas::onReferenceTick)
+  EVT_TIMER(STATS_TIMER_ID, Canvas::onStatsTick)
   EVT_TIMER(wxID_ANY, Canvas::onTick)
 wxEND_EVENT_TABLE()
 
+// During fly-through, aim to render each frame in this fraction of the frame
+// period, leaving time for the rest of the frame
+static const double RESOLUTION_HEADROOM = 0.8;
+static const double RESOLUTION_SMOOTHING = 0.5;
+static const double MIN_RESOLUTION_SCALE = 0.2;
+
 static bool selectionSizeAboveThreshold(const wxSize& sz) {
   return sz.x * sz.x + sz.y * sz.y >= 64;
 }
@@ -27,7 +44,8 @@ Canvas::Canvas(wxWindow* parent, const wxGLAttributes& glAttrs,
   : wxGLCanvas(parent, glAttrs, wxID_ANY, wxDefaultPosition, wxDefaultSize,
                wxFULL_REPAINT_ON_RESIZE),
     m_renderer(renderer),
-    m_onRender(onRender) {
+    m_onRender(onRender),
+    m_searcher(1, ThreadPool::LOW) {
 
   m_targetFps = DEFAULT_TARGET_FPS;
   m_zoomPerFrame = DEFAULT_ZOOM_PER_FRAME;
@@ -51,6 +69,9 @@ Canvas::Canvas(wxWindow* parent, const wxGLAttributes& glAttrs,
   m_context.reset(new wxGLContext(this, nullptr, &attrs));
 
   m_timer = new wxTimer(this);
+  m_minibrotSearchTimer = new wxTimer(this, MINIBROT_SEARCH_TIMER_ID);
+  m_referenceTimer = new wxTimer(this, REFERENCE_TIMER_ID);
+  m_statsTimer = new wxTimer(this, STATS_TIMER_ID);
 
   SetBackgroundStyle(wxBG_STYLE_CUSTOM);
 }
@@ -113,6 +134,10 @@ void Canvas::deactivateFlyThroughMode() {
   m_timer->Stop();
   m_flyThroughMode = false;
 
+  m_resolutionScale = 1.0;
+  m_renderer.setResolutionScale(m_resolutionScale);
+  refresh();
+
   wxCommandEvent event(FLY_THROUGH_MODE_TOGGLE_EVENT);
   event.SetInt(TOGGLED_OFF);
   wxPostEvent(this, event);
@@ -172,6 +197,10 @@ void Canvas::onKeyPress(wxKeyEvent& e) {
   if (key == 'F') {
     std::cout << m_measuredFrameRate << std::endl;
   }
+  else if (key == 'H') {
+    m_hudVisible = !m_hudVisible;
+    refresh();
+  }
   else if (key == 'Z') {
     if (m_flyThroughMode) {
       deactivateFlyThroughMode();
@@ -194,6 +223,60 @@ void Canvas::onKeyPress(wxKeyEvent& e) {
     m_renderer.screenSpaceZoom(sz.x / 2, sz.y / 2, 1.0 / m_zoomAmount);
     refresh();
   }
+  else if (key == 'N') {
+    zoomToNearestMinibrot();
+  }
+}
+
+// Finding the nucleus takes many high precision iterations, so it's done on
+// a worker thread and the view is changed when it's found
+void Canvas::zoomToNearestMinibrot() {
+  if (m_minibrotSearch.valid()) {
+    return;
+  }
+
+  View view = m_renderer.getView();
+  int maxPeriod = m_renderer.getMaxIterations();
+
+  m_minibrotSearch = m_searcher.run([this, view, maxPeriod]() {
+    return findMinibrotView(view, maxPeriod, m_minibrotView);
+  });
+
+  m_minibrotSearchTimer->Start(MINIBROT_SEARCH_POLL_INTERVAL);
+}
+
+void Canvas::onMinibrotSearchTick(wxTimerEvent&) {
+  if (m_minibrotSearch.wait_for(chrono::seconds(0)) !=
+      std::future_status::ready) {
+    return;
+  }
+
+  m_minibrotSearchTimer->Stop();
+
+  if (m_minibrotSearch.get() && !m_disabled) {
+    m_renderer.setView(m_minibrotView);
+    refresh();
+  }
+}
+
+void Canvas::onReferenceTick(wxTimerEvent&) {
+  if (m_renderer.referencePending()) {
+    return;
+  }
+
+  m_referenceTimer->Stop();
+  refresh();
+}
+
+// The owner sees the new iteration limit, if any, as it does after a render
+void Canvas::onStatsTick(wxTimerEvent&) {
+  if (!m_renderer.collectIterationStats() &&
+      m_renderer.iterationStatsPending()) {
+    return;
+  }
+
+  m_statsTimer->Stop();
+  m_onRender();
 }
 
 void Canvas::measureFrameRate() {
@@ -208,6 +291,24 @@ void Canvas::measureFrameRate() {
   ++m_frame;
 }
 
+// Render time is roughly proportional to the number of pixels, so scale each
+// dimension by the square root of the ratio of the budget to the last
+// frame's render time
+void Canvas::adjustResolutionScale(double frameSeconds) {
+  if (frameSeconds <= 0.0) {
+    return;
+  }
+
+  double budget = RESOLUTION_HEADROOM / m_targetFps;
+  double idealScale = m_resolutionScale * sqrt(budget / frameSeconds);
+
+  m_resolutionScale += RESOLUTION_SMOOTHING * (idealScale - m_resolutionScale);
+  m_resolutionScale = std::max(MIN_RESOLUTION_SCALE,
+                               std::min(1.0, m_resolutionScale));
+
+  m_renderer.setResolutionScale(m_resolutionScale);
+}
+
 wxPoint Canvas::dampenCursorPos(const wxPoint& p) const {
   auto sz = GetSize();
 
@@ -262,7 +363,21 @@ void Canvas::render(wxDC&) {
     return;
   }
 
-  m_renderer.drawMandelbrot(m_mouseDown);
+  FrameProfiler& profiler = m_renderer.profiler();
+  profiler.beginFrame();
+
+  if (m_flyThroughMode && !m_mouseDown) {
+    auto t0 = chrono::high_resolution_clock::now();
+
+    m_renderer.drawMandelbrot();
+    m_renderer.waitForGpu();
+
+    chrono::duration<double> span = chrono::high_resolution_clock::now() - t0;
+    adjustResolutionScale(span.count());
+  }
+  else {
+    m_renderer.drawMandelbrot(m_mouseDown);
+  }
 
   if (m_mouseDown) {
     int x = m_selectionRect.x;
@@ -273,8 +388,27 @@ void Canvas::render(wxDC&) {
     m_renderer.drawSelectionRect(x, y, w, h);
   }
 
+  if (m_hudVisible) {
+    m_renderer.drawProfilerHud(1.0 / m_targetFps);
+  }
+
   m_renderer.finish();
+
+  // Fly-through redraws anyway
+  if (!m_flyThroughMode && m_renderer.referencePending() &&
+      !m_referenceTimer->IsRunning()) {
+    m_referenceTimer->Start(REFERENCE_POLL_INTERVAL);
+  }
+  if (!m_flyThroughMode && m_renderer.iterationStatsPending() &&
+      !m_statsTimer->IsRunning()) {
+    m_statsTimer->Start(STATS_POLL_INTERVAL);
+  }
+
+  profiler.beginStage(FrameProfiler::SWAP);
   SwapBuffers();
+  profiler.endStage(FrameProfiler::SWAP);
+
+  profiler.endFrame();
 
   measureFrameRate();
   m_onRender();
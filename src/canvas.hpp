@@ -5,6 +5,8 @@
 #include <chrono>
 #include <wx/wx.h>
 #include "gl.hpp"
+#include "thread_pool.hpp"
+#include "view.hpp"
 
 class Renderer;
 
@@ -24,12 +26,14 @@ public:
 private:
   void render(wxDC& dc);
   void measureFrameRate();
+  void adjustResolutionScale(double frameSeconds);
   void centreCursor();
   wxPoint getCursorPos() const;
   wxPoint dampenCursorPos(const wxPoint& p) const;
   void resize();
   void activateFlyThroughMode();
   void deactivateFlyThroughMode();
+  void zoomToNearestMinibrot();
 
   void onResize(wxSizeEvent& e);
   void onKeyPress(wxKeyEvent& e);
@@ -38,6 +42,9 @@ private:
   void onMouseMove(wxMouseEvent& e);
   void onPaint(wxPaintEvent& e);
   void onTick(wxTimerEvent& e);
+  void onMinibrotSearchTick(wxTimerEvent& e);
+  void onReferenceTick(wxTimerEvent& e);
+  void onStatsTick(wxTimerEvent& e);
 
   Renderer& m_renderer;
   bool m_disabled = false;
@@ -49,11 +56,24 @@ private:
   std::chrono::high_resolution_clock::time_point m_t =
     std::chrono::high_resolution_clock::now();
   bool m_flyThroughMode = false;
+  bool m_hudVisible = false;
   double m_targetFps;
+  double m_resolutionScale = 1.0;
   double m_zoomPerFrame;
   double m_zoomAmount;
   bool m_mouseDown = false;
   wxRect m_selectionRect;
+  // Polls the search for a minibrot, which runs on m_searcher
+  wxTimer* m_minibrotSearchTimer = nullptr;
+  std::future<bool> m_minibrotSearch;
+  View m_minibrotView;
+  // Redraws the view once the renderer's reference orbit is ready
+  wxTimer* m_referenceTimer = nullptr;
+  // Picks up a frame's statistics once they're back from the GPU, so the
+  // automatic iteration limit can settle without more frames
+  wxTimer* m_statsTimer = nullptr;
+  // Declared last, so a search finishes before what it writes to goes
+  ThreadPool m_searcher;
 
   wxDECLARE_EVENT_TABLE();
 };
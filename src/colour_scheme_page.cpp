@@ -96,6 +96,10 @@ void ColourSchemePage::disable() {
   m_btnSave->Disable();
 }
 
+string ColourSchemePage::getColourSchemeName() const {
+  return m_cboSelector->GetValue().ToStdString();
+}
+
 void ColourSchemePage::applyColourScheme() {
   try {
     string name = m_cboSelector->GetValue().ToStdString();
@@ -14,6 +14,7 @@ public:
 
   void enable();
   void disable();
+  std::string getColourSchemeName() const;
 
 private:
   void loadColourSchemes();
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include "cpu_engine.hpp"
+
+// Same bailout as the fragment shader, so smooth colouring matches
+static const double RADIUS = 10000.0;
+
+// Smallest bailout (of |z|^2) that still guarantees escape
+static const double ESCAPE_RADIUS = 4.0;
+
+static const int NUM_POWERS = MAX_POWER - MIN_POWER + 1;
+
+// Applies the formula's fold to z before it's raised to the power
+template <Formula F>
+static inline void fold(double&, double&) {}
+
+template <>
+inline void fold<BURNING_SHIP>(double& x, double& y) {
+  x = std::fabs(x);
+  y = std::fabs(y);
+}
+
+template <>
+inline void fold<TRICORN>(double&, double& y) {
+  y = -y;
+}
+
+template <int POWER>
+static inline void power(double& x, double& y) {
+  double zx = x;
+  double zy = y;
+
+  // The bound is a constant, so this unrolls
+  for (int k = 1; k < POWER; ++k) {
+    double nextX = x * zx - y * zy;
+    double nextY = x * zy + y * zx;
+
+    x = nextX;
+    y = nextY;
+  }
+}
+
+// Every combination of parameters is compiled separately, so the inner loop
+// has no branches other than the bailout test
+template <Formula F, int POWER, bool SMOOTH>
+static void renderRow(double xmin, double xScale, double y0, int w, int maxI,
+                      PixelResult* dst) {
+  const double radius = SMOOTH ? RADIUS : ESCAPE_RADIUS;
+
+  for (int col = 0; col < w; ++col) {
+    double x0 = xmin + xScale * (col + 0.5);
+    double x = x0;
+    double y = y0;
+
+    int i = 0;
+    for (; i < maxI; ++i) {
+      fold<F>(x, y);
+      power<POWER>(x, y);
+
+      x += x0;
+      y += y0;
+
+      if (x * x + y * y > radius) {
+        break;
+      }
+    }
+
+    if (SMOOTH) {
+      dst[col] = PixelResult{static_cast<float>(i), static_cast<float>(x),
+                             static_cast<float>(y)};
+    }
+    else {
+      dst[col] = PixelResult{static_cast<float>(i), 0.f, 0.f};
+    }
+  }
+}
+
+typedef void (*RowKernel)(double, double, double, int, int, PixelResult*);
+
+#define POWER_KERNELS(F, SMOOTH) \
+  { \
+    renderRow<F, 2, SMOOTH>, \
+    renderRow<F, 3, SMOOTH>, \
+    renderRow<F, 4, SMOOTH>, \
+    renderRow<F, 5, SMOOTH>, \
+    renderRow<F, 6, SMOOTH>, \
+    renderRow<F, 7, SMOOTH>, \
+    renderRow<F, 8, SMOOTH> \
+  }
+
+#define FORMULA_KERNELS(F) \
+  { \
+    POWER_KERNELS(F, false), \
+    POWER_KERNELS(F, true) \
+  }
+
+// Indexed by formula, smooth and power - MIN_POWER
+static const RowKernel KERNELS[NUM_FORMULAS][2][NUM_POWERS] = {
+  FORMULA_KERNELS(MANDELBROT),
+  FORMULA_KERNELS(BURNING_SHIP),
+  FORMULA_KERNELS(TRICORN)
+};
+
+static RowKernel selectKernel(const IterationParams& params) {
+  if (params.formula < 0 || params.formula >= NUM_FORMULAS) {
+    throw std::invalid_argument("Unknown formula");
+  }
+
+  if (params.power < MIN_POWER || params.power > MAX_POWER) {
+    throw std::invalid_argument("Unsupported power");
+  }
+
+  return KERNELS[params.formula][params.smooth][params.power - MIN_POWER];
+}
+
+CpuEngine::CpuEngine(unsigned int numThreads, ThreadPool::Priority priority)
+  : m_threads(numThreads, priority) {}
+
+void CpuEngine::render(const IterationParams& params, IterationData& data) {
+  RowKernel kernel = selectKernel(params);
+
+  if (data.w != params.w || data.h != params.h) {
+    data = IterationData(params.w, params.h);
+  }
+  data.maxIterations = params.maxIterations;
+
+  double xScale = (params.xmax - params.xmin) / params.w;
+  double yScale = (params.ymax - params.ymin) / params.h;
+
+  std::atomic<int> nextRow(0);
+
+  // Rows are handed out one at a time so threads that draw cheap rows pick
+  // up the slack from those in the expensive parts of the image
+  auto renderRows = [&]() {
+    int row = 0;
+    while ((row = nextRow++) < params.h) {
+      double y = params.ymin + yScale * (row + 0.5);
+      PixelResult* dst = data.pixels.data() + row * params.w;
+
+      kernel(params.xmin, xScale, y, params.w, params.maxIterations, dst);
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  for (unsigned int i = 0; i < m_threads.numThreads(); ++i) {
+    tasks.push_back(m_threads.run(renderRows));
+  }
+
+  for (auto& task : tasks) {
+    task.get();
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "iteration_data.hpp"
+#include "thread_pool.hpp"
+
+// Computes escape-time data in double precision on the CPU. Rows are shared
+// out between the pool's threads. Unlike the shader, it needs no GL context.
+class CpuEngine {
+public:
+  explicit CpuEngine(unsigned int numThreads = 0,
+                     ThreadPool::Priority priority = ThreadPool::NORMAL);
+
+  void render(const IterationParams& params, IterationData& data);
+
+private:
+  ThreadPool m_threads;
+};
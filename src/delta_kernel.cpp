@@ -0,0 +1,124 @@
+#include "delta_kernel.hpp"
+
+#ifdef MANDELBROT_X86_SIMD
+#ifdef WIN32
+#include <intrin.h>
+#endif
+#endif
+
+// Same bailout as the shader
+static const double RADIUS = 10000.0;
+
+// Iterates the offset of the pixel at dc from the reference orbit, rebasing
+// onto the start of the orbit whenever the pixel comes closer to zero than
+// to the reference. The offset then never needs more precision than the
+// pixel's own value, so one reference serves every pixel.
+static void iteratePixel(const ReferenceOrbit& orbit, double dcx, double dcy,
+                         int maxI, PixelResult& result) {
+  const double* re = orbit.re();
+  const double* im = orbit.im();
+  const double* reLo = orbit.reLo();
+  const double* imLo = orbit.imLo();
+  int length = orbit.length();
+
+  // z = Z_m + dz. A pixel rebased onto Z_-1 = 0 steps to Z_0 = C next.
+  int m = 0;
+  double dx = dcx;
+  double dy = dcy;
+  double zx = re[0] + dx;
+  double zy = im[0] + dy;
+  double r = zx * zx + zy * zy;
+  double rd = dx * dx + dy * dy;
+  bool escaped = false;
+
+  int i = 0;
+  while (i < maxI && !escaped) {
+    // Rebasing leaves this loop rather than being a branch inside it, or
+    // the compiler makes it a select that lengthens every iteration
+    for (; i < maxI; ++i) {
+      // Closer to zero than to the reference, or the reference escaped
+      // before the pixel did
+      if (r < rd || m >= length) {
+        break;
+      }
+
+      stepDelta(re[m], im[m], reLo[m], imLo[m], dcx, dcy, dx, dy);
+      ++m;
+
+      zx = re[m] + dx;
+      zy = im[m] + dy;
+      r = zx * zx + zy * zy;
+
+      if (r > RADIUS) {
+        escaped = true;
+        break;
+      }
+
+      rd = dx * dx + dy * dy;
+    }
+
+    dx = zx;
+    dy = zy;
+    rd = r;
+    m = -1;
+  }
+
+  result = PixelResult{static_cast<float>(i), static_cast<float>(zx),
+                       static_cast<float>(zy)};
+}
+
+void iterateDeltas(const ReferenceOrbit& orbit, const double* dcx,
+                   const double* dcy, const int* pixels, int n,
+                   int maxIterations, PixelResult* out) {
+  for (int k = 0; k < n; ++k) {
+    iteratePixel(orbit, dcx[k], dcy[k], maxIterations, out[pixels[k]]);
+  }
+}
+
+#ifdef MANDELBROT_X86_SIMD
+#ifdef WIN32
+static bool cpuSupports(SimdLevel level) {
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // The OS must save the wider registers too
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  bool fma = (info[2] & (1 << 12)) != 0;
+  if (!osxsave || !fma) {
+    return false;
+  }
+  unsigned long long xcr0 = _xgetbv(0);
+
+  __cpuidx(info, 7, 0);
+  if (level == SIMD_AVX512) {
+    return (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+  }
+  return (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+}
+#else
+static bool cpuSupports(SimdLevel level) {
+  if (level == SIMD_AVX512) {
+    return __builtin_cpu_supports("avx512f");
+  }
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+#endif
+#endif
+
+DeltaKernel selectDeltaKernel(SimdLevel maxLevel) {
+#ifdef MANDELBROT_X86_SIMD
+  if (maxLevel >= SIMD_AVX512 && cpuSupports(SIMD_AVX512)) {
+    return iterateDeltasAvx512;
+  }
+  if (maxLevel >= SIMD_AVX2 && cpuSupports(SIMD_AVX2)) {
+    return iterateDeltasAvx2;
+  }
+#else
+  (void)maxLevel;
+#endif
+  return iterateDeltas;
+}
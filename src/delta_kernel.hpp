@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cmath>
+#include "iteration_data.hpp"
+#include "reference_orbit.hpp"
+
+enum SimdLevel {
+  SIMD_NONE,
+  SIMD_AVX2,
+  SIMD_AVX512
+};
+
+// Iterates n pixels against a reference orbit, rebasing onto the start of
+// the orbit whenever a pixel comes closer to zero than to the reference.
+// dcx and dcy are the pixels' offsets from the orbit's point, and the
+// results go to out[pixels[k]].
+typedef void (*DeltaKernel)(const ReferenceOrbit& orbit, const double* dcx,
+                            const double* dcy, const int* pixels, int n,
+                            int maxIterations, PixelResult* out);
+
+// The rounding error of p = a * b, so a * b = p + error exactly. Without
+// fused multiply-adds, Dekker's product gives the same error exactly, but
+// for subnormals.
+inline double productError(double a, double b, double p) {
+#ifdef FP_FAST_FMA
+  return std::fma(a, b, -p);
+#else
+  // Halves of a and b that multiply exactly
+  const double SPLIT = 134217729.0;
+  double ta = SPLIT * a;
+  double tb = SPLIT * b;
+  double aHi = ta - (ta - a);
+  double bHi = tb - (tb - b);
+  double aLo = a - aHi;
+  double bLo = b - bHi;
+  return ((aHi * bHi - p) + aHi * bLo + aLo * bHi) + aLo * bLo;
+#endif
+}
+
+// dz -> 2 Z dz + dz^2 + dc, for Z = Zx + Lx, Zy + Ly from the orbit's high
+// and low parts. The rounding errors of Z dz's products are kept, as they
+// and the low parts are small next to dz but can grow to a pixel or more
+// once a pixel rebases. The SIMD kernels do the same operations in the same
+// order, so all kernels agree exactly.
+inline void stepDelta(double Zx, double Zy, double Lx, double Ly, double dcx,
+                      double dcy, double& dx, double& dy) {
+  double xx = Zx * dx;
+  double yy = Zy * dy;
+  double xy = Zx * dy;
+  double yx = Zy * dx;
+  double xxLo = productError(Zx, dx, xx);
+  double yyLo = productError(Zy, dy, yy);
+  double xyLo = productError(Zx, dy, xy);
+  double yxLo = productError(Zy, dx, yx);
+
+  double nextDx = 2.0 * (xx - yy) +
+                  (2.0 * ((xxLo - yyLo) + (Lx * dx - Ly * dy)) +
+                   (dx * dx - dy * dy + dcx));
+  double nextDy = 2.0 * (xy + yx) +
+                  (2.0 * ((xyLo + yxLo) + (Lx * dy + Ly * dx)) +
+                   (2.0 * dx * dy + dcy));
+  dx = nextDx;
+  dy = nextDy;
+}
+
+// The widest kernel the CPU supports, up to maxLevel
+DeltaKernel selectDeltaKernel(SimdLevel maxLevel);
+
+// For each SIMD kernel, the pixels are iterated several at a time in
+// structure of arrays form, and the reference orbit is gathered from its own
+// arrays at each lane's position in it. A lane is refilled with the next
+// pixel as soon as its pixel finishes.
+void iterateDeltas(const ReferenceOrbit& orbit, const double* dcx,
+                   const double* dcy, const int* pixels, int n,
+                   int maxIterations, PixelResult* out);
+#ifdef MANDELBROT_X86_SIMD
+void iterateDeltasAvx2(const ReferenceOrbit& orbit, const double* dcx,
+                       const double* dcy, const int* pixels, int n,
+                       int maxIterations, PixelResult* out);
+void iterateDeltasAvx512(const ReferenceOrbit& orbit, const double* dcx,
+                         const double* dcy, const int* pixels, int n,
+                         int maxIterations, PixelResult* out);
+#endif
@@ -0,0 +1,60 @@
+#ifdef MANDELBROT_X86_SIMD
+
+#include <immintrin.h>
+#include "delta_kernel_simd.hpp"
+
+// Built with AVX2 and FMA enabled, and only called if the CPU has both
+
+static const double RADIUS = 10000.0;
+
+// Vectors of lanes iterated together. Found fastest by the bench; more were
+// slower, running out of registers.
+static const int AVX2_GROUPS = 3;
+
+struct Avx2 {
+  typedef __m256d vec;
+  typedef __m256d mask;
+  static const int WIDTH = 4;
+
+  static vec set1(double x) { return _mm256_set1_pd(x); }
+  static vec load(const double* p) { return _mm256_load_pd(p); }
+  static void store(double* p, vec x) { _mm256_store_pd(p, x); }
+
+  static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+  // a * b - c, rounded once
+  static vec mulSub(vec a, vec b, vec c) { return _mm256_fmsub_pd(a, b, c); }
+
+  static mask less(vec a, vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static mask greater(vec a, vec b) {
+    return _mm256_cmp_pd(a, b, _CMP_GT_OQ);
+  }
+  static mask notLess(vec a, vec b) {
+    return _mm256_cmp_pd(a, b, _CMP_GE_OQ);
+  }
+  static mask either(mask a, mask b) { return _mm256_or_pd(a, b); }
+  static mask both(mask a, mask b) { return _mm256_and_pd(a, b); }
+  static bool any(mask a) { return _mm256_movemask_pd(a) != 0; }
+  static int bits(mask a) { return _mm256_movemask_pd(a); }
+
+  // b where the mask is set, a elsewhere
+  static vec blend(mask k, vec a, vec b) { return _mm256_blendv_pd(a, b, k); }
+
+  // p[m] for each lane, m being a whole number. The masked form, with every
+  // lane set, spares GCC warning about the unmasked one's undefined source.
+  static vec gather(const double* p, vec m) {
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), p,
+                                    _mm256_cvtpd_epi32(m),
+                                    _mm256_set1_pd(-1.0), 8);
+  }
+};
+
+void iterateDeltasAvx2(const ReferenceOrbit& orbit, const double* dcx,
+                       const double* dcy, const int* pixels, int n,
+                       int maxIterations, PixelResult* out) {
+  iterateDeltasSimd<Avx2, AVX2_GROUPS>(orbit, dcx, dcy, pixels, n,
+                                       maxIterations, RADIUS, out);
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifdef MANDELBROT_X86_SIMD
+
+#include <immintrin.h>
+#include "delta_kernel_simd.hpp"
+
+// Built with AVX-512 enabled, and only called if the CPU has it
+
+static const double RADIUS = 10000.0;
+
+// Vectors of lanes iterated together. Found fastest by the bench; more were
+// slower.
+static const int AVX512_GROUPS = 3;
+
+struct Avx512 {
+  typedef __m512d vec;
+  typedef __mmask8 mask;
+  static const int WIDTH = 8;
+
+  static vec set1(double x) { return _mm512_set1_pd(x); }
+  static vec load(const double* p) { return _mm512_load_pd(p); }
+  static void store(double* p, vec x) { _mm512_store_pd(p, x); }
+
+  static vec add(vec a, vec b) { return _mm512_add_pd(a, b); }
+  static vec sub(vec a, vec b) { return _mm512_sub_pd(a, b); }
+  static vec mul(vec a, vec b) { return _mm512_mul_pd(a, b); }
+  // a * b - c, rounded once
+  static vec mulSub(vec a, vec b, vec c) { return _mm512_fmsub_pd(a, b, c); }
+
+  static mask less(vec a, vec b) {
+    return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+  }
+  static mask greater(vec a, vec b) {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+  }
+  static mask notLess(vec a, vec b) {
+    return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+  }
+  static mask either(mask a, mask b) { return a | b; }
+  static mask both(mask a, mask b) { return a & b; }
+  static bool any(mask a) { return a != 0; }
+  static int bits(mask a) { return a; }
+
+  // b where the mask is set, a elsewhere
+  static vec blend(mask k, vec a, vec b) {
+    return _mm512_mask_blend_pd(k, a, b);
+  }
+
+  // p[m] for each lane, m being a whole number. The masked forms, with every
+  // lane set, spare GCC warning about the unmasked ones' undefined sources.
+  static vec gather(const double* p, vec m) {
+    __m256i index = _mm512_maskz_cvtpd_epi32(0xff, m);
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xff, index, p, 8);
+  }
+};
+
+void iterateDeltasAvx512(const ReferenceOrbit& orbit, const double* dcx,
+                         const double* dcy, const int* pixels, int n,
+                         int maxIterations, PixelResult* out) {
+  iterateDeltasSimd<Avx512, AVX512_GROUPS>(orbit, dcx, dcy, pixels, n,
+                                           maxIterations, RADIUS, out);
+}
+
+#endif
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "delta_kernel.hpp"
+
+// The SIMD kernels, written once over a set of vector operations V. Each
+// instruction set's source file includes this with its own V, compiled for
+// that instruction set only.
+
+// A lane's state, saved when pixels finish and lanes are refilled
+template <int WIDTH>
+struct alignas(64) DeltaLanes {
+  double dx[WIDTH];
+  double dy[WIDTH];
+  double cx[WIDTH];
+  double cy[WIDTH];
+  double zx[WIDTH];
+  double zy[WIDTH];
+  double r[WIDTH];
+  double rd[WIDTH];
+  // Position in the orbit, and iterations so far
+  double m[WIDTH];
+  double i[WIDTH];
+  double active[WIDTH];
+  int pixel[WIDTH];
+};
+
+// Starts lane l on the next pixel, or leaves it idle if there are none. An
+// idle lane keeps iterating from zero, but is never read.
+template <int WIDTH>
+static void startLane(const ReferenceOrbit& orbit, const double* dcx,
+                      const double* dcy, int n, int& next,
+                      DeltaLanes<WIDTH>& lanes, int l) {
+  double cx = 0.0;
+  double cy = 0.0;
+  bool active = next < n;
+  if (active) {
+    cx = dcx[next];
+    cy = dcy[next];
+    lanes.pixel[l] = next++;
+  }
+
+  // As the scalar kernel starts a pixel
+  lanes.dx[l] = cx;
+  lanes.dy[l] = cy;
+  lanes.cx[l] = cx;
+  lanes.cy[l] = cy;
+  lanes.zx[l] = orbit.re()[0] + cx;
+  lanes.zy[l] = orbit.im()[0] + cy;
+  lanes.r[l] = lanes.zx[l] * lanes.zx[l] + lanes.zy[l] * lanes.zy[l];
+  lanes.rd[l] = cx * cx + cy * cy;
+  lanes.m[l] = 0.0;
+  lanes.i[l] = 0.0;
+  lanes.active[l] = active ? 1.0 : 0.0;
+}
+
+// Gives the same results as the scalar kernel, but rebases with a blend in
+// every iteration, as lanes rebase at different times. The blend puts the
+// rebasing test in the chain of dependent instructions from one iteration to
+// the next, so GROUPS independent vectors of lanes are iterated together to
+// keep the CPU busy while each waits on the last.
+template <class V, int GROUPS>
+static void iterateDeltasSimd(const ReferenceOrbit& orbit, const double* dcx,
+                              const double* dcy, const int* pixels, int n,
+                              int maxIterations, double radius,
+                              PixelResult* out) {
+  typedef typename V::vec vec;
+  typedef typename V::mask mask;
+  const int WIDTH = V::WIDTH;
+  const int LANES = GROUPS * WIDTH;
+
+  const double* re = orbit.re();
+  const double* im = orbit.im();
+  const double* reLo = orbit.reLo();
+  const double* imLo = orbit.imLo();
+
+  const vec zero = V::set1(0.0);
+  const vec half = V::set1(0.5);
+  const vec one = V::set1(1.0);
+  const vec two = V::set1(2.0);
+  const vec minusOne = V::set1(-1.0);
+  const vec length = V::set1(orbit.length());
+  const vec radiusV = V::set1(radius);
+  const vec maxI = V::set1(maxIterations);
+
+  DeltaLanes<LANES> lanes;
+  int next = 0;
+  for (int l = 0; l < LANES; ++l) {
+    startLane(orbit, dcx, dcy, n, next, lanes, l);
+  }
+
+  vec dx[GROUPS], dy[GROUPS], cx[GROUPS], cy[GROUPS], zx[GROUPS], zy[GROUPS];
+  vec r[GROUPS], rd[GROUPS], m[GROUPS], i[GROUPS];
+  // Z_m, carried over from the last iteration
+  vec Zx[GROUPS], Zy[GROUPS];
+  mask active[GROUPS];
+
+  auto load = [&]() {
+    for (int g = 0; g < GROUPS; ++g) {
+      int l = g * WIDTH;
+      dx[g] = V::load(lanes.dx + l);
+      dy[g] = V::load(lanes.dy + l);
+      cx[g] = V::load(lanes.cx + l);
+      cy[g] = V::load(lanes.cy + l);
+      zx[g] = V::load(lanes.zx + l);
+      zy[g] = V::load(lanes.zy + l);
+      r[g] = V::load(lanes.r + l);
+      rd[g] = V::load(lanes.rd + l);
+      m[g] = V::load(lanes.m + l);
+      i[g] = V::load(lanes.i + l);
+      active[g] = V::greater(V::load(lanes.active + l), half);
+      Zx[g] = V::gather(re, m[g]);
+      Zy[g] = V::gather(im, m[g]);
+    }
+  };
+
+  auto store = [&]() {
+    for (int g = 0; g < GROUPS; ++g) {
+      int l = g * WIDTH;
+      V::store(lanes.dx + l, dx[g]);
+      V::store(lanes.dy + l, dy[g]);
+      V::store(lanes.zx + l, zx[g]);
+      V::store(lanes.zy + l, zy[g]);
+      V::store(lanes.r + l, r[g]);
+      V::store(lanes.rd + l, rd[g]);
+      V::store(lanes.m + l, m[g]);
+      V::store(lanes.i + l, i[g]);
+    }
+  };
+
+  load();
+
+  int activeBits = 0;
+  for (int g = 0; g < GROUPS; ++g) {
+    activeBits |= V::bits(active[g]) << (g * WIDTH);
+  }
+
+  while (activeBits != 0) {
+    int finishedBits = 0;
+    int escapedBits = 0;
+
+    for (int g = 0; g < GROUPS; ++g) {
+      // Closer to zero than to the reference, or the reference escaped
+      // before the pixel did
+      mask rebase = V::either(V::less(r[g], rd[g]),
+                              V::notLess(m[g], length));
+      dx[g] = V::blend(rebase, dx[g], zx[g]);
+      dy[g] = V::blend(rebase, dy[g], zy[g]);
+      m[g] = V::blend(rebase, m[g], minusOne);
+      Zx[g] = V::blend(rebase, Zx[g], zero);
+      Zy[g] = V::blend(rebase, Zy[g], zero);
+
+      // As stepDelta. The low parts are 0 at m = -1, so need no blend.
+      vec x = dx[g];
+      vec y = dy[g];
+      vec Lx = V::gather(reLo, m[g]);
+      vec Ly = V::gather(imLo, m[g]);
+      vec xx = V::mul(Zx[g], x);
+      vec yy = V::mul(Zy[g], y);
+      vec xy = V::mul(Zx[g], y);
+      vec yx = V::mul(Zy[g], x);
+      vec xxLo = V::mulSub(Zx[g], x, xx);
+      vec yyLo = V::mulSub(Zy[g], y, yy);
+      vec xyLo = V::mulSub(Zx[g], y, xy);
+      vec yxLo = V::mulSub(Zy[g], x, yx);
+
+      vec nextDx = V::add(
+        V::mul(two, V::sub(xx, yy)),
+        V::add(V::mul(two, V::add(V::sub(xxLo, yyLo),
+                                  V::sub(V::mul(Lx, x), V::mul(Ly, y)))),
+               V::add(V::sub(V::mul(x, x), V::mul(y, y)), cx[g])));
+      vec nextDy = V::add(
+        V::mul(two, V::add(xy, yx)),
+        V::add(V::mul(two, V::add(V::add(xyLo, yxLo),
+                                  V::add(V::mul(Lx, y), V::mul(Ly, x)))),
+               V::add(V::mul(V::mul(two, x), y), cy[g])));
+      dx[g] = nextDx;
+      dy[g] = nextDy;
+      m[g] = V::add(m[g], one);
+
+      Zx[g] = V::gather(re, m[g]);
+      Zy[g] = V::gather(im, m[g]);
+      zx[g] = V::add(Zx[g], dx[g]);
+      zy[g] = V::add(Zy[g], dy[g]);
+      r[g] = V::add(V::mul(zx[g], zx[g]), V::mul(zy[g], zy[g]));
+      rd[g] = V::add(V::mul(dx[g], dx[g]), V::mul(dy[g], dy[g]));
+
+      mask escaped = V::greater(r[g], radiusV);
+      i[g] = V::add(i[g], one);
+      mask finished = V::both(V::either(escaped, V::notLess(i[g], maxI)),
+                              active[g]);
+
+      finishedBits |= V::bits(finished) << (g * WIDTH);
+      escapedBits |= V::bits(escaped) << (g * WIDTH);
+    }
+
+    if (finishedBits == 0) {
+      continue;
+    }
+
+    store();
+
+    for (int l = 0; l < LANES; ++l) {
+      if (!(finishedBits & (1 << l))) {
+        continue;
+      }
+
+      // The scalar kernel counts the iterations before the escaping one
+      float count = (escapedBits & (1 << l))
+                      ? static_cast<float>(lanes.i[l] - 1.0)
+                      : static_cast<float>(maxIterations);
+      out[pixels[lanes.pixel[l]]] =
+        PixelResult{count, static_cast<float>(lanes.zx[l]),
+                    static_cast<float>(lanes.zy[l])};
+
+      startLane(orbit, dcx, dcy, n, next, lanes, l);
+      if (lanes.active[l] == 0.0) {
+        activeBits &= ~(1 << l);
+      }
+    }
+
+    load();
+  }
+}
@@ -1,4 +1,5 @@
 #include <wx/gbsizer.h>
+#include <wx/tokenzr.h>
 #include "export_page.hpp"
 #include "utils.hpp"
 #include "wx_helpers.hpp"
@@ -8,25 +9,65 @@ static const long MIN_EXPORT_WIDTH = 10;
 static const long MAX_EXPORT_WIDTH = 10000;
 static const long MIN_EXPORT_HEIGHT = 10;
 static const long MAX_EXPORT_HEIGHT = 10000;
+static const long DEFAULT_MAX_SAMPLES = 16;
+static const long MIN_MAX_SAMPLES = 1;
+static const long MAX_MAX_SAMPLES = 64;
+static const char* DEFAULT_BATCH_HEIGHTS = "1000, 2000";
 
 wxDEFINE_EVENT(EXPORT_EVENT, ExportEvent);
+wxDEFINE_EVENT(BATCH_EXPORT_EVENT, BatchExportEvent);
+wxDEFINE_EVENT(RESUME_BATCH_EXPORT_EVENT, wxCommandEvent);
+wxDEFINE_EVENT(RECOLOUR_EVENT, RecolourEvent);
 
-ExportEvent::ExportEvent(int w, int h, const wxString& filePath)
+ExportEvent::ExportEvent(int w, int h, int maxSamples,
+                         const wxString& filePath)
   : wxCommandEvent(EXPORT_EVENT),
     w(w),
     h(h),
+    maxSamples(maxSamples),
     filePath(filePath) {}
 
 ExportEvent::ExportEvent(const ExportEvent& cpy)
   : wxCommandEvent(cpy),
     w(cpy.w),
     h(cpy.h),
+    maxSamples(cpy.maxSamples),
     filePath(cpy.filePath) {}
 
 wxEvent* ExportEvent::Clone() const {
   return new ExportEvent(*this);
 }
 
+BatchExportEvent::BatchExportEvent(const std::vector<int>& heights,
+                                   const wxString& dirPath)
+  : wxCommandEvent(BATCH_EXPORT_EVENT),
+    heights(heights),
+    dirPath(dirPath) {}
+
+BatchExportEvent::BatchExportEvent(const BatchExportEvent& cpy)
+  : wxCommandEvent(cpy),
+    heights(cpy.heights),
+    dirPath(cpy.dirPath) {}
+
+wxEvent* BatchExportEvent::Clone() const {
+  return new BatchExportEvent(*this);
+}
+
+RecolourEvent::RecolourEvent(const wxString& dataFilePath,
+                             const wxString& imageFilePath)
+  : wxCommandEvent(RECOLOUR_EVENT),
+    dataFilePath(dataFilePath),
+    imageFilePath(imageFilePath) {}
+
+RecolourEvent::RecolourEvent(const RecolourEvent& cpy)
+  : wxCommandEvent(cpy),
+    dataFilePath(cpy.dataFilePath),
+    imageFilePath(cpy.imageFilePath) {}
+
+wxEvent* RecolourEvent::Clone() const {
+  return new RecolourEvent(*this);
+}
+
 ExportPage::ExportPage(wxWindow* parent)
   : wxNotebookPage(parent, wxID_ANY) {
 
@@ -44,9 +85,24 @@ ExportPage::ExportPage(wxWindow* parent)
   m_txtHeight->SetValidator(wxTextValidator(wxFILTER_DIGITS));
   m_txtHeight->Bind(wxEVT_TEXT, &ExportPage::onExportHeightChange, this);
 
+  auto lblMaxSamples = constructLabel(this,
+                                      wxGetTranslation("Max samples per pixel"));
+  m_txtMaxSamples = constructTextBox(this, std::to_string(DEFAULT_MAX_SAMPLES));
+  m_txtMaxSamples->SetValidator(wxTextValidator(wxFILTER_DIGITS));
+  m_txtMaxSamples->SetToolTip(wxGetTranslation("Pixels in detailed regions "
+                                               "are supersampled up to this "
+                                               "many times. Set to 1 to "
+                                               "disable anti-aliasing."));
+
   m_btnExport = new wxButton(this, wxID_ANY, wxGetTranslation("Export"));
   m_btnExport->Bind(wxEVT_BUTTON, &ExportPage::onExportClick, this);
 
+  m_btnRecolour = new wxButton(this, wxID_ANY, wxGetTranslation("Recolour"));
+  m_btnRecolour->SetToolTip(wxGetTranslation("Colour exported iteration data "
+                                             "with the current colour "
+                                             "scheme"));
+  m_btnRecolour->Bind(wxEVT_BUTTON, &ExportPage::onRecolourClick, this);
+
   m_progressBar = new wxGauge(this, wxID_ANY, 100);
 
   grid->AddSpacer(20);
@@ -55,16 +111,59 @@ ExportPage::ExportPage(wxWindow* parent)
   grid->Add(m_txtWidth, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
   grid->Add(lblHeight, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
   grid->Add(m_txtHeight, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblMaxSamples, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtMaxSamples, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
   grid->AddSpacer(10);
-  grid->Add(m_btnExport, 0, wxEXPAND | wxRIGHT, 10);
+  grid->Add(m_btnExport, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->AddSpacer(10);
+  grid->Add(m_btnRecolour, 0, wxEXPAND | wxRIGHT, 10);
 
   grid->AddGrowableCol(0);
 
   vbox->Add(grid, 0, wxEXPAND | wxBOTTOM, 10);
   vbox->Add(m_progressBar, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM |
                               wxRESERVE_SPACE_EVEN_IF_HIDDEN, 10);
+  vbox->Add(constructBatchPanel(this), 0, wxEXPAND | wxLEFT | wxRIGHT |
+                                          wxBOTTOM, 10);
 
   m_progressBar->Hide();
+  m_btnResumeBatch->Hide();
+}
+
+wxStaticBoxSizer* ExportPage::constructBatchPanel(wxWindow* parent) {
+  auto boxSizer = new wxStaticBoxSizer(wxVERTICAL, parent,
+                                       wxGetTranslation("Batch export"));
+  auto box = boxSizer->GetStaticBox();
+
+  auto grid = new wxFlexGridSizer(2);
+  boxSizer->Add(grid, 1, wxEXPAND);
+
+  auto lblHeights = constructLabel(box, wxGetTranslation("Heights"));
+  m_txtBatchHeights = constructTextBox(box, DEFAULT_BATCH_HEIGHTS);
+
+  m_btnBatchExport = new wxButton(box, wxID_ANY,
+                                  wxGetTranslation("Export favourites"));
+  m_btnBatchExport->Bind(wxEVT_BUTTON, &ExportPage::onBatchExportClick, this);
+
+  m_btnResumeBatch = new wxButton(box, wxID_ANY, wxGetTranslation("Resume"));
+  m_btnResumeBatch->Bind(wxEVT_BUTTON, &ExportPage::onResumeBatchClick, this);
+
+  auto hbox = new wxBoxSizer(wxHORIZONTAL);
+  hbox->AddStretchSpacer();
+  hbox->Add(m_btnResumeBatch, 0, wxRIGHT, 10);
+  hbox->Add(m_btnBatchExport, 0, wxRIGHT, 10);
+
+  grid->AddSpacer(10);
+  grid->AddSpacer(10);
+  grid->Add(lblHeights, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtBatchHeights, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+
+  grid->AddGrowableCol(0);
+  grid->AddGrowableCol(1);
+
+  boxSizer->Add(hbox, 0, wxEXPAND | wxBOTTOM, 10);
+
+  return boxSizer;
 }
 
 void ExportPage::onCanvasSizeChange(int w, int h) {
@@ -104,16 +203,36 @@ void ExportPage::setBusy(bool busy) {
   if (busy) {
     m_progressBar->Show();
     m_btnExport->Disable();
+    m_btnRecolour->Disable();
+    m_btnBatchExport->Disable();
+    m_btnResumeBatch->Disable();
   }
   else {
     m_progressBar->Hide();
     m_btnExport->Enable();
+    m_btnRecolour->Enable();
+    m_btnBatchExport->Enable();
+    m_btnResumeBatch->Enable();
   }
 }
 
+void ExportPage::setResumableJobs(size_t numJobs) {
+  if (numJobs > 0) {
+    m_btnResumeBatch->SetLabel(wxString::Format("%s (%d)",
+                               wxGetTranslation("Resume"),
+                               static_cast<int>(numJobs)));
+  }
+
+  m_btnResumeBatch->Show(numJobs > 0);
+  Layout();
+}
+
 void ExportPage::onExportClick(wxCommandEvent&) {
-  wxFileDialog fileDialog(this, wxGetTranslation("Save as BMP image"), "", "",
-                          "BMP files (*.bmp)|*.bmp", wxFD_SAVE);
+  // Iteration data keeps the escape results, so the render can be recoloured
+  // later without iterating again
+  wxFileDialog fileDialog(this, wxGetTranslation("Export as"), "", "",
+                          "BMP files (*.bmp)|*.bmp|"
+                          "Iteration data (*.mbi)|*.mbi", wxFD_SAVE);
   if (fileDialog.ShowModal() == wxID_CANCEL) {
     return;
   }
@@ -124,10 +243,61 @@ void ExportPage::onExportClick(wxCommandEvent&) {
   long h = getBoundedValue<long>(*m_txtHeight, MIN_EXPORT_HEIGHT,
                                  MAX_EXPORT_HEIGHT);
 
-  ExportEvent event(w, h, fileDialog.GetPath());
+  long maxSamples = getBoundedValue<long>(*m_txtMaxSamples, MIN_MAX_SAMPLES,
+                                          MAX_MAX_SAMPLES);
+
+  ExportEvent event(w, h, maxSamples, fileDialog.GetPath());
+  wxPostEvent(this, event);
+}
+
+void ExportPage::onRecolourClick(wxCommandEvent&) {
+  wxFileDialog openDialog(this, wxGetTranslation("Open iteration data"), "",
+                          "", "Iteration data (*.mbi)|*.mbi",
+                          wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+  if (openDialog.ShowModal() == wxID_CANCEL) {
+    return;
+  }
+
+  wxFileDialog saveDialog(this, wxGetTranslation("Save as BMP image"), "", "",
+                          "BMP files (*.bmp)|*.bmp", wxFD_SAVE);
+  if (saveDialog.ShowModal() == wxID_CANCEL) {
+    return;
+  }
+
+  RecolourEvent event(openDialog.GetPath(), saveDialog.GetPath());
   wxPostEvent(this, event);
 }
 
 void ExportPage::setProgress(int progress) {
   m_progressBar->SetValue(progress);
 }
+
+void ExportPage::onBatchExportClick(wxCommandEvent&) {
+  std::vector<int> heights;
+
+  wxStringTokenizer tokenizer(m_txtBatchHeights->GetValue(), ", ");
+  while (tokenizer.HasMoreTokens()) {
+    long h = 0;
+    if (tokenizer.GetNextToken().ToLong(&h)) {
+      h = std::max(MIN_EXPORT_HEIGHT, std::min(MAX_EXPORT_HEIGHT, h));
+      heights.push_back(h);
+    }
+  }
+
+  if (heights.empty()) {
+    return;
+  }
+
+  wxDirDialog dirDialog(this, wxGetTranslation("Export favourites to"));
+  if (dirDialog.ShowModal() == wxID_CANCEL) {
+    return;
+  }
+
+  BatchExportEvent event(heights, dirDialog.GetPath());
+  wxPostEvent(this, event);
+}
+
+void ExportPage::onResumeBatchClick(wxCommandEvent&) {
+  wxCommandEvent event(RESUME_BATCH_EXPORT_EVENT);
+  wxPostEvent(this, event);
+}
@@ -1,48 +1,88 @@
 #pragma once
 
+#include <vector>
 #include <wx/wx.h>
 #include <wx/notebook.h>
 
 class ExportEvent;
+class BatchExportEvent;
+class RecolourEvent;
 
 wxDECLARE_EVENT(EXPORT_EVENT, ExportEvent);
+wxDECLARE_EVENT(BATCH_EXPORT_EVENT, BatchExportEvent);
+wxDECLARE_EVENT(RESUME_BATCH_EXPORT_EVENT, wxCommandEvent);
+wxDECLARE_EVENT(RECOLOUR_EVENT, RecolourEvent);
 
 class ExportEvent : public wxCommandEvent {
 public:
-  ExportEvent(int w, int h, const wxString& filePath);
+  ExportEvent(int w, int h, int maxSamples, const wxString& filePath);
   ExportEvent(const ExportEvent& cpy);
 
   wxEvent* Clone() const override;
 
   int w;
   int h;
+  int maxSamples;
   wxString filePath;
 };
 
+class BatchExportEvent : public wxCommandEvent {
+public:
+  BatchExportEvent(const std::vector<int>& heights, const wxString& dirPath);
+  BatchExportEvent(const BatchExportEvent& cpy);
+
+  wxEvent* Clone() const override;
+
+  std::vector<int> heights;
+  wxString dirPath;
+};
+
+// Colours a saved iteration data file with the active colour scheme
+class RecolourEvent : public wxCommandEvent {
+public:
+  RecolourEvent(const wxString& dataFilePath, const wxString& imageFilePath);
+  RecolourEvent(const RecolourEvent& cpy);
+
+  wxEvent* Clone() const override;
+
+  wxString dataFilePath;
+  wxString imageFilePath;
+};
+
 class ExportPage : public wxNotebookPage {
 public:
   ExportPage(wxWindow* parent);
 
   void setBusy(bool busy);
   void setProgress(int progress);
+  void setResumableJobs(size_t numJobs);
   void disable();
   void enable();
 
   void onCanvasSizeChange(int w, int h);
 
 private:
+  wxStaticBoxSizer* constructBatchPanel(wxWindow* parent);
   uint8_t* beginExport(int w, int h);
   void endExport(const wxString& exportFilePath, int w, int h, uint8_t* data);
   void adjustExportSize(bool adjustWidth);
 
   void onExportClick(wxCommandEvent& e);
+  void onBatchExportClick(wxCommandEvent& e);
+  void onResumeBatchClick(wxCommandEvent& e);
+  void onRecolourClick(wxCommandEvent& e);
   void onExportHeightChange(wxCommandEvent& e);
   void onExportWidthChange(wxCommandEvent& e);
 
   wxTextCtrl* m_txtWidth;
   wxTextCtrl* m_txtHeight;
+  wxTextCtrl* m_txtMaxSamples;
   wxButton* m_btnExport;
+  wxButton* m_btnRecolour;
   wxGauge* m_progressBar;
+  wxTextCtrl* m_txtBatchHeights;
+  wxButton* m_btnBatchExport;
+  wxButton* m_btnResumeBatch;
   float m_canvasW = 0.f;
   float m_canvasH = 0.f;
 };
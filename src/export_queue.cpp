@@ -0,0 +1,131 @@
+#include <wx/file.h>
+#include <wx/filename.h>
+#include <wx/dir.h>
+#include <wx/xml/xml.h>
+#include "export_queue.hpp"
+#include "utils.hpp"
+
+using std::string;
+
+static const char* STATUS_STRINGS[] = { "pending", "done", "failed" };
+
+static ExportJob::Status parseStatus(const wxString& str) {
+  for (int i = 0; i <= ExportJob::FAILED; ++i) {
+    if (str == STATUS_STRINGS[i]) {
+      return static_cast<ExportJob::Status>(i);
+    }
+  }
+
+  return ExportJob::PENDING;
+}
+
+ExportQueue::ExportQueue() {
+  m_filePath = userDataPath("export_queue.xml");
+}
+
+void ExportQueue::load() {
+  m_jobs.clear();
+
+  if (!wxFile::Exists(m_filePath)) {
+    return;
+  }
+
+  wxXmlDocument doc;
+  if (!doc.Load(m_filePath)) {
+    return;
+  }
+
+  auto xmlJob = doc.GetRoot()->GetChildren();
+  while (xmlJob) {
+    ExportJob job;
+    long w = 0;
+    long h = 0;
+    long maxI = 0;
+
+    job.name = xmlJob->GetAttribute("name").ToStdString();
+    job.x = xmlJob->GetAttribute("x", "0").ToStdString();
+    job.y = xmlJob->GetAttribute("y", "0").ToStdString();
+    job.magnification =
+      xmlJob->GetAttribute("magnification", "1").ToStdString();
+    xmlJob->GetAttribute("w").ToLong(&w);
+    xmlJob->GetAttribute("h").ToLong(&h);
+    xmlJob->GetAttribute("max_iterations").ToLong(&maxI);
+    job.colourScheme = xmlJob->GetAttribute("colour_scheme").ToStdString();
+    job.filePath = xmlJob->GetAttribute("file_path").ToStdString();
+    job.status = parseStatus(xmlJob->GetAttribute("status"));
+
+    job.w = w;
+    job.h = h;
+    job.maxIterations = maxI;
+
+    auto xmlCode = xmlJob->GetChildren();
+    if (xmlCode) {
+      job.computeColourImpl = xmlCode->GetContent().ToStdString();
+    }
+
+    m_jobs.push_back(job);
+
+    xmlJob = xmlJob->GetNext();
+  }
+}
+
+void ExportQueue::save() const {
+  if (!wxFile::Exists(m_filePath)) {
+    wxDir::Make(userDataPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  wxXmlDocument doc;
+  auto root = new wxXmlNode(nullptr, wxXML_ELEMENT_NODE, "export_queue");
+
+  // wxXmlNode prepends children when given a parent, so add in reverse to
+  // preserve the job order
+  for (auto i = m_jobs.rbegin(); i != m_jobs.rend(); ++i) {
+    const ExportJob& job = *i;
+
+    auto xmlJob = new wxXmlNode(root, wxXML_ELEMENT_NODE, "job");
+
+    xmlJob->AddAttribute("name", job.name);
+    xmlJob->AddAttribute("x", job.x);
+    xmlJob->AddAttribute("y", job.y);
+    xmlJob->AddAttribute("magnification", job.magnification);
+    xmlJob->AddAttribute("w", std::to_string(job.w));
+    xmlJob->AddAttribute("h", std::to_string(job.h));
+    xmlJob->AddAttribute("max_iterations", std::to_string(job.maxIterations));
+    xmlJob->AddAttribute("colour_scheme", job.colourScheme);
+    xmlJob->AddAttribute("file_path", job.filePath);
+    xmlJob->AddAttribute("status", STATUS_STRINGS[job.status]);
+    xmlJob->AddChild(new wxXmlNode(nullptr, wxXML_TEXT_NODE, "code",
+                                   job.computeColourImpl));
+  }
+
+  doc.SetRoot(root);
+  doc.Save(m_filePath);
+}
+
+void ExportQueue::setJobs(const std::vector<ExportJob>& jobs) {
+  m_jobs = jobs;
+  save();
+}
+
+void ExportQueue::setJobStatus(size_t idx, ExportJob::Status status) {
+  m_jobs.at(idx).status = status;
+  save();
+}
+
+const ExportJob& ExportQueue::getJob(size_t idx) const {
+  return m_jobs.at(idx);
+}
+
+size_t ExportQueue::numJobs() const {
+  return m_jobs.size();
+}
+
+size_t ExportQueue::numPendingJobs() const {
+  size_t n = 0;
+  for (const ExportJob& job : m_jobs) {
+    if (job.status == ExportJob::PENDING) {
+      ++n;
+    }
+  }
+  return n;
+}
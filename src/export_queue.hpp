@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ExportJob {
+  enum Status {
+    PENDING,
+    DONE,
+    FAILED
+  };
+
+  std::string name;
+  // Decimal strings, so deep locations keep their full precision
+  std::string x = "0";
+  std::string y = "0";
+  std::string magnification = "1";
+  int w = 0;
+  int h = 0;
+  int maxIterations = 0;
+  std::string colourScheme;
+  std::string computeColourImpl;
+  std::string filePath;
+  Status status = PENDING;
+};
+
+// A list of export jobs that is written to disk whenever it changes, so that
+// a batch interrupted by a crash or by closing the app can be resumed.
+class ExportQueue {
+public:
+  ExportQueue();
+
+  void load();
+  void setJobs(const std::vector<ExportJob>& jobs);
+  void setJobStatus(size_t idx, ExportJob::Status status);
+
+  const ExportJob& getJob(size_t idx) const;
+  size_t numJobs() const;
+  size_t numPendingJobs() const;
+
+private:
+  void save() const;
+
+  std::string m_filePath;
+  std::vector<ExportJob> m_jobs;
+};
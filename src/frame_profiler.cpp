@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include "frame_profiler.hpp"
+#include "exception.hpp"
+
+namespace chrono = std::chrono;
+
+// Number of frames kept for percentiles
+static const size_t WINDOW_FRAMES = 300;
+
+// Timer query results are read this many frames after they're issued
+static const size_t QUERY_LATENCY = 4;
+
+static const char* STAGE_NAMES[] = {
+  "Uniforms",
+  "Render",
+  "Texture draw",
+  "Swap"
+};
+
+RollingHistogram::RollingHistogram(size_t capacity)
+  : m_samples(capacity, 0.0) {}
+
+void RollingHistogram::add(double value) {
+  m_samples[m_next] = value;
+  m_next = (m_next + 1) % m_samples.size();
+  m_size = std::min(m_size + 1, m_samples.size());
+}
+
+void RollingHistogram::clear() {
+  m_next = 0;
+  m_size = 0;
+}
+
+size_t RollingHistogram::size() const {
+  return m_size;
+}
+
+double RollingHistogram::latest() const {
+  if (m_size == 0) {
+    return 0.0;
+  }
+
+  return m_samples[(m_next + m_samples.size() - 1) % m_samples.size()];
+}
+
+double RollingHistogram::percentile(double p) const {
+  if (m_size == 0) {
+    return 0.0;
+  }
+
+  std::vector<double> sorted = samples();
+
+  size_t n = static_cast<size_t>(std::ceil(p / 100.0 * m_size));
+  n = std::max<size_t>(n, 1) - 1;
+
+  std::nth_element(sorted.begin(), sorted.begin() + n, sorted.end());
+  return sorted[n];
+}
+
+std::vector<double> RollingHistogram::samples() const {
+  std::vector<double> v;
+  v.reserve(m_size);
+
+  size_t first = (m_next + m_samples.size() - m_size) % m_samples.size();
+  for (size_t i = 0; i < m_size; ++i) {
+    v.push_back(m_samples[(first + i) % m_samples.size()]);
+  }
+
+  return v;
+}
+
+FrameProfiler::FrameProfiler()
+  : m_queries(QUERY_LATENCY),
+    m_queriesIssued(QUERY_LATENCY),
+    m_cpuTimes(NUM_STAGES, RollingHistogram(WINDOW_FRAMES)),
+    m_gpuTimes(NUM_STAGES, RollingHistogram(WINDOW_FRAMES)),
+    m_frameTimes(WINDOW_FRAMES),
+    m_gpuFrameTimes(WINDOW_FRAMES) {
+
+  m_stageCpuTimes.fill(0.0);
+
+  for (auto& issued : m_queriesIssued) {
+    issued.fill(false);
+  }
+}
+
+const char* FrameProfiler::stageName(Stage stage) {
+  return STAGE_NAMES[stage];
+}
+
+void FrameProfiler::initialise() {
+  for (auto& queries : m_queries) {
+    GL_CHECK(glGenQueries(NUM_STAGES, queries.data()));
+  }
+
+  m_initialised = true;
+}
+
+void FrameProfiler::beginFrame() {
+  if (!m_initialised) {
+    return;
+  }
+
+  size_t slot = m_frame % QUERY_LATENCY;
+  collectGpuTimes(slot);
+
+  m_stageCpuTimes.fill(0.0);
+  m_frameStart = Clock::now();
+  m_inFrame = true;
+}
+
+void FrameProfiler::endFrame() {
+  if (!m_inFrame) {
+    return;
+  }
+
+  if (m_activeStage != -1) {
+    endStage(static_cast<Stage>(m_activeStage));
+  }
+
+  chrono::duration<double> frameTime = Clock::now() - m_frameStart;
+  m_frameTimes.add(frameTime.count());
+
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    m_cpuTimes[i].add(m_stageCpuTimes[i]);
+  }
+
+  m_inFrame = false;
+  ++m_frame;
+}
+
+void FrameProfiler::beginStage(Stage stage) {
+  if (!m_inFrame || m_activeStage != -1) {
+    return;
+  }
+
+  size_t slot = m_frame % QUERY_LATENCY;
+
+  // A stage entered twice in one frame only has its first entry timed on
+  // the GPU, as each query can only be used once
+  if (!m_queriesIssued[slot][stage]) {
+    GL_CHECK(glBeginQuery(GL_TIME_ELAPSED, m_queries[slot][stage]));
+  }
+
+  m_activeStage = stage;
+  m_stageStart = Clock::now();
+}
+
+void FrameProfiler::endStage(Stage stage) {
+  if (!m_inFrame || m_activeStage != stage) {
+    return;
+  }
+
+  chrono::duration<double> stageTime = Clock::now() - m_stageStart;
+  m_stageCpuTimes[stage] += stageTime.count();
+
+  size_t slot = m_frame % QUERY_LATENCY;
+
+  if (!m_queriesIssued[slot][stage]) {
+    GL_CHECK(glEndQuery(GL_TIME_ELAPSED));
+    m_queriesIssued[slot][stage] = true;
+  }
+
+  m_activeStage = -1;
+}
+
+void FrameProfiler::collectGpuTimes(size_t slot) {
+  auto& queries = m_queries[slot];
+  auto& issued = m_queriesIssued[slot];
+
+  bool anyIssued = false;
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    if (issued[i]) {
+      anyIssued = true;
+
+      GLint available = 0;
+      GL_CHECK(glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE,
+                                  &available));
+
+      // Drop the frame rather than wait for the GPU
+      if (!available) {
+        issued.fill(false);
+        return;
+      }
+    }
+  }
+
+  if (!anyIssued) {
+    return;
+  }
+
+  double total = 0.0;
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    double t = 0.0;
+
+    if (issued[i]) {
+      GLuint64 ns = 0;
+      GL_CHECK(glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns));
+      t = static_cast<double>(ns) * 1e-9;
+    }
+
+    m_gpuTimes[i].add(t);
+    total += t;
+  }
+
+  m_gpuFrameTimes.add(total);
+  issued.fill(false);
+}
+
+static FrameProfiler::Percentiles percentiles(const RollingHistogram& h) {
+  FrameProfiler::Percentiles p;
+  p.p50 = h.percentile(50.0);
+  p.p95 = h.percentile(95.0);
+  p.p99 = h.percentile(99.0);
+
+  return p;
+}
+
+FrameProfiler::Percentiles FrameProfiler::cpuPercentiles(Stage stage) const {
+  return percentiles(m_cpuTimes[stage]);
+}
+
+FrameProfiler::Percentiles FrameProfiler::gpuPercentiles(Stage stage) const {
+  return percentiles(m_gpuTimes[stage]);
+}
+
+FrameProfiler::Percentiles FrameProfiler::framePercentiles() const {
+  return percentiles(m_frameTimes);
+}
+
+FrameProfiler::Percentiles FrameProfiler::gpuFramePercentiles() const {
+  return percentiles(m_gpuFrameTimes);
+}
+
+double FrameProfiler::latestCpuTime(Stage stage) const {
+  return m_cpuTimes[stage].latest();
+}
+
+double FrameProfiler::latestGpuTime(Stage stage) const {
+  return m_gpuTimes[stage].latest();
+}
+
+std::vector<double> FrameProfiler::frameTimes() const {
+  return m_frameTimes.samples();
+}
+
+std::string FrameProfiler::summary() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(2);
+
+  auto writeRow = [&ss](const std::string& name, const Percentiles& p) {
+    ss << std::left << std::setw(16) << name << std::right
+       << std::setw(8) << p.p50 * 1000.0
+       << std::setw(8) << p.p95 * 1000.0
+       << std::setw(8) << p.p99 * 1000.0 << "\n";
+  };
+
+  ss << std::left << std::setw(16) << "ms" << std::right << std::setw(8)
+     << "p50" << std::setw(8) << "p95" << std::setw(8) << "p99" << "\n";
+
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    Stage stage = static_cast<Stage>(i);
+    writeRow(std::string("CPU ") + stageName(stage), cpuPercentiles(stage));
+  }
+  writeRow("CPU frame", framePercentiles());
+
+  for (int i = 0; i < NUM_STAGES; ++i) {
+    Stage stage = static_cast<Stage>(i);
+    writeRow(std::string("GPU ") + stageName(stage), gpuPercentiles(stage));
+  }
+  writeRow("GPU frame", gpuFramePercentiles());
+
+  return ss.str();
+}
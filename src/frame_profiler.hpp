@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "gl.hpp"
+
+// Holds the most recent samples of a quantity and computes percentiles over
+// them
+class RollingHistogram {
+public:
+  explicit RollingHistogram(size_t capacity);
+
+  void add(double value);
+  void clear();
+
+  size_t size() const;
+  double latest() const;
+  double percentile(double p) const;
+
+  // Samples from oldest to newest
+  std::vector<double> samples() const;
+
+private:
+  std::vector<double> m_samples;
+  size_t m_next = 0;
+  size_t m_size = 0;
+};
+
+// Records CPU and GPU time spent in each stage of an interactive frame.
+// GPU times come from timer queries, which are read a few frames late so
+// that collecting them never stalls the pipeline.
+class FrameProfiler {
+public:
+  enum Stage {
+    UNIFORMS,
+    RENDER,
+    DRAW_TEXTURE,
+    SWAP,
+    NUM_STAGES
+  };
+
+  struct Percentiles {
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+  };
+
+  FrameProfiler();
+
+  static const char* stageName(Stage stage);
+
+  // Must be called with a GL context current
+  void initialise();
+
+  void beginFrame();
+  void endFrame();
+
+  // Stages may not overlap. Calls outside a frame are ignored, so offline
+  // renders aren't counted.
+  void beginStage(Stage stage);
+  void endStage(Stage stage);
+
+  // Times are in seconds
+  Percentiles cpuPercentiles(Stage stage) const;
+  Percentiles gpuPercentiles(Stage stage) const;
+  Percentiles framePercentiles() const;
+  Percentiles gpuFramePercentiles() const;
+  double latestCpuTime(Stage stage) const;
+  double latestGpuTime(Stage stage) const;
+  std::vector<double> frameTimes() const;
+
+  std::string summary() const;
+
+private:
+  typedef std::chrono::high_resolution_clock Clock;
+
+  void collectGpuTimes(size_t slot);
+
+  bool m_initialised = false;
+  bool m_inFrame = false;
+  long long m_frame = 0;
+  int m_activeStage = -1;
+
+  Clock::time_point m_frameStart;
+  Clock::time_point m_stageStart;
+  std::array<double, NUM_STAGES> m_stageCpuTimes;
+
+  // One set of queries per frame in flight
+  std::vector<std::array<GLuint, NUM_STAGES>> m_queries;
+  std::vector<std::array<bool, NUM_STAGES>> m_queriesIssued;
+
+  std::vector<RollingHistogram> m_cpuTimes;
+  std::vector<RollingHistogram> m_gpuTimes;
+  RollingHistogram m_frameTimes;
+  RollingHistogram m_gpuFrameTimes;
+};
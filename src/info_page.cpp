@@ -4,6 +4,10 @@
 #include "wx_helpers.hpp"
 #include "renderer.hpp"
 
+// The performance panel is refreshed every this many frames, as relaying out
+// the page every frame would itself show up in the frame times
+static const int PERFORMANCE_UPDATE_INTERVAL = 15;
+
 InfoPage::InfoPage(wxWindow* parent)
   : wxNotebookPage(parent, wxID_ANY) {
 
@@ -11,6 +15,8 @@ InfoPage::InfoPage(wxWindow* parent)
   vbox->Add(constructInfoPanel(this), 1, wxEXPAND | wxALL, 10);
   vbox->Add(constructDataPanel(this), 1, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM,
             10);
+  vbox->Add(constructPerformancePanel(this), 0, wxEXPAND | wxLEFT | wxRIGHT |
+                                                wxBOTTOM, 10);
 
   SetSizer(vbox);
 }
@@ -65,6 +71,8 @@ wxWindow* InfoPage::constructInfoPanel(wxWindow* parent) {
   addText("Zoom in");
   addText("O   ", false, false, true);
   addText("Zoom out");
+  addText("H   ", false, false, true);
+  addText("Toggle performance overlay");
 
   return txtInfo;
 }
@@ -80,41 +88,72 @@ wxStaticBoxSizer* InfoPage::constructDataPanel(wxWindow* parent) {
   auto lblMagLevel = constructLabel(box, wxGetTranslation("Magnification"));
   m_txtMagLevel = constructLabel(box, "");
 
-  auto lblXMin = constructLabel(box, "x-min");
-  m_txtXMin = constructLabel(box, "");
+  auto lblPrecision = constructLabel(box, wxGetTranslation("Precision"));
+  m_txtPrecision = constructLabel(box, "");
 
-  auto lblXMax = constructLabel(box, "x-max");
-  m_txtXMax = constructLabel(box, "");
+  auto lblViewPrecision = constructLabel(box,
+                                        wxGetTranslation("View precision"));
+  m_txtViewPrecision = constructLabel(box, "");
 
-  auto lblYMin = constructLabel(box, "y-min");
-  m_txtYMin = constructLabel(box, "");
+  auto lblX = constructLabel(box, "x");
+  m_txtX = constructLabel(box, "");
 
-  auto lblYMax = constructLabel(box, "y-max");
-  m_txtYMax = constructLabel(box, "");
+  auto lblY = constructLabel(box, "y");
+  m_txtY = constructLabel(box, "");
 
   grid->AddSpacer(10);
   grid->AddSpacer(10);
   grid->Add(lblMagLevel, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
   grid->Add(m_txtMagLevel, 0, wxEXPAND | wxRIGHT, 10);
-  grid->Add(lblXMin, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
-  grid->Add(m_txtXMin, 1, wxEXPAND, 10);
-  grid->Add(lblXMax, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
-  grid->Add(m_txtXMax, 1, wxEXPAND, 10);
-  grid->Add(lblYMin, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
-  grid->Add(m_txtYMin, 1, wxEXPAND, 10);
-  grid->Add(lblYMax, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
-  grid->Add(m_txtYMax, 0, wxEXPAND | wxRIGHT, 10);
+  grid->Add(lblPrecision, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
+  grid->Add(m_txtPrecision, 0, wxEXPAND | wxRIGHT, 10);
+  grid->Add(lblViewPrecision, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
+  grid->Add(m_txtViewPrecision, 0, wxEXPAND | wxRIGHT, 10);
+  grid->Add(lblX, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
+  grid->Add(m_txtX, 1, wxEXPAND, 10);
+  grid->Add(lblY, 0, wxEXPAND | wxLEFT | wxRIGHT, 10);
+  grid->Add(m_txtY, 1, wxEXPAND, 10);
 
   grid->AddGrowableCol(1);
 
   return boxSizer;
 }
 
+wxStaticBoxSizer* InfoPage::constructPerformancePanel(wxWindow* parent) {
+  auto boxSizer = new wxStaticBoxSizer(wxVERTICAL, parent,
+                                       wxGetTranslation("Frame times"));
+  auto box = boxSizer->GetStaticBox();
+
+  wxFont font(9, wxFONTFAMILY_TELETYPE, wxFONTSTYLE_NORMAL,
+              wxFONTWEIGHT_NORMAL);
+
+  m_txtPerformance = constructLabel(box, "");
+  m_txtPerformance->SetFont(font);
+
+  boxSizer->Add(m_txtPerformance, 0, wxEXPAND | wxALL, 10);
+
+  return boxSizer;
+}
+
 void InfoPage::onRender(const Renderer& renderer) {
-  auto magLevel = numberToString(renderer.computeMagnification(), true);
-  m_txtMagLevel->SetLabel(magLevel);
-  m_txtXMin->SetLabel(numberToString(renderer.getXMin(), true));
-  m_txtXMax->SetLabel(numberToString(renderer.getXMax(), true));
-  m_txtYMin->SetLabel(numberToString(renderer.getYMin(), true));
-  m_txtYMax->SetLabel(numberToString(renderer.getYMax(), true));
+  const View& view = renderer.getView();
+
+  m_txtMagLevel->SetLabel(view.magnificationString());
+  if (renderer.usingPerturbation()) {
+    m_txtPrecision->SetLabel(wxGetTranslation("Perturbation"));
+  }
+  else {
+    m_txtPrecision->SetLabel(renderer.usingDoublePrecision() ?
+                             wxGetTranslation("Double") :
+                             wxGetTranslation("Single"));
+  }
+  m_txtViewPrecision->SetLabel(wxString::Format(wxGetTranslation("%lu bits"),
+                                                view.precisionBits()));
+  m_txtX->SetLabel(view.xString());
+  m_txtY->SetLabel(view.yString());
+
+  if (m_numRenders++ % PERFORMANCE_UPDATE_INTERVAL == 0) {
+    m_txtPerformance->SetLabel(renderer.profiler().summary());
+    Layout();
+  }
 }
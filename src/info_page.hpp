@@ -14,10 +14,13 @@ public:
 private:
   wxWindow* constructInfoPanel(wxWindow* parent);
   wxStaticBoxSizer* constructDataPanel(wxWindow* parent);
+  wxStaticBoxSizer* constructPerformancePanel(wxWindow* parent);
 
   wxStaticText* m_txtMagLevel;
-  wxStaticText* m_txtXMin;
-  wxStaticText* m_txtXMax;
-  wxStaticText* m_txtYMin;
-  wxStaticText* m_txtYMax;
+  wxStaticText* m_txtPrecision;
+  wxStaticText* m_txtViewPrecision;
+  wxStaticText* m_txtX;
+  wxStaticText* m_txtY;
+  wxStaticText* m_txtPerformance;
+  long long m_numRenders = 0;
 };
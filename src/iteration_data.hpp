@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+// Each iterates z -> f(z)^power + c, starting from z = c
+enum Formula {
+  MANDELBROT,
+  // f(x + iy) = |x| + i|y|
+  BURNING_SHIP,
+  // f(z) = conj(z)
+  TRICORN,
+  NUM_FORMULAS
+};
+
+const int MIN_POWER = 2;
+const int MAX_POWER = 8;
+
+struct IterationParams {
+  int w = 0;
+  int h = 0;
+  int maxIterations = 0;
+  double xmin = 0.0;
+  double xmax = 0.0;
+  double ymin = 0.0;
+  double ymax = 0.0;
+  Formula formula = MANDELBROT;
+  int power = 2;
+  // If false, points bail out as soon as they're known to escape and the
+  // final z isn't stored. Iteration counts are then lower than the shader's.
+  bool smooth = true;
+};
+
+// Stored as floats so a frame can be uploaded directly as an RGB32F texture
+struct PixelResult {
+  float i;
+  float zx;
+  float zy;
+};
+
+// Per-pixel escape results, bottom row first to match GL texture layout
+struct IterationData {
+  IterationData() {}
+  IterationData(int w, int h)
+    : w(w),
+      h(h),
+      pixels(w * h) {}
+
+  int w = 0;
+  int h = 0;
+  int maxIterations = 0;
+  std::vector<PixelResult> pixels;
+};
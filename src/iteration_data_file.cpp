@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+#include "iteration_data_file.hpp"
+#include "thread_pool.hpp"
+
+#ifdef WIN32
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using std::string;
+
+static const char MAGIC[4] = { 'M', 'B', 'I', 'D' };
+static const uint32_t VERSION = 2;
+
+// Uncompressed size to aim for per chunk. Large enough for zlib to find
+// repetition across rows, small enough that every thread gets work.
+static const size_t CHUNK_BYTES = 1 << 20;
+
+// Fields are stored in host byte order, which is little endian on every
+// supported platform. The view's centre follows as two decimal strings of
+// xLength and yLength bytes, as it can need more precision than a double.
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t w;
+  uint32_t h;
+  uint32_t maxIterations;
+  uint32_t formula;
+  uint32_t power;
+  uint32_t smooth;
+  double log2Height;
+  uint32_t xLength;
+  uint32_t yLength;
+  uint32_t chunkRows;
+  uint32_t numChunks;
+};
+
+static_assert(sizeof(FileHeader) == 56, "Unexpected padding in FileHeader");
+
+// Follows the centre, one per chunk, padded to start on a multiple of 8
+// bytes. Offsets are from the start of the file.
+struct ChunkEntry {
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(PixelResult) == 12, "Unexpected padding in PixelResult");
+
+// Groups byte k of every value together. Neighbouring pixels have similar
+// exponents and high mantissa bytes, so this leaves long runs for zlib.
+static void shuffle(const PixelResult* pixels, size_t n, uint8_t* dst) {
+  const uint8_t* src = reinterpret_cast<const uint8_t*>(pixels);
+
+  for (size_t k = 0; k < sizeof(PixelResult); ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      dst[k * n + i] = src[i * sizeof(PixelResult) + k];
+    }
+  }
+}
+
+static void unshuffle(const uint8_t* src, size_t n, PixelResult* pixels) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(pixels);
+
+  for (size_t k = 0; k < sizeof(PixelResult); ++k) {
+    for (size_t i = 0; i < n; ++i) {
+      dst[i * sizeof(PixelResult) + k] = src[k * n + i];
+    }
+  }
+}
+
+static uint64_t tableOffset(uint64_t xLength, uint64_t yLength) {
+  return (sizeof(FileHeader) + xLength + yLength + 7) / 8 * 8;
+}
+
+static int rowsInChunk(int chunk, int chunkRows, int h) {
+  return std::min(chunkRows, h - chunk * chunkRows);
+}
+
+// Calls fn(chunk) for each chunk, spread across the pool
+template<typename F>
+static void forEachChunk(int numChunks, ThreadPool& threads, F fn) {
+  std::atomic<int> nextChunk(0);
+
+  auto work = [&]() {
+    int chunk = 0;
+    while ((chunk = nextChunk++) < numChunks) {
+      fn(chunk);
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  for (unsigned int i = 0; i < threads.numThreads(); ++i) {
+    tasks.push_back(threads.run(work));
+  }
+
+  // Wait for all of them before rethrowing, as they reference locals
+  std::exception_ptr error;
+  for (auto& task : tasks) {
+    try {
+      task.get();
+    }
+    catch (...) {
+      error = std::current_exception();
+    }
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void saveIterationData(const string& filePath, const IterationParams& params,
+                       const View& view, const IterationData& data,
+                       ThreadPool& threads) {
+  if (data.w != params.w || data.h != params.h || data.w <= 0 ||
+      data.h <= 0) {
+
+    throw std::runtime_error("Iteration data doesn't match its parameters");
+  }
+
+  size_t rowBytes = data.w * sizeof(PixelResult);
+  int chunkRows = static_cast<int>(std::max<size_t>(1,
+                                                    CHUNK_BYTES / rowBytes));
+  int numChunks = (data.h + chunkRows - 1) / chunkRows;
+
+  std::vector<std::vector<uint8_t>> chunks(numChunks);
+
+  forEachChunk(numChunks, threads, [&](int chunk) {
+    size_t n = static_cast<size_t>(rowsInChunk(chunk, chunkRows, data.h)) *
+               data.w;
+    size_t rawSize = n * sizeof(PixelResult);
+
+    std::vector<uint8_t> raw(rawSize);
+    shuffle(data.pixels.data() + chunk * chunkRows * data.w, n, raw.data());
+
+    uLongf size = compressBound(rawSize);
+    chunks[chunk].resize(size);
+
+    if (compress2(chunks[chunk].data(), &size, raw.data(), rawSize,
+                  Z_DEFAULT_COMPRESSION) != Z_OK) {
+
+      throw std::runtime_error("Error compressing iteration data");
+    }
+
+    chunks[chunk].resize(size);
+  });
+
+  FileHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.w = params.w;
+  header.h = params.h;
+  header.maxIterations = params.maxIterations;
+  header.formula = params.formula;
+  header.power = params.power;
+  header.smooth = params.smooth;
+  string x = view.xString();
+  string y = view.yString();
+  header.log2Height = view.log2Height();
+  header.xLength = x.size();
+  header.yLength = y.size();
+  header.chunkRows = chunkRows;
+  header.numChunks = numChunks;
+
+  uint64_t tableStart = tableOffset(x.size(), y.size());
+  string padding(tableStart - sizeof(FileHeader) - x.size() - y.size(),
+                 '\0');
+
+  std::vector<ChunkEntry> table(numChunks);
+  uint64_t offset = tableStart + numChunks * sizeof(ChunkEntry);
+
+  for (int i = 0; i < numChunks; ++i) {
+    table[i].offset = offset;
+    table[i].size = chunks[i].size();
+    offset += chunks[i].size();
+  }
+
+  std::ofstream fout(filePath, std::ios::binary);
+  fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  fout << x << y << padding;
+  fout.write(reinterpret_cast<const char*>(table.data()),
+             table.size() * sizeof(ChunkEntry));
+
+  for (auto& chunk : chunks) {
+    fout.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+  }
+
+  if (!fout.good()) {
+    throw std::runtime_error("Error writing " + filePath);
+  }
+}
+
+IterationDataFile::IterationDataFile(const string& filePath) {
+#ifdef WIN32
+  m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                       nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    m_file = nullptr;
+    throw std::runtime_error("Couldn't open " + filePath);
+  }
+
+  LARGE_INTEGER size;
+  GetFileSizeEx(m_file, &size);
+  m_size = static_cast<size_t>(size.QuadPart);
+
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0,
+                                 nullptr);
+  if (m_mapping != nullptr) {
+    m_bytes = static_cast<const uint8_t*>(MapViewOfFile(m_mapping,
+                                                        FILE_MAP_READ, 0, 0,
+                                                        0));
+  }
+#else
+  int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("Couldn't open " + filePath);
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    m_size = static_cast<size_t>(st.st_size);
+
+    void* p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      m_bytes = static_cast<const uint8_t*>(p);
+    }
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+#endif
+
+  if (m_bytes == nullptr) {
+    unmap();
+    throw std::runtime_error("Couldn't map " + filePath);
+  }
+
+  auto invalid = [&]() {
+    unmap();
+    throw std::runtime_error(filePath + " isn't a valid iteration data file");
+  };
+
+  if (m_size < sizeof(FileHeader)) {
+    invalid();
+  }
+
+  FileHeader header;
+  std::memcpy(&header, m_bytes, sizeof(header));
+
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != VERSION ||
+      header.w == 0 || header.h == 0 ||
+      header.formula >= NUM_FORMULAS ||
+      !std::isfinite(header.log2Height) ||
+      header.chunkRows == 0 ||
+      header.numChunks != (header.h + header.chunkRows - 1) /
+                          header.chunkRows) {
+    invalid();
+  }
+
+  uint64_t tableStart = tableOffset(header.xLength, header.yLength);
+  uint64_t tableEnd = tableStart +
+                      static_cast<uint64_t>(header.numChunks) *
+                      sizeof(ChunkEntry);
+  if (tableEnd > m_size) {
+    invalid();
+  }
+
+  const char* centre = reinterpret_cast<const char*>(m_bytes) +
+                       sizeof(FileHeader);
+  try {
+    m_view = View::fromStrings(string(centre, header.xLength),
+                               string(centre + header.xLength,
+                                      header.yLength),
+                               header.log2Height);
+  }
+  catch (const std::invalid_argument&) {
+    invalid();
+  }
+
+  const ChunkEntry* table =
+    reinterpret_cast<const ChunkEntry*>(m_bytes + tableStart);
+
+  for (uint32_t i = 0; i < header.numChunks; ++i) {
+    if (table[i].offset < tableEnd || table[i].offset > m_size ||
+        table[i].size > m_size - table[i].offset) {
+      invalid();
+    }
+  }
+
+  m_params.w = header.w;
+  m_params.h = header.h;
+  m_params.maxIterations = header.maxIterations;
+  m_params.formula = static_cast<Formula>(header.formula);
+  m_params.power = header.power;
+  m_params.smooth = header.smooth != 0;
+  m_view.getBounds(static_cast<double>(header.w) / header.h, m_params.xmin,
+                   m_params.xmax, m_params.ymin, m_params.ymax);
+  m_chunkRows = header.chunkRows;
+  m_numChunks = header.numChunks;
+  m_tableStart = tableStart;
+}
+
+IterationDataFile::~IterationDataFile() {
+  unmap();
+}
+
+void IterationDataFile::unmap() {
+#ifdef WIN32
+  if (m_bytes != nullptr) {
+    UnmapViewOfFile(m_bytes);
+  }
+  if (m_mapping != nullptr) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != nullptr) {
+    CloseHandle(m_file);
+  }
+  m_mapping = nullptr;
+  m_file = nullptr;
+#else
+  if (m_bytes != nullptr) {
+    munmap(const_cast<uint8_t*>(m_bytes), m_size);
+  }
+#endif
+  m_bytes = nullptr;
+  m_size = 0;
+}
+
+const IterationParams& IterationDataFile::params() const {
+  return m_params;
+}
+
+const View& IterationDataFile::view() const {
+  return m_view;
+}
+
+void IterationDataFile::load(IterationData& data, ThreadPool& threads) const {
+  int w = m_params.w;
+  int h = m_params.h;
+
+  if (data.w != w || data.h != h) {
+    data = IterationData(w, h);
+  }
+  data.maxIterations = m_params.maxIterations;
+
+  const ChunkEntry* table =
+    reinterpret_cast<const ChunkEntry*>(m_bytes + m_tableStart);
+
+  forEachChunk(m_numChunks, threads, [&](int chunk) {
+    size_t n = static_cast<size_t>(rowsInChunk(chunk, m_chunkRows, h)) * w;
+    uLongf rawSize = n * sizeof(PixelResult);
+
+    std::vector<uint8_t> raw(rawSize);
+    uLongf size = rawSize;
+
+    if (uncompress(raw.data(), &size, m_bytes + table[chunk].offset,
+                   table[chunk].size) != Z_OK || size != rawSize) {
+
+      throw std::runtime_error("Corrupt chunk in iteration data file");
+    }
+
+    unshuffle(raw.data(), n, data.pixels.data() + chunk * m_chunkRows * w);
+  });
+}
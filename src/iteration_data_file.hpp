@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "iteration_data.hpp"
+#include "view.hpp"
+
+class ThreadPool;
+
+// Raw escape results of a render, saved so it can be recoloured later
+// without iterating again. The file holds a header with the view and engine
+// parameters, then the pixels in chunks of rows, each compressed separately
+// so they can be written and read in parallel.
+//
+// Writes data, which must have the dimensions given in params, to filePath.
+// The view is stored in full rather than the bounds in params, which can't
+// tell deep pixels apart. Throws std::runtime_error on failure.
+void saveIterationData(const std::string& filePath,
+                       const IterationParams& params, const View& view,
+                       const IterationData& data, ThreadPool& threads);
+
+// A saved render, memory mapped so chunks are paged in straight from the
+// file as they're decompressed
+class IterationDataFile {
+public:
+  // Throws std::runtime_error if the file can't be mapped or isn't valid
+  explicit IterationDataFile(const std::string& filePath);
+  ~IterationDataFile();
+
+  IterationDataFile(const IterationDataFile&) = delete;
+  IterationDataFile& operator=(const IterationDataFile&) = delete;
+
+  // The bounds are approximate once the view is too deep for doubles
+  const IterationParams& params() const;
+  const View& view() const;
+
+  // Decompresses every chunk into data
+  void load(IterationData& data, ThreadPool& threads) const;
+
+private:
+  void unmap();
+
+  IterationParams m_params;
+  View m_view;
+  int m_chunkRows = 0;
+  uint64_t m_tableStart = 0;
+  int m_numChunks = 0;
+  const uint8_t* m_bytes = nullptr;
+  size_t m_size = 0;
+#ifdef WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
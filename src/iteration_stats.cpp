@@ -0,0 +1,89 @@
+#include <algorithm>
+#include "iteration_stats.hpp"
+
+// Raise the limit while more than this fraction of pixels escape in the top
+// half of the range
+static const double RAISE_FRACTION = 0.001;
+
+// Lower it while fewer than this fraction escape above a quarter of it. Well
+// below RAISE_FRACTION, so a change in one direction never immediately
+// triggers one in the other.
+static const double LOWER_FRACTION = 0.0001;
+
+static int bucket(float i, int maxIterations) {
+  int b = 0;
+  float upper = maxIterations * 0.5f;
+
+  while (i < upper && b < IterationStats::NUM_BUCKETS - 1) {
+    upper *= 0.5f;
+    ++b;
+  }
+
+  return b;
+}
+
+IterationStats IterationStats::fromOrbitState(const float* state, int w, int h,
+                                              int maxIterations) {
+  IterationStats stats;
+  stats.maxIterations = maxIterations;
+  stats.samples = static_cast<size_t>(w) * h;
+  stats.histogram.assign(NUM_BUCKETS, 0);
+
+  auto escaped = [&](int x, int y) {
+    return state[(y * w + x) * 4 + 3] > 0.5f;
+  };
+
+  size_t numEscaped = 0;
+  size_t numCappedBoundary = 0;
+
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      if (escaped(x, y)) {
+        ++numEscaped;
+
+        float i = state[(y * w + x) * 4 + 2];
+        ++stats.histogram[bucket(i, maxIterations)];
+      }
+      else {
+        bool boundary = (x > 0 && escaped(x - 1, y)) ||
+                        (x + 1 < w && escaped(x + 1, y)) ||
+                        (y > 0 && escaped(x, y - 1)) ||
+                        (y + 1 < h && escaped(x, y + 1));
+        if (boundary) {
+          ++numCappedBoundary;
+        }
+      }
+    }
+  }
+
+  if (stats.samples > 0) {
+    stats.escapedFraction = static_cast<double>(numEscaped) / stats.samples;
+    stats.cappedBoundaryFraction = static_cast<double>(numCappedBoundary) /
+                                   stats.samples;
+  }
+
+  return stats;
+}
+
+int IterationStats::suggestMaxIterations(int lowerLimit,
+                                         int upperLimit) const {
+  if (samples == 0) {
+    return maxIterations;
+  }
+
+  double topHalf = static_cast<double>(histogram[0]) / samples;
+  // Buckets 0 and 1 together hold [maxI / 4, maxI)
+  double aboveQuarter = static_cast<double>(histogram[0] + histogram[1]) /
+                        samples;
+
+  int suggested = maxIterations;
+
+  if (cappedBoundaryFraction > 0.0 && topHalf > RAISE_FRACTION) {
+    suggested = maxIterations * 2;
+  }
+  else if (aboveQuarter < LOWER_FRACTION) {
+    suggested = maxIterations / 2;
+  }
+
+  return std::max(lowerLimit, std::min(upperLimit, suggested));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Summary of one frame's escape results, used to choose the iteration limit
+struct IterationStats {
+  // Escaped pixels by iteration count relative to the limit. Bucket b holds
+  // counts in [maxI / 2^(b + 1), maxI / 2^b), and the last bucket everything
+  // below that.
+  static const int NUM_BUCKETS = 16;
+
+  // state holds w * h RGBA values as written by the shader: final z,
+  // iteration count, and 1 if the point escaped
+  static IterationStats fromOrbitState(const float* state, int w, int h,
+                                       int maxIterations);
+
+  // The limit to render the next frame at. Doubles it while a significant
+  // fraction of pixels escape in the top half of the range next to capped
+  // ones, and halves it while almost none escape above a quarter of it, so
+  // the image resolves without iterating interior points needlessly.
+  int suggestMaxIterations(int lowerLimit, int upperLimit) const;
+
+  int maxIterations = 0;
+  size_t samples = 0;
+  double escapedFraction = 0.0;
+  // Pixels that hit the limit next to one that escaped, as a fraction of all
+  // samples. These are where a higher limit could change the image.
+  double cappedBoundaryFraction = 0.0;
+  std::vector<size_t> histogram;
+};
@@ -0,0 +1,312 @@
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <zlib.h>
+#include "location_store.hpp"
+
+using std::string;
+
+static const char MAGIC[8] = { 'M', 'B', 'L', 'O', 'C', 'D', 'B', '1' };
+
+// Each record is its payload size and CRC-32, then the payload: an op code
+// followed by length-prefixed strings
+static const size_t FRAME_HEADER_SIZE = 8;
+
+enum Op : uint8_t {
+  PUT = 1,
+  REMOVE = 2
+};
+
+// Once there are more dead records than this, and more than live ones, the
+// log is rewritten on open
+static const size_t COMPACT_THRESHOLD = 256;
+
+static void writeU32(string& dst, uint32_t v) {
+  dst.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+static void writeString(string& dst, const string& s) {
+  writeU32(dst, static_cast<uint32_t>(s.size()));
+  dst.append(s);
+}
+
+// Reads fields from a payload, throwing if it runs off the end
+class PayloadReader {
+public:
+  explicit PayloadReader(const string& payload)
+    : m_payload(payload) {}
+
+  uint8_t readU8() {
+    need(1);
+    return static_cast<uint8_t>(m_payload[m_pos++]);
+  }
+
+  uint32_t readU32() {
+    need(sizeof(uint32_t));
+    uint32_t v;
+    std::memcpy(&v, m_payload.data() + m_pos, sizeof(v));
+    m_pos += sizeof(v);
+    return v;
+  }
+
+  string readString() {
+    uint32_t n = readU32();
+    need(n);
+    string s = m_payload.substr(m_pos, n);
+    m_pos += n;
+    return s;
+  }
+
+private:
+  void need(size_t n) const {
+    if (m_payload.size() - m_pos < n) {
+      throw std::runtime_error("Truncated location record");
+    }
+  }
+
+  const string& m_payload;
+  size_t m_pos = 0;
+};
+
+static string encodePut(const LocationStore::Record& record) {
+  string payload;
+  payload.push_back(PUT);
+  writeString(payload, record.name);
+  writeString(payload, record.x);
+  writeString(payload, record.y);
+  writeString(payload, record.magnification);
+  writeU32(payload, static_cast<uint32_t>(record.tags.size()));
+
+  for (auto& tag : record.tags) {
+    writeString(payload, tag);
+  }
+
+  return payload;
+}
+
+static string encodeRemove(const string& name) {
+  string payload;
+  payload.push_back(REMOVE);
+  writeString(payload, name);
+
+  return payload;
+}
+
+static string frame(const string& payload) {
+  uint32_t crc = crc32(0, reinterpret_cast<const Bytef*>(payload.data()),
+                       static_cast<uInt>(payload.size()));
+
+  string f;
+  writeU32(f, static_cast<uint32_t>(payload.size()));
+  writeU32(f, crc);
+  f.append(payload);
+
+  return f;
+}
+
+LocationStore::LocationStore(const string& filePath)
+  : m_filePath(filePath) {
+
+  load();
+  open();
+}
+
+void LocationStore::load() {
+  std::ifstream fin(m_filePath, std::ios::binary);
+
+  if (!fin.good()) {
+    compact();
+    return;
+  }
+
+  std::stringstream ss;
+  ss << fin.rdbuf();
+  string bytes = ss.str();
+
+  if (bytes.size() < sizeof(MAGIC) ||
+      std::memcmp(bytes.data(), MAGIC, sizeof(MAGIC)) != 0) {
+
+    throw std::runtime_error(m_filePath + " isn't a location store");
+  }
+
+  size_t pos = sizeof(MAGIC);
+  size_t numRecords = 0;
+
+  while (bytes.size() - pos >= FRAME_HEADER_SIZE) {
+    uint32_t size = 0;
+    uint32_t crc = 0;
+    std::memcpy(&size, bytes.data() + pos, sizeof(size));
+    std::memcpy(&crc, bytes.data() + pos + sizeof(size), sizeof(crc));
+
+    if (bytes.size() - pos - FRAME_HEADER_SIZE < size) {
+      break;
+    }
+
+    string payload = bytes.substr(pos + FRAME_HEADER_SIZE, size);
+    uint32_t actualCrc = crc32(0,
+                               reinterpret_cast<const Bytef*>(payload.data()),
+                               static_cast<uInt>(payload.size()));
+    if (actualCrc != crc) {
+      break;
+    }
+
+    try {
+      apply(payload);
+    }
+    catch (const std::runtime_error&) {
+      break;
+    }
+
+    pos += FRAME_HEADER_SIZE + size;
+    ++numRecords;
+  }
+
+  m_deadRecords = numRecords - m_records.size();
+
+  // Anything after the last good record is from an interrupted write
+  bool tornTail = pos != bytes.size();
+
+  if (tornTail || (m_deadRecords > COMPACT_THRESHOLD &&
+                   m_deadRecords > m_records.size())) {
+    compact();
+  }
+}
+
+// Rewrites the log with only the live records
+void LocationStore::compact() {
+  string tmpPath = m_filePath + ".tmp";
+
+  {
+    std::ofstream fout(tmpPath, std::ios::binary | std::ios::trunc);
+    fout.write(MAGIC, sizeof(MAGIC));
+
+    for (auto& entry : m_records) {
+      string f = frame(encodePut(entry.second));
+      fout.write(f.data(), f.size());
+    }
+
+    if (!fout.good()) {
+      throw std::runtime_error("Error writing " + tmpPath);
+    }
+  }
+
+  std::remove(m_filePath.c_str());
+  if (std::rename(tmpPath.c_str(), m_filePath.c_str()) != 0) {
+    throw std::runtime_error("Error replacing " + m_filePath);
+  }
+
+  m_deadRecords = 0;
+}
+
+void LocationStore::open() {
+  m_file.open(m_filePath, std::ios::binary | std::ios::app);
+
+  if (!m_file.good()) {
+    throw std::runtime_error("Error opening " + m_filePath);
+  }
+}
+
+void LocationStore::append(const string& payload) {
+  string f = frame(payload);
+
+  m_file.write(f.data(), f.size());
+  m_file.flush();
+
+  if (!m_file.good()) {
+    throw std::runtime_error("Error writing " + m_filePath);
+  }
+}
+
+void LocationStore::apply(const string& payload) {
+  PayloadReader reader(payload);
+  uint8_t op = reader.readU8();
+
+  if (op == PUT) {
+    Record record;
+    record.name = reader.readString();
+    record.x = reader.readString();
+    record.y = reader.readString();
+    record.magnification = reader.readString();
+
+    uint32_t numTags = reader.readU32();
+    for (uint32_t i = 0; i < numTags; ++i) {
+      record.tags.push_back(reader.readString());
+    }
+
+    insert(record);
+  }
+  else if (op == REMOVE) {
+    erase(reader.readString());
+  }
+  else {
+    throw std::runtime_error("Unknown location record");
+  }
+}
+
+void LocationStore::insert(const Record& record) {
+  erase(record.name);
+
+  m_records[record.name] = record;
+  for (auto& tag : record.tags) {
+    m_tags[tag].insert(record.name);
+  }
+}
+
+void LocationStore::erase(const string& name) {
+  auto it = m_records.find(name);
+  if (it == m_records.end()) {
+    return;
+  }
+
+  for (auto& tag : it->second.tags) {
+    auto& names = m_tags[tag];
+    names.erase(name);
+
+    if (names.empty()) {
+      m_tags.erase(tag);
+    }
+  }
+
+  m_records.erase(it);
+}
+
+void LocationStore::put(const Record& record) {
+  string payload = encodePut(record);
+  append(payload);
+
+  if (m_records.count(record.name)) {
+    ++m_deadRecords;
+  }
+  insert(record);
+}
+
+void LocationStore::remove(const string& name) {
+  if (m_records.count(name) == 0) {
+    return;
+  }
+
+  append(encodeRemove(name));
+
+  // Both the record and the removal are dead
+  m_deadRecords += 2;
+  erase(name);
+}
+
+const LocationStore::Record* LocationStore::find(const string& name) const {
+  auto it = m_records.find(name);
+  return it == m_records.end() ? nullptr : &it->second;
+}
+
+std::vector<string> LocationStore::withTag(const string& tag) const {
+  auto it = m_tags.find(tag);
+  if (it == m_tags.end()) {
+    return {};
+  }
+
+  return std::vector<string>(it->second.begin(), it->second.end());
+}
+
+const std::map<string, LocationStore::Record>& LocationStore::records() const {
+  return m_records;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <fstream>
+
+// Saved locations, kept in a log that's only ever appended to. Adding or
+// deleting a location writes one record instead of rewriting the file, and
+// the log is read into an index by name and by tag when opened. Coordinates
+// are kept as the decimal strings they were saved with, so no precision is
+// lost however deep they are.
+class LocationStore {
+public:
+  struct Record {
+    std::string name;
+    std::string x;
+    std::string y;
+    std::string magnification;
+    std::vector<std::string> tags;
+  };
+
+  // Opens the store, creating it if it doesn't exist. Throws
+  // std::runtime_error if the file can't be read or written.
+  explicit LocationStore(const std::string& filePath);
+
+  // Adds the record, replacing any with the same name
+  void put(const Record& record);
+  void remove(const std::string& name);
+
+  // Null if there's no location with this name
+  const Record* find(const std::string& name) const;
+  // Names of the locations with this tag, in order
+  std::vector<std::string> withTag(const std::string& tag) const;
+  const std::map<std::string, Record>& records() const;
+
+private:
+  void load();
+  void compact();
+  void open();
+  void append(const std::string& payload);
+  void apply(const std::string& payload);
+  void insert(const Record& record);
+  void erase(const std::string& name);
+
+  std::string m_filePath;
+  std::ofstream m_file;
+  std::map<std::string, Record> m_records;
+  std::map<std::string, std::set<std::string>> m_tags;
+  // Records in the log that have since been replaced or deleted
+  size_t m_deadRecords = 0;
+};
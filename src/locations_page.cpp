@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <stdexcept>
 #include <wx/file.h>
 #include <wx/filename.h>
+#include <wx/tokenzr.h>
 #include <wx/dir.h>
 #include <wx/xml/xml.h>
+#include <wx/imaglist.h>
 #include "locations_page.hpp"
 #include "wx_helpers.hpp"
 #include "renderer.hpp"
@@ -9,9 +13,42 @@
 
 using std::string;
 
+static const int THUMBNAIL_W = 128;
+static const int THUMBNAIL_H = 96;
+
+// How often finished thumbnails are picked up, in milliseconds
+static const int THUMBNAIL_POLL_INTERVAL = 100;
+
+static std::vector<string> parseTags(const wxString& text) {
+  std::vector<string> tags;
+
+  wxStringTokenizer tokenizer(text, ",");
+  while (tokenizer.HasMoreTokens()) {
+    wxString tag = tokenizer.GetNextToken().Trim().Trim(false);
+    if (!tag.empty()) {
+      tags.push_back(tag.ToStdString());
+    }
+  }
+
+  return tags;
+}
+
+static wxString joinTags(const std::vector<string>& tags) {
+  wxString text;
+  for (auto& tag : tags) {
+    if (!text.empty()) {
+      text += ", ";
+    }
+    text += tag;
+  }
+
+  return text;
+}
+
 wxDEFINE_EVENT(APPLY_LOCATION_EVENT, ApplyLocationEvent);
 
-ApplyLocationEvent::ApplyLocationEvent(double x, double y, double magnification)
+ApplyLocationEvent::ApplyLocationEvent(const string& x, const string& y,
+                                       const string& magnification)
   : wxCommandEvent(APPLY_LOCATION_EVENT),
     x(x),
     y(y),
@@ -27,10 +64,22 @@ wxEvent* ApplyLocationEvent::Clone() const {
   return new ApplyLocationEvent(*this);
 }
 
-LocationsPage::LocationsPage(wxWindow* parent)
+LocationsPage::LocationsPage(wxWindow* parent,
+                             ThumbnailCache::fnColour_t fnColour)
   : wxNotebookPage(parent, wxID_ANY) {
 
-  loadLocations();
+  openStore();
+
+  string thumbnailsPath = userDataPath("thumbnails");
+  if (!wxDir::Exists(thumbnailsPath)) {
+    wxDir::Make(thumbnailsPath, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  m_thumbnails.reset(new ThumbnailCache(thumbnailsPath, THUMBNAIL_W,
+                                        THUMBNAIL_H, fnColour));
+
+  m_timer = new wxTimer(this);
+  Bind(wxEVT_TIMER, &LocationsPage::onTick, this);
 
   auto vbox = new wxBoxSizer(wxVERTICAL);
   vbox->Add(constructCurrentPanel(this), 1, wxEXPAND | wxALL, 10);
@@ -96,6 +145,17 @@ wxStaticBoxSizer* LocationsPage::constructFavouritesPanel(wxWindow* parent) {
   m_btnDelete = new wxButton(box, wxID_ANY, wxGetTranslation("Delete"));
   m_btnDelete->Bind(wxEVT_BUTTON, &LocationsPage::onDeleteClick, this);
 
+  auto lblTags = constructLabel(box, wxGetTranslation("Tags"));
+  m_txtTags = constructTextBox(box, wxEmptyString);
+  m_txtTags->SetToolTip(wxGetTranslation("Comma separated. Saved with the "
+                                         "location when it's added."));
+
+  auto lblTagFilter = constructLabel(box, wxGetTranslation("Show tag"));
+  m_txtTagFilter = constructTextBox(box, wxEmptyString);
+  m_txtTagFilter->SetToolTip(wxGetTranslation("Only list locations with "
+                                              "this tag"));
+  m_txtTagFilter->Bind(wxEVT_TEXT, &LocationsPage::onTagFilterChange, this);
+
   m_btnAdd = new wxButton(box, wxID_ANY, wxGetTranslation("Add current"));
   m_btnAdd->Bind(wxEVT_BUTTON, &LocationsPage::onAddClick, this);
   m_btnAdd->Disable();
@@ -110,130 +170,210 @@ wxStaticBoxSizer* LocationsPage::constructFavouritesPanel(wxWindow* parent) {
   grid->AddSpacer(10);
   grid->Add(lblName, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
   grid->Add(m_cboFavourites, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblTags, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtTags, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblTagFilter, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtTagFilter, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
 
   grid->AddGrowableCol(0);
   grid->AddGrowableCol(1);
 
+  m_lstThumbnails = new wxListCtrl(box, wxID_ANY, wxDefaultPosition,
+                                   wxDefaultSize, wxLC_ICON | wxLC_SINGLE_SEL);
+  m_lstThumbnails->Bind(wxEVT_LIST_ITEM_ACTIVATED,
+                        &LocationsPage::onThumbnailActivated, this);
+
+  m_thumbnailImages = new wxImageList(THUMBNAIL_W, THUMBNAIL_H, false);
+  m_lstThumbnails->AssignImageList(m_thumbnailImages, wxIMAGE_LIST_NORMAL);
+
   auto vbox = new wxBoxSizer(wxVERTICAL);
   vbox->Add(grid, 0, wxEXPAND);
-  vbox->Add(hbox, 0, wxEXPAND);
+  vbox->Add(hbox, 0, wxEXPAND | wxBOTTOM, 10);
+  vbox->Add(m_lstThumbnails, 1, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
 
   boxSizer->Add(vbox, 1, wxEXPAND);
 
   return boxSizer;
 }
 
+// The centre is shown to as many digits as the view's depth needs, so saving
+// it loses nothing
 void LocationsPage::onRender(const Renderer& renderer) {
-  auto magLevel = numberToString(renderer.computeMagnification(), true);
-  m_txtMagnification->ChangeValue(magLevel);
+  const View& view = renderer.getView();
 
-  double xMin = renderer.getXMin();
-  double xMax = renderer.getXMax();
-  double yMin = renderer.getYMin();
-  double yMax = renderer.getYMax();
+  m_txtMagnification->ChangeValue(view.magnificationString());
+  m_txtX->ChangeValue(view.xString());
+  m_txtY->ChangeValue(view.yString());
+}
+
+// Opens the location store, importing the old XML file the first time
+void LocationsPage::openStore() {
+  wxString dbPath = userDataPath("locations.db");
+  wxString xmlPath = userDataPath("locations.xml");
+
+  if (!wxDir::Exists(userDataPath())) {
+    wxDir::Make(userDataPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
 
-  double x = xMin + 0.5 * (xMax - xMin);
-  double y = yMin + 0.5 * (yMax - yMin);
+  bool firstRun = !wxFile::Exists(dbPath);
+  m_store.reset(new LocationStore(dbPath.ToStdString()));
 
-  m_txtX->ChangeValue(numberToString(x, true));
-  m_txtY->ChangeValue(numberToString(y, true));
+  // The XML file is left in place, but never read again
+  if (firstRun && wxFile::Exists(xmlPath)) {
+    importXml(xmlPath);
+  }
 }
 
-void LocationsPage::loadLocations() {
-  m_filePath = userDataPath("locations.xml");
+void LocationsPage::importXml(const wxString& filePath) {
+  wxXmlDocument doc;
+  if (!doc.Load(filePath) || doc.GetRoot() == nullptr) {
+    return;
+  }
 
-  if (wxFile::Exists(m_filePath)) {
-    wxXmlDocument doc;
-    doc.Load(m_filePath);
+  auto xmlLocation = doc.GetRoot()->GetChildren();
+  while (xmlLocation) {
+    LocationStore::Record record;
+    record.name = xmlLocation->GetAttribute("name").ToStdString();
+    record.x = xmlLocation->GetAttribute("x", "0").ToStdString();
+    record.y = xmlLocation->GetAttribute("y", "0").ToStdString();
+    record.magnification =
+      xmlLocation->GetAttribute("magnification", "1").ToStdString();
 
-    auto xmlLocation = doc.GetRoot()->GetChildren();
-    while (xmlLocation) {
-      wxString name = xmlLocation->GetAttribute("name");
-      wxString strX = xmlLocation->GetAttribute("x");
-      wxString strY = xmlLocation->GetAttribute("y");
-      wxString strMag = xmlLocation->GetAttribute("magnification");
+    m_store->put(record);
 
-      double x = 0;
-      double y = 0;
-      double mag = 1.0;
+    xmlLocation = xmlLocation->GetNext();
+  }
+}
 
-      strX.ToDouble(&x);
-      strY.ToDouble(&y);
-      strMag.ToDouble(&mag);
+// Shows the coordinates as they were saved, at full precision
+void LocationsPage::populateFields(const LocationStore::Record& record) {
+  m_txtX->ChangeValue(record.x);
+  m_txtY->ChangeValue(record.y);
+  m_txtMagnification->ChangeValue(record.magnification);
+  m_txtTags->ChangeValue(joinTags(record.tags));
+}
 
-      m_locations[name.ToStdString()] = Location{x, y, mag};
+void LocationsPage::updateFavouritesSelector() {
+  auto& cbo = *m_cboFavourites;
 
-      xmlLocation = xmlLocation->GetNext();
+  string tag = m_txtTagFilter->GetValue().Trim().Trim(false).ToStdString();
+
+  m_visibleNames.clear();
+  if (tag.empty()) {
+    for (auto& entry : m_store->records()) {
+      m_visibleNames.push_back(entry.first);
     }
   }
+  else {
+    m_visibleNames = m_store->withTag(tag);
+  }
+
+  std::vector<wxString> names(m_visibleNames.begin(), m_visibleNames.end());
+
+  cbo.Clear();
+
+  if (names.size() > 0) {
+    cbo.Insert(names, 0);
+  }
+
+  updateThumbnails();
 }
 
-void LocationsPage::saveLocations() {
-  if (!wxFile::Exists(m_filePath)) {
-    wxDir::Make(userDataPath(), wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+void LocationsPage::setColourScheme(const string& computeColourImpl) {
+  if (computeColourImpl == m_computeColourImpl) {
+    return;
   }
 
-  wxXmlDocument doc;
-  auto root = new wxXmlNode(nullptr, wxXML_ELEMENT_NODE, "locations");
+  m_computeColourImpl = computeColourImpl;
+  m_thumbnails->setColourScheme(computeColourImpl);
 
-  for (auto entry : m_locations) {
-    const wxString& name = entry.first;
-    const Location& loc = entry.second;
+  updateThumbnails();
+}
 
-    auto xmlLocation = new wxXmlNode(root, wxXML_ELEMENT_NODE, "location");
+// Shows a blank thumbnail for each location, to be replaced as they're
+// loaded or rendered
+void LocationsPage::updateThumbnails() {
+  m_thumbnails->cancel();
+  m_lstThumbnails->DeleteAllItems();
+  m_thumbnailImages->RemoveAll();
 
-    xmlLocation->AddAttribute("name", name);
-    xmlLocation->AddAttribute("x", std::to_string(loc.x));
-    xmlLocation->AddAttribute("y", std::to_string(loc.y));
-    xmlLocation->AddAttribute("magnification",
-                              std::to_string(loc.magnification));
+  // Nothing can be coloured until the renderer has a colour scheme
+  if (m_computeColourImpl.empty()) {
+    return;
   }
 
-  doc.SetRoot(root);
-  doc.Save(m_filePath);
-}
+  wxBitmap blank(THUMBNAIL_W, THUMBNAIL_H);
+  int i = 0;
 
-void LocationsPage::populateFields(const LocationsPage::Location& loc) {
-  m_txtX->ChangeValue(std::to_string(loc.x));
-  m_txtY->ChangeValue(std::to_string(loc.y));
-  m_txtMagnification->ChangeValue(std::to_string(loc.magnification));
-}
+  m_pendingThumbnails = 0;
 
-LocationsPage::Location LocationsPage::getCurrentLocation() const {
-  double x = getValue<double>(*m_txtX);
-  double y = getValue<double>(*m_txtY);
-  double mag = getMinValue<double>(*m_txtMagnification, 0);
+  for (auto& name : m_visibleNames) {
+    const LocationStore::Record& record = *m_store->find(name);
 
-  return Location{x, y, mag};
-}
+    m_thumbnailImages->Add(blank);
+    m_lstThumbnails->InsertItem(i, name, i);
+    ++i;
 
-void LocationsPage::updateFavouritesSelector() {
-  auto& cbo = *m_cboFavourites;
+    // Locations that don't parse are left blank
+    try {
+      View view = View::fromStrings(record.x, record.y, record.magnification);
+      m_thumbnails->request(name, view);
+      ++m_pendingThumbnails;
+    }
+    catch (const std::invalid_argument&) {}
+  }
 
-  std::vector<wxString> names;
-  for (auto entry : m_locations) {
-    names.push_back(entry.first);
+  if (m_pendingThumbnails > 0 && !m_disabled) {
+    m_timer->Start(THUMBNAIL_POLL_INTERVAL);
   }
+}
 
-  cbo.Clear();
+void LocationsPage::onTick(wxTimerEvent&) {
+  for (auto& thumbnail : m_thumbnails->collect()) {
+    auto it = std::find(m_visibleNames.begin(), m_visibleNames.end(),
+                        thumbnail.name);
+    if (it == m_visibleNames.end()) {
+      continue;
+    }
 
-  if (names.size() > 0) {
-    cbo.Insert(names, 0);
+    int i = static_cast<int>(std::distance(m_visibleNames.begin(), it));
+
+    wxImage image(thumbnail.w, thumbnail.h, thumbnail.rgb.data(), true);
+    m_thumbnailImages->Replace(i, wxBitmap(image.Mirror(false)));
+    m_lstThumbnails->RefreshItem(i);
+
+    if (m_pendingThumbnails > 0) {
+      --m_pendingThumbnails;
+    }
   }
+
+  if (m_pendingThumbnails == 0) {
+    m_timer->Stop();
+  }
+}
+
+void LocationsPage::onThumbnailActivated(wxListEvent& e) {
+  string name = e.GetText().ToStdString();
+
+  m_cboFavourites->ChangeValue(name);
+  selectLocation(name);
 }
 
 void LocationsPage::onSelectLocation(wxCommandEvent&) {
+  selectLocation(m_cboFavourites->GetValue().ToStdString());
+}
+
+void LocationsPage::selectLocation(const string& name) {
   showHideButtons();
 
-  string name = m_cboFavourites->GetValue().ToStdString();
   if (name.length() == 0) {
     return;
   }
 
-  const Location& loc = m_locations.at(name);
-  populateFields(loc);
+  const LocationStore::Record& record = *m_store->find(name);
+  populateFields(record);
 
-  ApplyLocationEvent event(loc.x, loc.y, loc.magnification);
+  ApplyLocationEvent event(record.x, record.y, record.magnification);
   wxPostEvent(this, event);
 }
 
@@ -241,6 +381,10 @@ void LocationsPage::onLocationTextChange(wxCommandEvent&) {
   showHideButtons();
 }
 
+void LocationsPage::onTagFilterChange(wxCommandEvent&) {
+  updateFavouritesSelector();
+}
+
 void LocationsPage::clearSelection() {
   m_cboFavourites->ChangeValue(wxEmptyString);
   showHideButtons();
@@ -249,7 +393,7 @@ void LocationsPage::clearSelection() {
 void LocationsPage::showHideButtons() {
   string name = m_cboFavourites->GetValue().ToStdString();
 
-  bool exists = m_locations.count(name);
+  bool exists = m_store->find(name) != nullptr;
 
   m_btnAdd->Enable(!exists && name.length() > 0);
   m_btnDelete->Show(exists);
@@ -258,18 +402,23 @@ void LocationsPage::showHideButtons() {
 }
 
 void LocationsPage::onAddClick(wxCommandEvent&) {
-  string name = m_cboFavourites->GetValue().ToStdString();
-  m_locations[name] = getCurrentLocation();
+  LocationStore::Record record;
+  record.name = m_cboFavourites->GetValue().ToStdString();
+  record.x = m_txtX->GetValue().Trim().Trim(false).ToStdString();
+  record.y = m_txtY->GetValue().Trim().Trim(false).ToStdString();
+  record.magnification =
+    m_txtMagnification->GetValue().Trim().Trim(false).ToStdString();
+  record.tags = parseTags(m_txtTags->GetValue());
 
-  updateFavouritesSelector();
+  m_store->put(record);
 
-  saveLocations();
+  updateFavouritesSelector();
 }
 
 void LocationsPage::onApplyClick(wxCommandEvent&) {
-  double x = getValue<double>(*m_txtX);
-  double y = getValue<double>(*m_txtY);
-  double mag = getMinValue<double>(*m_txtMagnification, 0);
+  string x = m_txtX->GetValue().Trim().Trim(false).ToStdString();
+  string y = m_txtY->GetValue().Trim().Trim(false).ToStdString();
+  string mag = m_txtMagnification->GetValue().Trim().Trim(false).ToStdString();
 
   ApplyLocationEvent event(x, y, mag);
   wxPostEvent(this, event);
@@ -277,22 +426,37 @@ void LocationsPage::onApplyClick(wxCommandEvent&) {
 
 void LocationsPage::onDeleteClick(wxCommandEvent&) {
   string name = m_cboFavourites->GetValue().ToStdString();
-  m_locations.erase(name);
+  m_store->remove(name);
 
   updateFavouritesSelector();
   showHideButtons();
+}
 
-  saveLocations();
+const std::map<string, LocationStore::Record>&
+LocationsPage::getLocations() const {
+  return m_store->records();
 }
 
+// Thumbnails are coloured with the renderer, so they're held back while
+// it's busy with an export
 void LocationsPage::disable() {
+  m_disabled = true;
+  m_timer->Stop();
+
   m_btnApply->Disable();
   m_btnDelete->Disable();
+  m_lstThumbnails->Disable();
 }
 
 void LocationsPage::enable() {
+  m_disabled = false;
+  if (m_pendingThumbnails > 0) {
+    m_timer->Start(THUMBNAIL_POLL_INTERVAL);
+  }
+
   m_btnApply->Enable();
   m_btnDelete->Enable();
+  m_lstThumbnails->Enable();
 
   showHideButtons();
 }
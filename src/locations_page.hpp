@@ -1,66 +1,89 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 #include <wx/wx.h>
 #include <wx/notebook.h>
+#include <wx/listctrl.h>
+#include "thumbnail_cache.hpp"
+#include "location_store.hpp"
 
 class ApplyLocationEvent;
 
 wxDECLARE_EVENT(APPLY_LOCATION_EVENT, ApplyLocationEvent);
 
+// Coordinates are decimal strings, exactly as entered or saved, so they can
+// be parsed at whatever precision the depth needs
 class ApplyLocationEvent : public wxCommandEvent {
 public:
-  ApplyLocationEvent(double x, double y, double magnification);
+  ApplyLocationEvent(const std::string& x, const std::string& y,
+                     const std::string& magnification);
   ApplyLocationEvent(const ApplyLocationEvent& cpy);
 
   wxEvent* Clone() const override;
 
-  double x;
-  double y;
-  double magnification;
+  std::string x;
+  std::string y;
+  std::string magnification;
 };
 
 class Renderer;
 
 class LocationsPage : public wxNotebookPage {
 public:
-  LocationsPage(wxWindow* parent);
+  // Thumbnails are coloured with fnColour
+  LocationsPage(wxWindow* parent, ThumbnailCache::fnColour_t fnColour);
 
   void onRender(const Renderer& renderer);
+  // Thumbnails are shown in this colour scheme, and rendered again if it
+  // differs from the last one
+  void setColourScheme(const std::string& computeColourImpl);
   void disable();
   void enable();
   void clearSelection();
+  const std::map<std::string, LocationStore::Record>& getLocations() const;
 
 private:
-  struct Location {
-    double x = 0.0;
-    double y = 0.0;
-    double magnification = 1.0;
-  };
-
   wxStaticBoxSizer* constructCurrentPanel(wxWindow* parent);
   wxStaticBoxSizer* constructFavouritesPanel(wxWindow* parent);
-  void loadLocations();
-  void saveLocations();
-  void populateFields(const Location& loc);
-  LocationsPage::Location getCurrentLocation() const;
+  void openStore();
+  void importXml(const wxString& filePath);
+  void populateFields(const LocationStore::Record& record);
   void updateFavouritesSelector();
+  void updateThumbnails();
   void showHideButtons();
+  void selectLocation(const std::string& name);
 
   void onApplyClick(wxCommandEvent& e);
   void onSelectLocation(wxCommandEvent& e);
   void onLocationTextChange(wxCommandEvent& e);
+  void onTagFilterChange(wxCommandEvent& e);
   void onAddClick(wxCommandEvent& e);
   void onDeleteClick(wxCommandEvent& e);
+  void onThumbnailActivated(wxListEvent& e);
+  void onTick(wxTimerEvent& e);
 
   wxTextCtrl* m_txtX;
   wxTextCtrl* m_txtY;
   wxTextCtrl* m_txtMagnification;
   wxButton* m_btnApply;
   wxComboBox* m_cboFavourites;
+  wxTextCtrl* m_txtTags;
+  wxTextCtrl* m_txtTagFilter;
   wxButton* m_btnAdd;
   wxButton* m_btnDelete;
-  wxString m_filePath;
-  std::map<std::string, Location> m_locations;
+  wxListCtrl* m_lstThumbnails;
+  // Owned by m_lstThumbnails. Entries are in the same order as
+  // m_visibleNames.
+  wxImageList* m_thumbnailImages;
+  wxTimer* m_timer;
+  std::unique_ptr<LocationStore> m_store;
+  // Locations matching the tag filter
+  std::vector<std::string> m_visibleNames;
+  std::unique_ptr<ThumbnailCache> m_thumbnails;
+  std::string m_computeColourImpl;
+  size_t m_pendingThumbnails = 0;
+  bool m_disabled = false;
 };
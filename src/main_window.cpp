@@ -1,4 +1,6 @@
 #include <sstream>
+#include <deque>
+#include <wx/filename.h>
 #include "main_window.hpp"
 #include "config.hpp"
 #include "exception.hpp"
@@ -9,9 +11,34 @@
 #include "params_page.hpp"
 #include "locations_page.hpp"
 #include "export_page.hpp"
+#include "video_page.hpp"
+#include "thread_pool.hpp"
+#include "iteration_data_file.hpp"
 
 using std::string;
 
+static string exportFileName(const string& locationName, int w, int h) {
+  string name = locationName;
+  wxString forbidden = wxFileName::GetForbiddenChars();
+
+  for (char& c : name) {
+    if (c == ' ' || forbidden.Find(c) != wxNOT_FOUND) {
+      c = '_';
+    }
+  }
+
+  std::stringstream ss;
+  ss << name << "_" << w << "x" << h << ".bmp";
+  return ss.str();
+}
+
+static bool saveBitmap(const string& filePath, int w, int h, uint8_t* data) {
+  wxImage image(w, h, data);
+  image = image.Mirror(false);
+
+  return image.SaveFile(filePath, wxBITMAP_TYPE_BMP);
+}
+
 wxBEGIN_EVENT_TABLE(MainWindow, wxFrame)
   EVT_MENU(wxID_EXIT, MainWindow::onExit)
   EVT_MENU(wxID_ABOUT, MainWindow::onAbout)
@@ -25,6 +52,11 @@ MainWindow::MainWindow(const wxString& title, const wxSize& size)
     makeGlContextCurrent();
   }));
 
+  m_perturbationEngine.reset(new PerturbationEngine(0, ThreadPool::LOW));
+
+  m_exportQueue.reset(new ExportQueue);
+  m_exportQueue->load();
+
   m_vbox = new wxBoxSizer(wxVERTICAL);
   SetSizer(m_vbox);
 
@@ -104,7 +136,11 @@ void MainWindow::constructColourSchemePage() {
 }
 
 void MainWindow::constructLocationsPage() {
-  m_locationsPage = new LocationsPage(m_rightPanel);
+  auto fnColour = [this](const IterationData& data, uint8_t* buffer) {
+    m_renderer->colourIterationData(data, buffer);
+  };
+
+  m_locationsPage = new LocationsPage(m_rightPanel, fnColour);
   m_locationsPage->Bind(APPLY_LOCATION_EVENT, &MainWindow::onApplyLocation,
                         this);
   m_rightPanel->AddPage(m_locationsPage, wxGetTranslation("Locations"));
@@ -113,17 +149,46 @@ void MainWindow::constructLocationsPage() {
 void MainWindow::constructExportPage() {
   m_exportPage = new ExportPage(m_rightPanel);
   m_exportPage->Bind(EXPORT_EVENT, &MainWindow::onExport, this);
+  m_exportPage->Bind(BATCH_EXPORT_EVENT, &MainWindow::onBatchExport, this);
+  m_exportPage->Bind(RECOLOUR_EVENT, &MainWindow::onRecolour, this);
+  m_exportPage->Bind(RESUME_BATCH_EXPORT_EVENT,
+                     &MainWindow::onResumeBatchExport, this);
+  m_exportPage->setResumableJobs(m_exportQueue->numPendingJobs());
 
   m_rightPanel->AddPage(m_exportPage, wxGetTranslation("Export"));
 }
 
+void MainWindow::constructVideoPage() {
+  m_videoPage = new VideoPage(m_rightPanel);
+  m_videoPage->Bind(RENDER_VIDEO_EVENT, &MainWindow::onRenderVideo, this);
+
+  m_rightPanel->AddPage(m_videoPage, wxGetTranslation("Video"));
+}
+
 void MainWindow::constructRightPanel() {
   m_rightPanel = new wxNotebook(m_splitter, wxID_ANY);
+  m_rightPanel->Bind(wxEVT_NOTEBOOK_PAGE_CHANGED, &MainWindow::onPageChanged,
+                     this);
+
   constructInfoPage();
   constructParamsPage();
   constructColourSchemePage();
   constructLocationsPage();
   constructExportPage();
+  constructVideoPage();
+}
+
+void MainWindow::onPageChanged(wxBookCtrlEvent& e) {
+  e.Skip();
+
+  if (m_videoPage && m_rightPanel->GetCurrentPage() == m_videoPage) {
+    std::vector<string> names;
+    for (auto& entry : m_locationsPage->getLocations()) {
+      names.push_back(entry.first);
+    }
+
+    m_videoPage->setLocationNames(names);
+  }
 }
 
 void MainWindow::constructMenu() {
@@ -168,17 +233,51 @@ void MainWindow::onCanvasResize(wxSizeEvent& e) {
 void MainWindow::onRender() {
   m_infoPage->onRender(*m_renderer);
   m_locationsPage->onRender(*m_renderer);
+  m_locationsPage->setColourScheme(m_renderer->getColourSchemeImpl());
+
+  if (m_renderer->getAutoMaxIterations()) {
+    int maxI = m_renderer->getMaxIterations();
+    m_paramsPage->setMaxIterations(maxI);
+
+    // Render again at the new limit until it settles
+    if (maxI != m_autoMaxIterations) {
+      m_autoMaxIterations = maxI;
+      m_canvas->refresh();
+    }
+  }
 }
 
-uint8_t* MainWindow::beginExport(int w, int h) {
+uint8_t* MainWindow::beginExport(int w, int h, int maxSamples,
+                                 IterationData* iterations) {
   m_doingExport = true;
   m_exportPage->setBusy(true);
   m_paramsPage->disable();
   m_colourSchemePage->disable();
+  m_locationsPage->disable();
   m_canvas->disable();
   SetStatusText(wxGetTranslation("Exporting to file..."));
 
-  m_renderer->renderToMainMemoryBuffer(w, h);
+  uint8_t* data = renderOffline(w, h, maxSamples, iterations);
+
+  if (m_quitting) {
+    m_doingExport = false;
+    m_exportPage->setBusy(false);
+    Close();
+    return nullptr;
+  }
+
+  return data;
+}
+
+uint8_t* MainWindow::renderOffline(int w, int h, int maxSamples,
+                                   IterationData* iterations) {
+  m_exportReferences = 0;
+
+  if (PerturbationEngine::needed(m_renderer->getView(), h)) {
+    return renderDeep(w, h, iterations);
+  }
+
+  m_renderer->renderToMainMemoryBuffer(w, h, maxSamples, iterations);
 
   const OfflineRenderStatus& status = m_renderer->continueOfflineRender();
 
@@ -187,44 +286,387 @@ uint8_t* MainWindow::beginExport(int w, int h) {
     wxYield();
 
     if (m_quitting) {
-      m_doingExport = false;
-      m_exportPage->setBusy(false);
-      Close();
+      delete[] status.data;
       return nullptr;
     }
 
     m_renderer->continueOfflineRender();
   }
 
+  m_exportSamplesPerPixel = status.samplesPerPixel();
+
   return status.data;
 }
 
+// The GPU can't resolve views this deep, so they're rendered on the CPU by
+// perturbation, one sample per pixel
+uint8_t* MainWindow::renderDeep(int w, int h, IterationData* iterations) {
+  PerturbationParams params;
+  params.w = w;
+  params.h = h;
+  params.maxIterations = m_renderer->getMaxIterations();
+  params.view = m_renderer->getView();
+
+  IterationData local;
+  IterationData& data = iterations != nullptr ? *iterations : local;
+
+  ThreadPool runner(1, ThreadPool::LOW);
+
+  // The engine keeps its references, so exporting views near one another
+  // only iterates their pixels
+  auto result = runner.run([&]() {
+    return m_perturbationEngine->render(params, data);
+  });
+
+  // Progress isn't known, but the UI is kept responsive
+  while (result.wait_for(std::chrono::milliseconds(50)) !=
+         std::future_status::ready) {
+    wxYield();
+  }
+
+  PerturbationEngine::Stats stats = result.get();
+
+  if (m_quitting) {
+    return nullptr;
+  }
+
+  m_exportSamplesPerPixel = 1.0;
+  m_exportReferences = stats.references;
+
+  uint8_t* buffer = new uint8_t[w * h * 3];
+  m_renderer->colourIterationData(data, buffer);
+
+  return buffer;
+}
+
 void MainWindow::endExport(const wxString& exportFilePath, int w, int h,
-                           uint8_t* data) {
-  if (data != nullptr) {
-    wxImage image(w, h, data);
-    image = image.Mirror(false);
+                           uint8_t* data, const IterationData* iterations) {
+  wxString error;
+
+  if (data != nullptr && iterations != nullptr) {
+    delete[] data;
 
-    image.SaveFile(exportFilePath, wxBITMAP_TYPE_BMP);
+    IterationParams params;
+    params.w = w;
+    params.h = h;
+    params.maxIterations = iterations->maxIterations;
+
+    try {
+      ThreadPool threads;
+      saveIterationData(exportFilePath.ToStdString(), params,
+                        m_renderer->getView(), *iterations, threads);
+    }
+    catch (const std::runtime_error& e) {
+      error = e.what();
+    }
+  }
+  else if (data != nullptr) {
+    saveBitmap(exportFilePath.ToStdString(), w, h, data);
   }
 
   m_doingExport = false;
   m_exportPage->setBusy(false);
   m_paramsPage->enable();
   m_colourSchemePage->enable();
+  m_locationsPage->enable();
   m_canvas->enable();
-  SetStatusText(wxGetTranslation("Export complete"));
+
+  if (!error.empty()) {
+    SetStatusText(error);
+  }
+  else if (m_exportReferences > 1) {
+    SetStatusText(wxString::Format(wxGetTranslation("Export complete "
+                                                    "(%d reference orbits)"),
+                                   m_exportReferences));
+  }
+  else if (m_exportSamplesPerPixel > 1.0) {
+    SetStatusText(wxString::Format(wxGetTranslation("Export complete "
+                                                    "(%.2f samples per pixel)"),
+                                   m_exportSamplesPerPixel));
+  }
+  else {
+    SetStatusText(wxGetTranslation("Export complete"));
+  }
 
   m_canvas->refresh();
 }
 
 void MainWindow::onExport(ExportEvent& e) {
-  uint8_t* data = beginExport(e.w, e.h);
+  if (wxFileName(e.filePath).GetExt().Lower() == "mbi") {
+    IterationData iterations;
+    uint8_t* data = beginExport(e.w, e.h, 1, &iterations);
+    endExport(e.filePath, e.w, e.h, data, &iterations);
+    return;
+  }
+
+  uint8_t* data = beginExport(e.w, e.h, e.maxSamples);
   endExport(e.filePath, e.w, e.h, data);
 }
 
+// Only the colouring runs, so this takes about as long as reading the file
+void MainWindow::onRecolour(RecolourEvent& e) {
+  SetStatusText(wxGetTranslation("Recolouring..."));
+
+  try {
+    ThreadPool threads;
+    IterationDataFile file(e.dataFilePath.ToStdString());
+
+    IterationData iterations;
+    file.load(iterations, threads);
+
+    int w = iterations.w;
+    int h = iterations.h;
+    uint8_t* data = new uint8_t[w * h * 3];
+    m_renderer->colourIterationData(iterations, data);
+
+    if (saveBitmap(e.imageFilePath.ToStdString(), w, h, data)) {
+      SetStatusText(wxGetTranslation("Recolouring complete"));
+    }
+    else {
+      SetStatusText(wxGetTranslation("Error saving image"));
+    }
+  }
+  catch (const std::runtime_error& ex) {
+    SetStatusText(ex.what());
+  }
+}
+
+uint8_t* MainWindow::renderExportJob(const ExportJob& job) {
+  if (job.computeColourImpl != m_renderer->getColourSchemeImpl()) {
+    m_renderer->setColourSchemeImpl(job.computeColourImpl);
+  }
+
+  m_renderer->setMaxIterations(job.maxIterations);
+  m_renderer->setView(View::fromStrings(job.x, job.y, job.magnification));
+
+  return renderOffline(job.w, job.h);
+}
+
+// The GL context can only be driven from this thread, so jobs are rendered
+// back-to-back here while a pool of worker threads encodes and writes the
+// finished images. The GPU moves straight on to the next job instead of
+// waiting on disk.
+void MainWindow::runExportQueue() {
+  m_doingExport = true;
+  m_exportPage->setBusy(true);
+  m_paramsPage->disable();
+  m_colourSchemePage->disable();
+  m_locationsPage->disable();
+  m_canvas->disable();
+
+  View view = m_renderer->getView();
+  int maxIterations = m_renderer->getMaxIterations();
+  string computeColourImpl = m_renderer->getColourSchemeImpl();
+
+  ThreadPool writers;
+  std::deque<std::pair<size_t, std::future<bool>>> writes;
+
+  auto collectWrites = [&](bool wait) {
+    while (!writes.empty()) {
+      auto& write = writes.front();
+
+      if (!wait && write.second.wait_for(std::chrono::seconds(0)) !=
+                   std::future_status::ready) {
+        break;
+      }
+
+      bool success = write.second.get();
+      m_exportQueue->setJobStatus(write.first, success ? ExportJob::DONE :
+                                                         ExportJob::FAILED);
+      writes.pop_front();
+    }
+  };
+
+  size_t numJobs = m_exportQueue->numJobs();
+
+  for (size_t i = 0; i < numJobs && !m_quitting; ++i) {
+    const ExportJob& job = m_exportQueue->getJob(i);
+
+    if (job.status != ExportJob::PENDING) {
+      continue;
+    }
+
+    std::stringstream ss;
+    ss << wxGetTranslation("Exporting").ToStdString() << " " << job.name
+       << " (" << job.w << "x" << job.h << ") [" << i + 1 << "/" << numJobs
+       << "]";
+    SetStatusText(ss.str());
+
+    uint8_t* data = nullptr;
+    try {
+      data = renderExportJob(job);
+    }
+    // A bad location, or a colour scheme that no longer compiles, fails
+    // just this job
+    catch (const std::invalid_argument&) {
+      m_exportQueue->setJobStatus(i, ExportJob::FAILED);
+      continue;
+    }
+    catch (const std::runtime_error&) {
+      m_exportQueue->setJobStatus(i, ExportJob::FAILED);
+      continue;
+    }
+
+    if (data == nullptr) {
+      break;
+    }
+
+    // Bound the number of finished images held in memory
+    while (writes.size() >= writers.numThreads()) {
+      writes.front().second.wait_for(std::chrono::milliseconds(10));
+      wxYield();
+      collectWrites(false);
+    }
+
+    int w = job.w;
+    int h = job.h;
+    string filePath = job.filePath;
+
+    writes.push_back(std::make_pair(i, writers.run([=]() {
+      return saveBitmap(filePath, w, h, data);
+    })));
+
+    collectWrites(false);
+  }
+
+  collectWrites(true);
+
+  m_renderer->setColourSchemeImpl(computeColourImpl);
+  m_renderer->setMaxIterations(maxIterations);
+  m_renderer->setView(view);
+
+  m_doingExport = false;
+  m_exportPage->setBusy(false);
+  m_exportPage->setResumableJobs(m_exportQueue->numPendingJobs());
+
+  if (m_quitting) {
+    Close();
+    return;
+  }
+
+  m_paramsPage->enable();
+  m_colourSchemePage->enable();
+  m_locationsPage->enable();
+  m_canvas->enable();
+  SetStatusText(wxGetTranslation("Batch export complete"));
+
+  m_canvas->refresh();
+}
+
+void MainWindow::onBatchExport(BatchExportEvent& e) {
+  auto sz = m_canvas->GetClientSize();
+  double aspect = static_cast<double>(sz.x) / static_cast<double>(sz.y);
+
+  std::vector<ExportJob> jobs;
+
+  for (auto& entry : m_locationsPage->getLocations()) {
+    for (int h : e.heights) {
+      ExportJob job;
+      job.name = entry.first;
+      job.x = entry.second.x;
+      job.y = entry.second.y;
+      job.magnification = entry.second.magnification;
+      job.w = static_cast<int>(h * aspect);
+      job.h = h;
+      job.maxIterations = m_renderer->getMaxIterations();
+      job.colourScheme = m_colourSchemePage->getColourSchemeName();
+      job.computeColourImpl = m_renderer->getColourSchemeImpl();
+      job.filePath = joinPaths(e.dirPath.ToStdString(),
+                               exportFileName(job.name, job.w, job.h));
+
+      jobs.push_back(job);
+    }
+  }
+
+  m_exportQueue->setJobs(jobs);
+  runExportQueue();
+}
+
+void MainWindow::onResumeBatchExport(wxCommandEvent&) {
+  runExportQueue();
+}
+
+Keyframe MainWindow::makeKeyframe(const string& locationName,
+                                  double time) const {
+  View view = m_renderer->getView();
+  if (!locationName.empty()) {
+    auto& record = m_locationsPage->getLocations().at(locationName);
+    view = View::fromStrings(record.x, record.y, record.magnification);
+  }
+
+  return Keyframe{time, view};
+}
+
+void MainWindow::onRenderVideo(RenderVideoEvent& e) {
+  VideoParams params = e.params;
+  params.maxIterations = m_renderer->getMaxIterations();
+
+  try {
+    params.keyframes.push_back(makeKeyframe(e.startLocation, 0.0));
+    params.keyframes.push_back(makeKeyframe(e.endLocation, params.duration));
+  }
+  catch (const std::invalid_argument& ex) {
+    SetStatusText(ex.what());
+    return;
+  }
+
+  m_doingExport = true;
+  m_videoPage->setBusy(true);
+  m_exportPage->setBusy(true);
+  m_paramsPage->disable();
+  m_colourSchemePage->disable();
+  m_locationsPage->disable();
+  m_canvas->disable();
+
+  VideoRenderer video(params, [this](const IterationData& data,
+                                     uint8_t* buffer) {
+    m_renderer->colourIterationData(data, buffer);
+  });
+
+  video.start();
+
+  while (video.continueRender()) {
+    m_videoPage->setProgress(video.progress());
+    SetStatusText(video.stageStatsString());
+    wxYield();
+
+    if (m_quitting) {
+      break;
+    }
+  }
+
+  video.cancel();
+
+  m_doingExport = false;
+  m_videoPage->setBusy(false);
+  m_exportPage->setBusy(false);
+
+  if (m_quitting) {
+    Close();
+    return;
+  }
+
+  m_paramsPage->enable();
+  m_colourSchemePage->enable();
+  m_locationsPage->enable();
+  m_canvas->enable();
+
+  if (video.getError().empty()) {
+    SetStatusText(wxGetTranslation("Video complete") + ": " +
+                  video.stageStatsString());
+  }
+  else {
+    SetStatusText(video.getError());
+  }
+
+  m_canvas->refresh();
+}
+
 void MainWindow::onApplyParams(ApplyParamsEvent& e) {
-  m_renderer->setMaxIterations(e.maxI);
+  if (!e.autoMaxI) {
+    m_renderer->setMaxIterations(e.maxI);
+  }
+  m_renderer->setAutoMaxIterations(e.autoMaxI);
   m_canvas->setZoomAmount(e.zoomAmount);
   m_canvas->setTargetFps(e.targetFps);
   m_canvas->setZoomPerFrame(e.zoomPerFrame);
@@ -233,8 +675,14 @@ void MainWindow::onApplyParams(ApplyParamsEvent& e) {
 }
 
 void MainWindow::onApplyLocation(ApplyLocationEvent& e) {
-  m_renderer->resetZoom();
-  m_renderer->graphSpaceZoom(e.x, e.y, e.magnification);
+  try {
+    m_renderer->setView(View::fromStrings(e.x, e.y, e.magnification));
+  }
+  catch (const std::invalid_argument& ex) {
+    SetStatusText(ex.what());
+    return;
+  }
+
   m_canvas->refresh();
 }
 
@@ -7,6 +7,9 @@
 #include <wx/notebook.h>
 #include "canvas.hpp"
 #include "renderer.hpp"
+#include "export_queue.hpp"
+#include "locations_page.hpp"
+#include "perturbation_engine.hpp"
 
 const int WINDOW_W = 1000;
 const int WINDOW_H = 600;
@@ -15,10 +18,14 @@ class ColourSchemePage;
 class InfoPage;
 class ExportPage;
 class ExportEvent;
+class BatchExportEvent;
+class RecolourEvent;
 class ParamsPage;
 class ApplyParamsEvent;
-class LocationsPage;
 class ApplyLocationEvent;
+class VideoPage;
+class RenderVideoEvent;
+struct Keyframe;
 
 class MainWindow : public wxFrame {
 public:
@@ -33,12 +40,21 @@ private:
   void constructColourSchemePage();
   void constructLocationsPage();
   void constructExportPage();
+  void constructVideoPage();
 
   void onRender();
   void makeGlContextCurrent();
   void applyColourScheme(const std::string& code);
-  uint8_t* beginExport(int w, int h);
-  void endExport(const wxString& exportFilePath, int w, int h, uint8_t* data);
+  Keyframe makeKeyframe(const std::string& locationName, double time) const;
+  uint8_t* beginExport(int w, int h, int maxSamples,
+                       IterationData* iterations = nullptr);
+  void endExport(const wxString& exportFilePath, int w, int h, uint8_t* data,
+                 const IterationData* iterations = nullptr);
+  uint8_t* renderOffline(int w, int h, int maxSamples = 1,
+                         IterationData* iterations = nullptr);
+  uint8_t* renderDeep(int w, int h, IterationData* iterations);
+  uint8_t* renderExportJob(const ExportJob& job);
+  void runExportQueue();
 
   void onExit(wxCommandEvent& e);
   void onAbout(wxCommandEvent& e);
@@ -46,6 +62,11 @@ private:
   void onApplyParams(ApplyParamsEvent& e);
   void onApplyLocation(ApplyLocationEvent& e);
   void onExport(ExportEvent& e);
+  void onBatchExport(BatchExportEvent& e);
+  void onResumeBatchExport(wxCommandEvent& e);
+  void onRecolour(RecolourEvent& e);
+  void onRenderVideo(RenderVideoEvent& e);
+  void onPageChanged(wxBookCtrlEvent& e);
   void onCanvasResize(wxSizeEvent& e);
   void onCanvasGainFocus(wxFocusEvent& e);
   void onCanvasLoseFocus(wxFocusEvent& e);
@@ -53,7 +74,15 @@ private:
 
   bool m_quitting = false;
   bool m_doingExport = false;
+  double m_exportSamplesPerPixel = 1.0;
+  // Reference orbits used by the last export, if it was rendered by
+  // perturbation
+  int m_exportReferences = 0;
+  // Last limit chosen in auto mode
+  int m_autoMaxIterations = -1;
   std::unique_ptr<Renderer> m_renderer;
+  std::unique_ptr<ExportQueue> m_exportQueue;
+  std::unique_ptr<PerturbationEngine> m_perturbationEngine;
   wxSplitterWindow* m_splitter = nullptr;
   wxBoxSizer* m_vbox = nullptr;
   wxNotebook* m_rightPanel = nullptr;
@@ -64,6 +93,7 @@ private:
   ParamsPage* m_paramsPage = nullptr;
   LocationsPage* m_locationsPage = nullptr;
   ExportPage* m_exportPage = nullptr;
+  VideoPage* m_videoPage = nullptr;
 
   wxDECLARE_EVENT_TABLE();
 };
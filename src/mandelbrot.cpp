@@ -1,6 +1,11 @@
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
 #include "mandelbrot.hpp"
-#include "exception.hpp"
+#include "perturbation_engine.hpp"
 #include "render_utils.hpp"
+#include "exception.hpp"
 #include "utils.hpp"
 #include "defaults.hpp"
 
@@ -51,32 +56,118 @@ const std::map<string, string> PRESETS = {
   }
 };
 
-static const string COMPUTE_COLOUR_IMPL_SEARCH_STRING = "COMPUTE_COLOUR_IMPL";
-
+// Offline renders are drawn in strips of roughly this many pixels, so narrow
+// exports aren't split into many tiny draw calls
+static const int OFFLINE_RENDER_STRIP_PIXELS = 500000;
+static const int MIN_OFFLINE_RENDER_STRIP_H = 50;
+
+// Standard deviation of luminance or normalised iteration count across a
+// pixel's neighbourhood above which it gets extra samples
+static const float AA_THRESHOLD = 0.03f;
+
+// Entries in a baked palette. A scheme that cycles ten times over the
+// iteration range still gets 200 entries per cycle.
+static const int PALETTE_ENTRIES = 2048;
+
+// Largest per-channel difference between test bakes for a colour scheme to
+// be baked, allowing for 8-bit rounding
+static const float PALETTE_TOLERANCE = 0.01f;
+
+// The double precision shader is used once a pixel spans fewer than this
+// many single precision ulps of the largest coordinate in view
+static const double MIN_FLOAT_ULPS_PER_PIXEL = 16.0;
+
+// The shader holds pixel offsets in the precision it was compiled with, so
+// is only used while a pixel is well clear of the smallest normal value
+static const double MIN_PERTURBATION_PIXEL_SIZE_FLOAT = 1e-30;
+static const double MIN_PERTURBATION_PIXEL_SIZE_DOUBLE = 1e-290;
+
+// Same bailout as the shaders
+static const double RADIUS = 10000.0;
+
+// Reference orbits are computed with this many bits more than the view
+// needs, so they can be reused as it's zoomed into by up to 2^this. A new
+// one is started in the background once half the headroom is used up.
+static const unsigned long REFERENCE_HEADROOM_BITS = 16;
+
+static const size_t MAX_CACHED_REFERENCES = 16;
+
+// A new reference is started in the background at the view's centre once
+// the current one is this many view heights from it, so it's ready by the
+// time the current one drifts out of range
+static const double REFERENCE_PREFETCH_DISTANCE = 0.25;
+
+// Width of the orbit texture, which GL 3.3 guarantees. The orbit wraps onto
+// as many rows as it needs.
+static const int ORBIT_TEXTURE_W = 1024;
+
+// The last frame is held while a reference is computed only if the view is
+// within this factor of its size, beyond which it's too blurred or too small
+// to be worth showing
+static const double MAX_HELD_TEXTURE_ZOOM = 16.0;
+
+static const char* FP64_PREAMBLE =
+  "#extension GL_ARB_gpu_shader_fp64 : require\n"
+  "#define USE_FP64\n";
+
+// Range of the automatic iteration limit
+static const int AUTO_MIN_ITERATIONS = 64;
+static const int AUTO_MAX_ITERATIONS = 1000000;
+
+// Iteration statistics are collected over at most this many pixels, sampled
+// evenly from the frame
+static const int STATS_GRID_W = 160;
+static const int STATS_GRID_H = 120;
+
+// Texture units the palette and previous orbit state are bound to while
+// rendering
+static const int PALETTE_TEXTURE_UNIT = 1;
+static const int ORBIT_STATE_TEXTURE_UNIT = 2;
+static const int REFERENCE_ORBIT_TEXTURE_UNIT = 3;
+static const int ORBIT_STATE_FP64_TEXTURE_UNIT = 4;
+
+// The left edge of the initial view. It's widened to the right to fill the
+// canvas.
 static const double INITIAL_XMIN = -2.5;
-static const double INITIAL_XMAX = 1.5;
-static const double INITIAL_YMIN = -2.0;
-static const double INITIAL_YMAX = 2.0;
 
-OfflineRenderStatus::OfflineRenderStatus(int w, int h, int stripH)
+OfflineRenderStatus::OfflineRenderStatus(int w, int h, int stripH,
+                                         int maxSamples)
   : w(w),
     h(h),
     progress(0),
     data(nullptr),
     stripsDrawn(0),
-    stripH(stripH) {
+    stripH(stripH),
+    maxSamples(maxSamples) {
 
   totalStrips = h / stripH;
   finalStripH = stripH + (h % stripH);
 }
 
-Mandelbrot::Mandelbrot() {
+double OfflineRenderStatus::samplesPerPixel() const {
+  long long pixels = static_cast<long long>(stripsDrawn) * stripH * w;
+  if (stripsDrawn == totalStrips) {
+    pixels = static_cast<long long>(w) * h;
+  }
+
+  return pixels > 0 ? static_cast<double>(samples) / pixels : 0.0;
+}
+
+Mandelbrot::Mandelbrot()
+  : m_references(MAX_CACHED_REFERENCES),
+    m_orbitThread(1, ThreadPool::LOW) {
+
   m_renderParams.w = 100;
   m_renderParams.h = 100;
-  m_mandelbrotVertShaderPath = appDataPath("mandelbrot_vert_shader.glsl");
-  m_mandelbrotFragShaderPath = appDataPath("mandelbrot_frag_shader.glsl");
-  m_texVertShaderPath = appDataPath("textured_vert_shader.glsl");
-  m_texFragShaderPath = appDataPath("textured_frag_shader.glsl");
+  m_renderParams.aaMaxSamples = 1;
+  m_doubleProgram.doublePrecision = true;
+  m_mandelbrotVertShaderName = "mandelbrot_vert_shader.glsl";
+  m_mandelbrotFragShaderName = "mandelbrot_frag_shader.glsl";
+  m_texVertShaderName = "textured_vert_shader.glsl";
+  m_texFragShaderName = "textured_frag_shader.glsl";
+  m_colourFragShaderName = "colour_frag_shader.glsl";
+  m_paletteFragShaderName = "palette_frag_shader.glsl";
+  m_perturbationFragShaderName = "perturbation_frag_shader.glsl";
 }
 
 void Mandelbrot::initialise(int w, int h) {
@@ -97,49 +188,74 @@ void Mandelbrot::initialise(int w, int h) {
   GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(vertexBufferData),
                         vertexBufferData, GL_STATIC_DRAW));
 
-  m_texProgram = compileProgram(m_texVertShaderPath, m_texFragShaderPath);
+  m_texProgram = m_programCache.getProgram(m_texVertShaderName,
+                                          m_texFragShaderName);
+  m_texOffsetLocation =
+    GL_CHECK(glGetUniformLocation(m_texProgram, "u_texOffset"));
+  m_texScaleLocation =
+    GL_CHECK(glGetUniformLocation(m_texProgram, "u_texScale"));
 
   string computeColourImpl = PRESETS.at(DEFAULT_COLOUR_SCHEME);
   compileProgram_(computeColourImpl);
   m_activeComputeColourImpl = computeColourImpl;
+  bakePalette(computeColourImpl);
 
   m_renderParams.maxIterations = DEFAULT_MAX_ITERATIONS;
-  m_renderParams.xmin = INITIAL_XMIN;
-  m_renderParams.xmax = INITIAL_XMAX;
-  m_renderParams.ymin = INITIAL_YMIN;
-  m_renderParams.ymax = INITIAL_YMAX;
 
   initUniforms();
 
+  m_profiler.initialise();
+
   m_initialised = true;
 
-  resize(w, h);
+  m_renderParams.w = w;
+  m_renderParams.h = h;
+  reset();
 }
 
 void Mandelbrot::reset() {
-  m_renderParams.xmin = INITIAL_XMIN;
-  m_renderParams.ymin = INITIAL_YMIN;
-  m_renderParams.ymax = INITIAL_YMAX;
+  m_view = View();
 
+  // Moved right so the left edge stays put however wide the canvas is
+  double xmin = 0.0, xmax = 0.0, ymin = 0.0, ymax = 0.0;
   double aspect = static_cast<double>(m_renderParams.w) /
                   static_cast<double>(m_renderParams.h);
-  m_renderParams.xmax = m_renderParams.xmin + aspect *
-                        (m_renderParams.ymax - m_renderParams.ymin);
+  m_view.getBounds(aspect, xmin, xmax, ymin, ymax);
+  m_view.translate((INITIAL_XMIN - xmin) / m_view.height(), 0.0);
+
+  updateBounds();
 }
 
+// The left edge and the height stay where they are, so a wider canvas shows
+// more to the right
 void Mandelbrot::resize(int w, int h) {
-  double yScale = static_cast<double>(h) /
-                  static_cast<double>(m_renderParams.h);
-  double expectedW = m_renderParams.w * yScale;
-  double xScale = w / expectedW;
-  double xRange = m_renderParams.xmax - m_renderParams.xmin;
-  m_renderParams.xmax = m_renderParams.xmin + xRange * xScale;
+  double oldAspect = static_cast<double>(m_renderParams.w) /
+                     static_cast<double>(m_renderParams.h);
+  double newAspect = static_cast<double>(w) / static_cast<double>(h);
+  m_view.translate(0.5 * (newAspect - oldAspect), 0.0);
 
   m_renderParams.w = w;
   m_renderParams.h = h;
+
+  updateBounds();
+}
+
+void Mandelbrot::updateBounds() {
+  auto& rp = m_renderParams;
+  double aspect = static_cast<double>(rp.w) / static_cast<double>(rp.h);
+
+  m_view.getBounds(aspect, rp.xmin, rp.xmax, rp.ymin, rp.ymax);
 }
 
 GLuint Mandelbrot::renderToTexture(int w, int h) {
+  return renderToTexture(w, h, [this]() {
+    render();
+  });
+}
+
+GLuint Mandelbrot::renderToTexture(int w, int h,
+                                   const std::function<void()>& fnDraw,
+                                   GLint internalFormat) {
   GLuint frameBufferName = 0;
   GL_CHECK(glGenFramebuffers(1, &frameBufferName));
   GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, frameBufferName));
@@ -149,7 +265,7 @@ GLuint Mandelbrot::renderToTexture(int w, int h) {
   GL_CHECK(glGenTextures(1, &texture));
   GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
 
-  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB,
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, GL_RGB,
                         GL_UNSIGNED_BYTE, nullptr));
 
   GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
@@ -166,13 +282,235 @@ GLuint Mandelbrot::renderToTexture(int w, int h) {
     GL_EXCEPTION("Error creating render target", status);
   }
 
-  render();
+  fnDraw();
 
   GL_CHECK(glDeleteFramebuffers(1, &frameBufferName));
 
   return texture;
 }
 
+// Holds the shader's second output: final z, iteration count, and 1 if the
+// point escaped. With fp64, the third output holds z exactly, as the bits of
+// two doubles.
+static GLuint createStateTexture(int w, int h, bool fp64 = false) {
+  GLuint state = 0;
+  GL_CHECK(glGenTextures(1, &state));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, state));
+  if (fp64) {
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32UI, w, h, 0,
+                          GL_RGBA_INTEGER, GL_UNSIGNED_INT, nullptr));
+  }
+  else {
+    GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, w, h, 0, GL_RGBA,
+                          GL_FLOAT, nullptr));
+  }
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+
+  return state;
+}
+
+// Attaches the state textures to the bound framebuffer alongside the colour
+static void attachStateTexture(GLuint state, GLuint stateFp64 = 0) {
+  GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, state,
+                                0));
+
+  GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+                            GL_COLOR_ATTACHMENT2 };
+  if (stateFp64 != 0) {
+    GL_CHECK(glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2,
+                                  stateFp64, 0));
+    GL_CHECK(glDrawBuffers(3, drawBuffers));
+  }
+  else {
+    GL_CHECK(glDrawBuffers(2, drawBuffers));
+  }
+}
+
+bool Mandelbrot::canResumeFromOrbitState() const {
+  auto& rp = m_renderParams;
+  auto& os = m_orbitState;
+
+  return os.texture != 0 &&
+         os.resumable &&
+         os.doublePrecision == m_program->doublePrecision &&
+         os.w == rp.w &&
+         os.h == rp.h &&
+         os.xmin == rp.xmin &&
+         os.xmax == rp.xmax &&
+         os.ymin == rp.ymin &&
+         os.ymax == rp.ymax &&
+         os.maxIterations <= rp.maxIterations;
+}
+
+void Mandelbrot::discardOrbitState() {
+  GL_CHECK(glDeleteTextures(1, &m_orbitState.texture));
+  GL_CHECK(glDeleteTextures(1, &m_orbitState.fp64Texture));
+  m_orbitState.texture = 0;
+  m_orbitState.fp64Texture = 0;
+}
+
+// Renders the view and records each pixel's orbit alongside its colour. If
+// only the iteration limit has gone up since the last render, escaped
+// pixels are reused and the rest carry on from where they stopped, so
+// deepening costs just the extra iterations.
+GLuint Mandelbrot::renderWithOrbitState() {
+  auto& rp = m_renderParams;
+
+  selectProgram();
+  bool fp64 = m_program->doublePrecision && !m_perturbing;
+
+  GLuint state = createStateTexture(rp.w, rp.h);
+  GLuint stateFp64 = fp64 ? createStateTexture(rp.w, rp.h, true) : 0;
+
+  m_resumeFromOrbitState = canResumeFromOrbitState();
+
+  GLuint texture = renderToTexture(rp.w, rp.h, [&]() {
+    attachStateTexture(state, stateFp64);
+
+    if (m_resumeFromOrbitState) {
+      GL_CHECK(glActiveTexture(GL_TEXTURE0 + ORBIT_STATE_TEXTURE_UNIT));
+      GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_orbitState.texture));
+      if (fp64) {
+        GL_CHECK(glActiveTexture(GL_TEXTURE0 + ORBIT_STATE_FP64_TEXTURE_UNIT));
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_orbitState.fp64Texture));
+      }
+      GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    }
+
+    render();
+  });
+
+  m_resumeFromOrbitState = false;
+
+  discardOrbitState();
+
+  auto& os = m_orbitState;
+  os.texture = state;
+  os.fp64Texture = stateFp64;
+  os.w = rp.w;
+  os.h = rp.h;
+  os.maxIterations = rp.maxIterations;
+  os.xmin = rp.xmin;
+  os.xmax = rp.xmax;
+  os.ymin = rp.ymin;
+  os.ymax = rp.ymax;
+  // A perturbed pixel's state is an offset from its reference orbit, which
+  // isn't kept
+  os.resumable = !m_perturbing;
+  os.doublePrecision = fp64;
+
+  return texture;
+}
+
+// Copies a coarse grid of the orbit state into a pixel pack buffer. The copy
+// runs on the GPU behind the frame, and collectIterationStats picks it up
+// once it's done, so the CPU never waits for it.
+void Mandelbrot::requestIterationStats() {
+  auto& os = m_orbitState;
+  auto& rb = m_statsReadback;
+  if (os.texture == 0 || rb.fence != nullptr) {
+    return;
+  }
+
+  int w = std::min(os.w, STATS_GRID_W);
+  int h = std::min(os.h, STATS_GRID_H);
+
+  GLuint grid = 0;
+  GL_CHECK(glGenTextures(1, &grid));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, grid));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, w, h, 0, GL_RGBA,
+                        GL_FLOAT, nullptr));
+
+  GLuint frameBuffers[2];
+  GL_CHECK(glGenFramebuffers(2, frameBuffers));
+
+  GL_CHECK(glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffers[0]));
+  GL_CHECK(glFramebufferTexture(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                os.texture, 0));
+  GL_CHECK(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frameBuffers[1]));
+  GL_CHECK(glFramebufferTexture(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                grid, 0));
+
+  // Nearest filtering picks whole pixels rather than averaging their state
+  GL_CHECK(glBlitFramebuffer(0, 0, os.w, os.h, 0, 0, w, h,
+                             GL_COLOR_BUFFER_BIT, GL_NEAREST));
+
+  GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+  GL_CHECK(glDeleteFramebuffers(2, frameBuffers));
+
+  if (rb.buffer == 0) {
+    GL_CHECK(glGenBuffers(1, &rb.buffer));
+  }
+
+  // With a pack buffer bound, this only queues the copy. The grid isn't
+  // freed until the copy is done.
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer));
+  GL_CHECK(glBufferData(GL_PIXEL_PACK_BUFFER, w * h * 4 * sizeof(float),
+                        nullptr, GL_STREAM_READ));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, grid));
+  GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, nullptr));
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  GL_CHECK(glDeleteTextures(1, &grid));
+
+  rb.fence = GL_CHECK(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+  rb.w = w;
+  rb.h = h;
+  rb.maxIterations = os.maxIterations;
+
+  // So the fence is reached even if no more frames are drawn
+  GL_CHECK(glFlush());
+}
+
+bool Mandelbrot::collectIterationStats() {
+  auto& rb = m_statsReadback;
+  if (rb.fence == nullptr) {
+    return false;
+  }
+
+  GLenum status = GL_CHECK(glClientWaitSync(rb.fence, 0, 0));
+  if (status == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+
+  GL_CHECK(glDeleteSync(rb.fence));
+  rb.fence = nullptr;
+
+  if (status == GL_WAIT_FAILED) {
+    return false;
+  }
+
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer));
+  void* samples = GL_CHECK(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                            rb.w * rb.h * 4 * sizeof(float),
+                                            GL_MAP_READ_BIT));
+  if (samples != nullptr) {
+    m_iterationStats =
+      IterationStats::fromOrbitState(static_cast<const float*>(samples), rb.w,
+                                     rb.h, rb.maxIterations);
+    GL_CHECK(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+  }
+  GL_CHECK(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+  if (samples == nullptr) {
+    return false;
+  }
+
+  // Statistics from before the limit last changed would undo the change
+  if (m_autoMaxIterations &&
+      rb.maxIterations == m_renderParams.maxIterations) {
+    m_renderParams.maxIterations =
+      m_iterationStats.suggestMaxIterations(AUTO_MIN_ITERATIONS,
+                                            AUTO_MAX_ITERATIONS);
+  }
+
+  return true;
+}
+
+bool Mandelbrot::iterationStatsPending() const {
+  return m_statsReadback.fence != nullptr;
+}
+
 void Mandelbrot::renderStripToMainMemoryBuffer(uint8_t* buffer) {
   auto& rp = m_renderParams;
   auto& rpb = m_renderParamsBackup;
@@ -183,18 +521,106 @@ void Mandelbrot::renderStripToMainMemoryBuffer(uint8_t* buffer) {
   double stripH_gph = (rpb.ymax - rpb.ymin) *
                       (static_cast<double>(stripH) / static_cast<double>(s.h));
 
-  GL_CHECK(glUseProgram(m_program.id));
+  GL_CHECK(glUseProgram(m_program->id));
 
   rp.h = stripH;
   rp.ymax = rp.ymin + stripH_gph;
   GL_CHECK(glViewport(0, 0, s.w, stripH));
 
-  GLuint texture = renderToTexture(s.w, stripH);
+  if (s.iterations != nullptr) {
+    PixelResult* pixels = s.iterations->pixels.data() +
+                          static_cast<size_t>(i) * s.stripH * s.w;
+    renderIterationStrip(buffer, pixels, s.w, stripH);
+  }
+  else if (s.maxSamples > 1) {
+    renderAntiAliasedStrip(buffer, s.w, stripH);
+  }
+  else {
+    GLuint texture = renderToTexture(s.w, stripH);
+
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+    GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer));
+    GL_CHECK(glDeleteTextures(1, &texture));
+
+    s.samples += static_cast<long long>(s.w) * stripH;
+  }
+
+  rp.ymin += stripH_gph;
+}
+
+// Renders the strip once at one sample per pixel, then again with extra
+// samples only where the first pass shows high local variance
+void Mandelbrot::renderAntiAliasedStrip(uint8_t* buffer, int w, int h) {
+  auto& rp = m_renderParams;
+  auto& s = m_offlineRenderStatus;
+  auto stripParams = rp;
+
+  // The first pass has an extra row above and below, so pixels at the edges
+  // of the strip see their true neighbours
+  double pixelH = (rp.ymax - rp.ymin) / h;
+  rp.h = h + 2;
+  rp.ymin -= pixelH;
+  rp.ymax += pixelH;
+  rp.aaMaxSamples = 1;
+
+  GLuint firstPass = renderToTexture(w, h + 2, [this]() {
+    render();
+  }, GL_RGBA32F);
+
+  rp = stripParams;
+
+  GLuint texture = renderToTexture(w, h, [&]() {
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, firstPass));
+
+    render();
+  }, GL_RGBA8);
+
+  std::vector<uint8_t> rgba(w * h * 4);
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         rgba.data()));
+
+  for (int i = 0; i < w * h; ++i) {
+    buffer[i * 3 + 0] = rgba[i * 4 + 0];
+    buffer[i * 3 + 1] = rgba[i * 4 + 1];
+    buffer[i * 3 + 2] = rgba[i * 4 + 2];
+    s.samples += rgba[i * 4 + 3];
+  }
+
+  GL_CHECK(glDeleteTextures(1, &texture));
+  GL_CHECK(glDeleteTextures(1, &firstPass));
+}
+
+// Renders the strip with the orbit state attached and unpacks the state into
+// escape results, laid out as the CPU engine's
+void Mandelbrot::renderIterationStrip(uint8_t* buffer, PixelResult* pixels,
+                                      int w, int h) {
+  auto& s = m_offlineRenderStatus;
+
+  GLuint state = createStateTexture(w, h);
+
+  GLuint texture = renderToTexture(w, h, [&]() {
+    attachStateTexture(state);
+    render();
+  });
 
   GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
   GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer));
 
-  rp.ymin += stripH_gph;
+  std::vector<float> rgba(static_cast<size_t>(w) * h * 4);
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, state));
+  GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data()));
+
+  for (size_t i = 0; i < static_cast<size_t>(w) * h; ++i) {
+    pixels[i] = PixelResult{rgba[i * 4 + 2], rgba[i * 4 + 0],
+                            rgba[i * 4 + 1]};
+  }
+
+  GL_CHECK(glDeleteTextures(1, &texture));
+  GL_CHECK(glDeleteTextures(1, &state));
+
+  s.samples += static_cast<long long>(w) * h;
 }
 
 const OfflineRenderStatus& Mandelbrot::continueOfflineRender() {
@@ -215,53 +641,532 @@ const OfflineRenderStatus& Mandelbrot::continueOfflineRender() {
   return m_offlineRenderStatus;
 }
 
-void Mandelbrot::renderToMainMemoryBuffer(int w, int h) {
+void Mandelbrot::renderToMainMemoryBuffer(int w, int h, int maxSamples,
+                                          IterationData* iterations) {
   INIT_EXCEPT
 
-  int renderStripH = std::min(h, 50);
+  // The escape results are per pixel, so extra samples couldn't be stored
+  if (iterations != nullptr) {
+    *iterations = IterationData(w, h);
+    iterations->maxIterations = m_renderParams.maxIterations;
+    maxSamples = 1;
+  }
+
+  int renderStripH = std::min(h, std::max(MIN_OFFLINE_RENDER_STRIP_H,
+                                          OFFLINE_RENDER_STRIP_PIXELS / w));
+
+  // The sample count is read back through an 8-bit channel
+  maxSamples = std::max(1, std::min(255, maxSamples));
+
+  // Strips are rendered by the other programs, which take their bounds from
+  // the render params
+  m_perturbing = false;
 
   m_renderParamsBackup = m_renderParams;
-  m_offlineRenderStatus = OfflineRenderStatus(w, h, renderStripH);
+  m_offlineRenderStatus = OfflineRenderStatus(w, h, renderStripH, maxSamples);
 
   size_t bytes = w * h * 3;
   m_offlineRenderStatus.data = new uint8_t[bytes];
+  m_offlineRenderStatus.iterations = iterations;
 
   m_renderParams.w = w;
+  m_renderParams.aaMaxSamples = maxSamples;
+}
+
+void Mandelbrot::compileColourProgram() {
+  // Left at 0 if compilation fails, so it's retried on next use
+  GLuint previous = m_colourProgram.id;
+  m_colourProgram.id = 0;
+  m_programCache.releaseProgram(previous);
+
+  m_colourProgram.id =
+    m_programCache.getProgram(m_mandelbrotVertShaderName,
+                              m_colourFragShaderName,
+                              m_activeComputeColourImpl);
+  m_colourProgram.computeColourImpl = m_activeComputeColourImpl;
+
+  m_colourProgram.u.maxIterations =
+    GL_CHECK(glGetUniformLocation(m_colourProgram.id, "u_maxIterations"));
+}
+
+void Mandelbrot::colourIterationData(const IterationData& data,
+                                     uint8_t* buffer) {
+  INIT_EXCEPT
+
+  // Cheaper than a round trip through the GPU
+  if (!m_palette.empty()) {
+    m_palette.colour(data, buffer);
+    return;
+  }
+
+  if (m_colourProgram.id == 0 ||
+      m_colourProgram.computeColourImpl != m_activeComputeColourImpl) {
+
+    compileColourProgram();
+  }
+
+  GLuint dataTexture = 0;
+  GL_CHECK(glGenTextures(1, &dataTexture));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, dataTexture));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, data.w, data.h, 0, GL_RGB,
+                        GL_FLOAT, data.pixels.data()));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+
+  GLuint texture = renderToTexture(data.w, data.h, [&]() {
+    GL_CHECK(glUseProgram(m_colourProgram.id));
+    GL_CHECK(glViewport(0, 0, data.w, data.h));
+    GL_CHECK(glUniform1i(m_colourProgram.u.maxIterations, data.maxIterations));
+
+    GL_CHECK(glActiveTexture(GL_TEXTURE0));
+    GL_CHECK(glBindTexture(GL_TEXTURE_2D, dataTexture));
+
+    drawQuad();
+  });
+
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer));
+
+  GL_CHECK(glDeleteTextures(1, &texture));
+  GL_CHECK(glDeleteTextures(1, &dataTexture));
 }
 
 void Mandelbrot::initUniforms() {
-  GL_CHECK(glUseProgram(m_program.id));
+  initUniforms(m_floatProgram);
+
+  if (m_doubleProgram.id != 0) {
+    initUniforms(m_doubleProgram);
+  }
 
-  m_program.u.w = GL_CHECK(glGetUniformLocation(m_program.id, "u_w"));
-  m_program.u.h = GL_CHECK(glGetUniformLocation(m_program.id, "u_h"));
-  m_program.u.maxIterations = GL_CHECK(glGetUniformLocation(m_program.id,
-                                                            "u_maxIterations"));
-  m_program.u.xmin = GL_CHECK(glGetUniformLocation(m_program.id, "u_xmin"));
-  m_program.u.xmax = GL_CHECK(glGetUniformLocation(m_program.id, "u_xmax"));
-  m_program.u.ymin = GL_CHECK(glGetUniformLocation(m_program.id, "u_ymin"));
-  m_program.u.ymax = GL_CHECK(glGetUniformLocation(m_program.id, "u_ymax"));
+  if (m_perturbationProgram.id != 0) {
+    initPerturbationUniforms();
+  }
 
+  selectProgram();
   updateUniforms();
 }
 
+void Mandelbrot::initUniforms(MandelbrotProgram& program) {
+  GLuint id = program.id;
+  auto& u = program.u;
+
+  GL_CHECK(glUseProgram(id));
+
+  u.w = GL_CHECK(glGetUniformLocation(id, "u_w"));
+  u.h = GL_CHECK(glGetUniformLocation(id, "u_h"));
+  u.maxIterations = GL_CHECK(glGetUniformLocation(id, "u_maxIterations"));
+  u.xmin = GL_CHECK(glGetUniformLocation(id, "u_xmin"));
+  u.xmax = GL_CHECK(glGetUniformLocation(id, "u_xmax"));
+  u.ymin = GL_CHECK(glGetUniformLocation(id, "u_ymin"));
+  u.ymax = GL_CHECK(glGetUniformLocation(id, "u_ymax"));
+  u.aaMaxSamples = GL_CHECK(glGetUniformLocation(id, "u_aaMaxSamples"));
+  u.aaThreshold = GL_CHECK(glGetUniformLocation(id, "u_aaThreshold"));
+  u.usePalette = GL_CHECK(glGetUniformLocation(id, "u_usePalette"));
+  u.smoothPalette = GL_CHECK(glGetUniformLocation(id, "u_smoothPalette"));
+  u.palette = GL_CHECK(glGetUniformLocation(id, "u_palette"));
+  u.resume = GL_CHECK(glGetUniformLocation(id, "u_resume"));
+  u.state = GL_CHECK(glGetUniformLocation(id, "u_state"));
+  u.stateFp64 = GL_CHECK(glGetUniformLocation(id, "u_stateFp64"));
+
+  GL_CHECK(glUniform1i(u.palette, PALETTE_TEXTURE_UNIT));
+  GL_CHECK(glUniform1i(u.state, ORBIT_STATE_TEXTURE_UNIT));
+  if (program.doublePrecision) {
+    GL_CHECK(glUniform1i(u.stateFp64, ORBIT_STATE_FP64_TEXTURE_UNIT));
+  }
+}
+
+void Mandelbrot::initPerturbationUniforms() {
+  GLuint id = m_perturbationProgram.id;
+  auto& u = m_perturbationProgram.u;
+
+  GL_CHECK(glUseProgram(id));
+
+  u.maxIterations = GL_CHECK(glGetUniformLocation(id, "u_maxIterations"));
+  u.orbit = GL_CHECK(glGetUniformLocation(id, "u_orbit"));
+  u.orbitLength = GL_CHECK(glGetUniformLocation(id, "u_orbitLength"));
+  u.reference = GL_CHECK(glGetUniformLocation(id, "u_reference"));
+  u.pixelSize = GL_CHECK(glGetUniformLocation(id, "u_pixelSize"));
+  u.usePalette = GL_CHECK(glGetUniformLocation(id, "u_usePalette"));
+  u.smoothPalette = GL_CHECK(glGetUniformLocation(id, "u_smoothPalette"));
+  u.palette = GL_CHECK(glGetUniformLocation(id, "u_palette"));
+
+  GL_CHECK(glUniform1i(u.palette, PALETTE_TEXTURE_UNIT));
+  GL_CHECK(glUniform1i(u.orbit, REFERENCE_ORBIT_TEXTURE_UNIT));
+}
+
+// Switches to the double precision program when single precision can no
+// longer resolve neighbouring pixels
+void Mandelbrot::selectProgram() {
+  auto& rp = m_renderParams;
+
+  double pixelSize = (rp.ymax - rp.ymin) / rp.h;
+  double extent = std::max(std::max(std::abs(rp.xmin), std::abs(rp.xmax)),
+                           std::max(std::abs(rp.ymin), std::abs(rp.ymax)));
+  double ulp = extent * std::numeric_limits<float>::epsilon();
+
+  bool needDouble = pixelSize < ulp * MIN_FLOAT_ULPS_PER_PIXEL;
+
+  m_program = needDouble && m_doubleProgram.id != 0 ? &m_doubleProgram
+                                                    : &m_floatProgram;
+}
+
+bool Mandelbrot::usingDoublePrecision() const {
+  return m_program->doublePrecision;
+}
+
+bool Mandelbrot::usingPerturbation() const {
+  return m_perturbing;
+}
+
+bool Mandelbrot::referencePending() const {
+  return m_pendingOrbit.valid() &&
+         m_pendingOrbit.wait_for(std::chrono::seconds(0)) !=
+           std::future_status::ready;
+}
+
+// Decides whether the frame about to be rendered at the current size uses
+// perturbation, and if so makes sure a suitable reference orbit is in the
+// orbit texture. Orbits are computed in the background, so until one is
+// ready the last frame is held, or a deep view is drawn in double precision
+// if there's none to hold.
+bool Mandelbrot::preparePerturbation() {
+  auto& rp = m_renderParams;
+
+  m_awaitingReference = false;
+
+  double minPixelSize = m_perturbationProgram.doublePrecision
+                          ? MIN_PERTURBATION_PIXEL_SIZE_DOUBLE
+                          : MIN_PERTURBATION_PIXEL_SIZE_FLOAT;
+
+  if (m_perturbationProgram.id == 0 ||
+      !PerturbationEngine::needed(m_view, rp.h) ||
+      m_view.height() / rp.h < minPixelSize) {
+    return false;
+  }
+
+  if (m_pendingOrbit.valid() &&
+      m_pendingOrbit.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready) {
+    ReferenceCache::Entry entry;
+    entry.orbit = m_pendingOrbit.get();
+    m_references.add(entry);
+  }
+
+  PerturbationParams params;
+  params.w = rp.w;
+  params.h = rp.h;
+  params.maxIterations = rp.maxIterations;
+  params.view = m_view;
+
+  ReferenceCache::Entry entry;
+  double refX = 0.0;
+  double refY = 0.0;
+  bool found = m_references.find(params, false, entry, refX, refY);
+
+  // Started now, the next reference is computed while the GPU renders
+  // frames with the current one
+  if (!found) {
+    requestReferenceOrbit();
+    m_awaitingReference = referencePending();
+    return false;
+  }
+
+  double distance = std::hypot(refX - 0.5 * rp.w, refY - 0.5 * rp.h) / rp.h;
+  unsigned long bits = entry.orbit->x().precision();
+
+  if (distance > REFERENCE_PREFETCH_DISTANCE ||
+      bits < m_view.precisionBits() + REFERENCE_HEADROOM_BITS / 2) {
+    requestReferenceOrbit();
+  }
+
+  if (entry.orbit != m_uploadedOrbit && !uploadReferenceOrbit(entry.orbit)) {
+    return false;
+  }
+
+  m_referenceX = refX;
+  m_referenceY = refY;
+
+  return true;
+}
+
+// Computes an orbit at the view's centre on m_orbitThread, unless one is
+// already being computed
+void Mandelbrot::requestReferenceOrbit() {
+  if (m_pendingOrbit.valid()) {
+    return;
+  }
+
+  BigFloat x(m_view.x());
+  BigFloat y(m_view.y());
+  x.setPrecision(m_view.precisionBits() + REFERENCE_HEADROOM_BITS);
+  y.setPrecision(m_view.precisionBits() + REFERENCE_HEADROOM_BITS);
+  int maxIterations = m_renderParams.maxIterations;
+
+  m_pendingOrbit = m_orbitThread.run([x, y, maxIterations]() {
+    return std::shared_ptr<const ReferenceOrbit>(
+      std::make_shared<ReferenceOrbit>(x, y, maxIterations, RADIUS));
+  });
+}
+
+// Fails if the orbit is too long for a texture
+bool Mandelbrot::uploadReferenceOrbit(
+  const std::shared_ptr<const ReferenceOrbit>& orbit) {
+
+  // Z_-1 = 0 comes first, so a rebased pixel reads it at index 0
+  int texels = orbit->length() + 2;
+  int rows = (texels + ORBIT_TEXTURE_W - 1) / ORBIT_TEXTURE_W;
+
+  GLint maxSize = 0;
+  GL_CHECK(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize));
+  if (rows > maxSize) {
+    return false;
+  }
+
+  // Each point is rounded to floats, followed by what the rounding lost
+  std::vector<float> data(static_cast<size_t>(rows) * ORBIT_TEXTURE_W * 4,
+                          0.f);
+  for (int m = -1; m <= orbit->length(); ++m) {
+    float* texel = &data[(m + 1) * 4];
+    texel[0] = static_cast<float>(orbit->re()[m]);
+    texel[1] = static_cast<float>(orbit->im()[m]);
+    texel[2] = static_cast<float>(orbit->re()[m] - texel[0]);
+    texel[3] = static_cast<float>(orbit->im()[m] - texel[1]);
+  }
+
+  if (m_orbitTexture == 0) {
+    GL_CHECK(glGenTextures(1, &m_orbitTexture));
+  }
+
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_orbitTexture));
+  GL_CHECK(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, ORBIT_TEXTURE_W, rows,
+                        0, GL_RGBA, GL_FLOAT, data.data()));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+
+  m_uploadedOrbit = orbit;
+  return true;
+}
+
+void Mandelbrot::renderPerturbed() {
+  auto& rp = m_renderParams;
+  auto& u = m_perturbationProgram.u;
+
+  m_profiler.beginStage(FrameProfiler::UNIFORMS);
+
+  GL_CHECK(glUseProgram(m_perturbationProgram.id));
+  GL_CHECK(glViewport(0, 0, rp.w, rp.h));
+
+  GL_CHECK(glUniform1i(u.maxIterations, rp.maxIterations));
+  GL_CHECK(glUniform1i(u.orbitLength, m_uploadedOrbit->length()));
+  GL_CHECK(glUniform2f(u.reference, m_referenceX, m_referenceY));
+  if (m_perturbationProgram.doublePrecision) {
+    GL_CHECK(glUniform1d(u.pixelSize, m_view.height() / rp.h));
+  }
+  else {
+    GL_CHECK(glUniform1f(u.pixelSize, m_view.height() / rp.h));
+  }
+  GL_CHECK(glUniform1i(u.usePalette, !m_palette.empty()));
+  GL_CHECK(glUniform1i(u.smoothPalette, m_palette.smooth()));
+
+  GL_CHECK(glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_paletteTexture));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0 + REFERENCE_ORBIT_TEXTURE_UNIT));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_orbitTexture));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+
+  m_profiler.endStage(FrameProfiler::UNIFORMS);
+  m_profiler.beginStage(FrameProfiler::RENDER);
+
+  drawQuad();
+
+  m_profiler.endStage(FrameProfiler::RENDER);
+}
+
 void Mandelbrot::setColourSchemeImpl(const string& computeColourImpl) {
   INIT_GUARD
 
-  try {
-    GL_CHECK(glDeleteProgram(m_program.id));
-    compileProgram_(computeColourImpl);
+  // Programs belong to the cache, so if this throws the active program is
+  // left untouched
+  compileProgram_(computeColourImpl);
+  bakePalette(computeColourImpl);
+  initUniforms();
+}
+
+static void setPaletteTextureParams() {
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                           GL_CLAMP_TO_EDGE));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                           GL_CLAMP_TO_EDGE));
+}
+
+// Renders a palette of the given size with the maximum iteration count
+// equal to it, and reads it back. If keepTexture is true the texture becomes
+// the active palette texture.
+std::vector<float> Mandelbrot::renderPaletteSamples(int entries,
+                                                    int iterationOffset,
+                                                    float zx, float zy,
+                                                    bool keepTexture) {
+  GLuint texture = renderToTexture(entries + 1, 1, [&]() {
+    GL_CHECK(glUseProgram(m_paletteProgram.id));
+    GL_CHECK(glViewport(0, 0, entries + 1, 1));
+    GL_CHECK(glUniform1i(m_paletteProgram.u.entries, entries));
+    GL_CHECK(glUniform1i(m_paletteProgram.u.iterationOffset, iterationOffset));
+    GL_CHECK(glUniform2f(m_paletteProgram.u.lastZ, zx, zy));
+
+    drawQuad();
+  }, GL_RGB8);
+
+  std::vector<float> rgb((entries + 1) * 3);
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, texture));
+  GL_CHECK(glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, rgb.data()));
+
+  if (keepTexture) {
+    setPaletteTextureParams();
+    m_paletteTexture = texture;
+  }
+  else {
+    GL_CHECK(glDeleteTextures(1, &texture));
+  }
+
+  return rgb;
+}
+
+// Samples computeColour once per palette entry, so rendering needs one
+// texture fetch per pixel rather than the scheme's own arithmetic. This is
+// only valid if the scheme depends on the iteration count as a fraction of
+// the maximum, and on the final z only through the smooth iteration count.
+// That's checked by baking again with a different maximum, and with the
+// count and final z changed in ways that cancel. If the bakes differ, the
+// palette is left empty and computeColour runs per pixel.
+void Mandelbrot::bakePalette(const string& computeColourImpl) {
+  GLuint previous = m_paletteProgram.id;
+  m_paletteProgram.id =
+    m_programCache.getProgram(m_mandelbrotVertShaderName,
+                              m_paletteFragShaderName,
+                              computeColourImpl);
+  m_programCache.releaseProgram(previous);
+
+  auto& u = m_paletteProgram.u;
+  GLuint id = m_paletteProgram.id;
+  u.entries = GL_CHECK(glGetUniformLocation(id, "u_entries"));
+  u.iterationOffset = GL_CHECK(glGetUniformLocation(id, "u_iterationOffset"));
+  u.lastZ = GL_CHECK(glGetUniformLocation(id, "u_lastZ"));
+
+  GL_CHECK(glDeleteTextures(1, &m_paletteTexture));
+  m_paletteTexture = 0;
+  m_palette = Palette();
+
+  auto matches = [](const std::vector<float>& a, int ai,
+                    const std::vector<float>& b, int bi) {
+    for (int j = 0; j < 3; ++j) {
+      if (std::abs(a[ai * 3 + j] - b[bi * 3 + j]) > PALETTE_TOLERANCE) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  int n = PALETTE_ENTRIES;
+  int quarter = n / 4;
+
+  // With |z| = e, log2(log(|z|)) is 0, so the smooth count is i
+  float e = std::exp(1.f);
+  std::vector<float> rgb = renderPaletteSamples(n, 0, e, 0.f, true);
+  std::vector<float> coarse = renderPaletteSamples(quarter, 0, e, 0.f, false);
+
+  bool valid = true;
+  for (int k = 0; k <= quarter && valid; ++k) {
+    valid = matches(rgb, k * 4, coarse, k);
+  }
+
+  bool smooth = computeColourImpl.find("lastZ") != string::npos;
+
+  if (smooth && valid) {
+    // With |z| = e^2, log2(log(|z|)) is 1, so the smooth count is i - 1. The
+    // argument of z changes too, in case the scheme depends on it.
+    float r = e * e;
+    std::vector<float> shifted = renderPaletteSamples(n, 1, r * std::cos(1.f),
+                                                      r * std::sin(1.f),
+                                                      false);
+
+    // Entry n - 1 is shifted to the maximum iteration count, so it's skipped
+    for (int k = 0; k <= n && valid; ++k) {
+      valid = k == n - 1 || matches(rgb, k, shifted, k);
+    }
   }
-  catch (const ShaderException&) {
-    compileProgram_(m_activeComputeColourImpl);
-    throw;
+
+  if (valid) {
+    m_palette = Palette(std::move(rgb), smooth);
+  }
+  else {
+    GL_CHECK(glDeleteTextures(1, &m_paletteTexture));
+    m_paletteTexture = 0;
   }
 }
 
+const Palette& Mandelbrot::getPalette() const {
+  return m_palette;
+}
+
 void Mandelbrot::compileProgram_(const std::string& computeColourImpl) {
-  m_program.id = compileProgram(m_mandelbrotVertShaderPath,
-                                m_mandelbrotFragShaderPath,
-                                COMPUTE_COLOUR_IMPL_SEARCH_STRING,
-                                computeColourImpl);
+  GLuint floatId = m_programCache.getProgram(m_mandelbrotVertShaderName,
+                                             m_mandelbrotFragShaderName,
+                                             computeColourImpl);
+  GLuint doubleId = 0;
+
+  if (GLEW_ARB_gpu_shader_fp64) {
+    string vertSrc = shaderSource(m_mandelbrotVertShaderName);
+    string fragSrc = insertAfterVersion(
+      shaderSource(m_mandelbrotFragShaderName, computeColourImpl),
+      FP64_PREAMBLE);
+
+    // The colour scheme compiled in single precision, so a failure here is
+    // the driver's, and deep zooms just stay in single precision
+    try {
+      doubleId = m_programCache.getProgramFromSource(vertSrc, fragSrc);
+    }
+    catch (const ShaderException&) {}
+  }
+
+  // As above, a failure here leaves deep zooms in double precision. The
+  // single precision variant is less accurate, so is only a fallback.
+  GLuint perturbationId = 0;
+  bool perturbationDouble = false;
+
+  if (GLEW_ARB_gpu_shader_fp64) {
+    string vertSrc = shaderSource(m_mandelbrotVertShaderName);
+    string fragSrc = insertAfterVersion(
+      shaderSource(m_perturbationFragShaderName, computeColourImpl),
+      FP64_PREAMBLE);
+
+    try {
+      perturbationId = m_programCache.getProgramFromSource(vertSrc, fragSrc);
+      perturbationDouble = true;
+    }
+    catch (const ShaderException&) {}
+  }
+
+  if (perturbationId == 0) {
+    try {
+      perturbationId = m_programCache.getProgram(m_mandelbrotVertShaderName,
+                                                 m_perturbationFragShaderName,
+                                                 computeColourImpl);
+    }
+    catch (const ShaderException&) {}
+  }
+
+  // Released only after the new ones are got, so applying the same scheme
+  // again doesn't delete and recompile its programs
+  m_programCache.releaseProgram(m_floatProgram.id);
+  m_programCache.releaseProgram(m_doubleProgram.id);
+  m_programCache.releaseProgram(m_perturbationProgram.id);
+
+  m_floatProgram.id = floatId;
+  m_doubleProgram.id = doubleId;
+  m_perturbationProgram.id = perturbationId;
+  m_perturbationProgram.doublePrecision = perturbationDouble;
   m_activeComputeColourImpl = computeColourImpl;
 }
 
@@ -272,50 +1177,64 @@ void Mandelbrot::setColourScheme(const string& presetName) {
 }
 
 void Mandelbrot::updateUniforms() {
-  GL_CHECK(glUseProgram(m_program.id));
+  GL_CHECK(glUseProgram(m_program->id));
 
   auto& rp = m_renderParams;
 
-  GL_CHECK(glUniform1f(m_program.u.w, rp.w));
-  GL_CHECK(glUniform1f(m_program.u.h, rp.h));
-  GL_CHECK(glUniform1i(m_program.u.maxIterations, rp.maxIterations));
-  GL_CHECK(glUniform1f(m_program.u.xmin, rp.xmin));
-  GL_CHECK(glUniform1f(m_program.u.xmax, rp.xmax));
-  GL_CHECK(glUniform1f(m_program.u.ymin, rp.ymin));
-  GL_CHECK(glUniform1f(m_program.u.ymax, rp.ymax));
+  GL_CHECK(glUniform1f(m_program->u.w, rp.w));
+  GL_CHECK(glUniform1f(m_program->u.h, rp.h));
+  GL_CHECK(glUniform1i(m_program->u.maxIterations, rp.maxIterations));
+
+  if (m_program->doublePrecision) {
+    GL_CHECK(glUniform1d(m_program->u.xmin, rp.xmin));
+    GL_CHECK(glUniform1d(m_program->u.xmax, rp.xmax));
+    GL_CHECK(glUniform1d(m_program->u.ymin, rp.ymin));
+    GL_CHECK(glUniform1d(m_program->u.ymax, rp.ymax));
+  }
+  else {
+    GL_CHECK(glUniform1f(m_program->u.xmin, rp.xmin));
+    GL_CHECK(glUniform1f(m_program->u.xmax, rp.xmax));
+    GL_CHECK(glUniform1f(m_program->u.ymin, rp.ymin));
+    GL_CHECK(glUniform1f(m_program->u.ymax, rp.ymax));
+  }
+
+  GL_CHECK(glUniform1i(m_program->u.aaMaxSamples, rp.aaMaxSamples));
+  GL_CHECK(glUniform1f(m_program->u.aaThreshold, AA_THRESHOLD));
+  GL_CHECK(glUniform1i(m_program->u.usePalette, !m_palette.empty()));
+  GL_CHECK(glUniform1i(m_program->u.smoothPalette, m_palette.smooth()));
+  GL_CHECK(glUniform1i(m_program->u.resume, m_resumeFromOrbitState));
 }
 
 void Mandelbrot::setMaxIterations(int maxI) {
   m_renderParams.maxIterations = maxI;
 }
 
-void Mandelbrot::graphSpaceZoom(double x, double y, double mag) {
-  auto& rp = m_renderParams;
-
-  double xRange = rp.xmax - rp.xmin;
-  double yRange = rp.ymax - rp.ymin;
+void Mandelbrot::setAutoMaxIterations(bool enabled) {
+  m_autoMaxIterations = enabled;
+}
 
-  double xRangeNew = xRange / mag;
-  double yRangeNew = yRange / mag;
+void Mandelbrot::setResolutionScale(double scale) {
+  m_resolutionScale = std::max(0.0, std::min(1.0, scale));
+}
 
-  rp.xmin = x - 0.5 * xRangeNew;
-  rp.xmax = x + 0.5 * xRangeNew;
-  rp.ymin = y - 0.5 * yRangeNew;
-  rp.ymax = y + 0.5 * yRangeNew;
+void Mandelbrot::setView(const View& view) {
+  m_view = view;
+  updateBounds();
 }
 
+// Offsets are in view heights rather than graph units, so they stay
+// representable however deep the view is
 void Mandelbrot::screenSpaceZoom(double x, double y, double mag) {
   auto& rp = m_renderParams;
 
   y = rp.h - 1 - y;
 
-  double xRange = rp.xmax - rp.xmin;
-  double yRange = rp.ymax - rp.ymin;
-
-  double centreX = rp.xmin + xRange * x / rp.w;
-  double centreY = rp.ymin + yRange * y / rp.h;
+  double dx = (x - 0.5 * rp.w) / rp.h;
+  double dy = (y - 0.5 * rp.h) / rp.h;
 
-  graphSpaceZoom(centreX, centreY, mag);
+  m_view.translate(dx, dy);
+  m_view.zoom(mag);
+  updateBounds();
 }
 
 void Mandelbrot::screenSpaceZoom(double x0, double y0, double x1, double y1) {
@@ -326,24 +1245,70 @@ void Mandelbrot::screenSpaceZoom(double x0, double y0, double x1, double y1) {
   y1 = rp.h - 1 - y1;
   std::swap(y0, y1);
 
-  double xRange = rp.xmax - rp.xmin;
-  double yRange = rp.ymax - rp.ymin;
+  double dx = (0.5 * (x0 + x1) - 0.5 * rp.w) / rp.h;
+  double dy = (0.5 * (y0 + y1) - 0.5 * rp.h) / rp.h;
 
-  double xmin = rp.xmin + (x0 / rp.w) * xRange;
-  double xmax = rp.xmin + (x1 / rp.w) * xRange;
-  double ymin = rp.ymin + (y0 / rp.h) * yRange;
-  double ymax = rp.ymin + (y1 / rp.h) * yRange;
+  // All of the rectangle stays in view
+  double scale = std::max((x1 - x0) / rp.w, (y1 - y0) / rp.h);
+  if (scale <= 0.0) {
+    return;
+  }
 
-  rp.xmin = xmin;
-  rp.xmax = xmax;
-  rp.ymin = ymin;
-  rp.ymax = ymax;
+  m_view.translate(dx, dy);
+  m_view.zoom(1.0 / scale);
+  updateBounds();
 }
 
+// True if the last frame still shows enough of the view to be drawn in its
+// place
+bool Mandelbrot::canHoldTexture() const {
+  if (m_texture == 0) {
+    return false;
+  }
+
+  double aspect = static_cast<double>(m_renderParams.w) / m_renderParams.h;
+  double scale = std::exp2(m_view.log2Height() -
+                           m_textureView.log2Height());
+  if (scale > MAX_HELD_TEXTURE_ZOOM || scale < 1.0 / MAX_HELD_TEXTURE_ZOOM) {
+    return false;
+  }
+
+  // The view's centre from the texture's, in the texture's heights
+  double dx = 0.0;
+  double dy = 0.0;
+  m_textureView.offsetOf(m_view.x(), m_view.y(), dx, dy);
+
+  return std::abs(dx) < 0.5 * (m_textureAspect + scale * aspect) &&
+         std::abs(dy) < 0.5 * (1.0 + scale);
+}
+
+// The texture is mapped onto the view it was rendered at, so a held frame
+// moves and scales with the view, and any other is drawn as it is
 void Mandelbrot::drawFromTexture() {
+  m_profiler.beginStage(FrameProfiler::DRAW_TEXTURE);
+
   GL_CHECK(glUseProgram(m_texProgram));
+  GL_CHECK(glViewport(0, 0, m_renderParams.w, m_renderParams.h));
 
+  double aspect = static_cast<double>(m_renderParams.w) / m_renderParams.h;
+  double scale = std::exp2(m_view.log2Height() -
+                           m_textureView.log2Height());
+  double dx = 0.0;
+  double dy = 0.0;
+  m_textureView.offsetOf(m_view.x(), m_view.y(), dx, dy);
+
+  GL_CHECK(glUniform2f(m_texOffsetLocation,
+                       0.5 + (dx - 0.5 * scale * aspect) / m_textureAspect,
+                       0.5 + dy - 0.5 * scale));
+  GL_CHECK(glUniform2f(m_texScaleLocation, scale * aspect / m_textureAspect,
+                       scale));
+
+  // What a held frame doesn't cover is left black
   GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_texture));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                           GL_CLAMP_TO_BORDER));
+  GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                           GL_CLAMP_TO_BORDER));
 
   GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
 
@@ -359,24 +1324,90 @@ void Mandelbrot::drawFromTexture() {
 
   GL_CHECK(glDisableVertexAttribArray(0));
   GL_CHECK(glDisableVertexAttribArray(1));
+
+  m_profiler.endStage(FrameProfiler::DRAW_TEXTURE);
 }
 
 void Mandelbrot::draw(bool fromTexture) {
   INIT_GUARD
 
   if (!fromTexture) {
-    GL_CHECK(glDeleteTextures(1, &m_texture));
-    m_texture = renderToTexture(m_renderParams.w, m_renderParams.h);
+    // The last frame's statistics, if they're back, set this one's limit
+    if (m_autoMaxIterations) {
+      collectIterationStats();
+    }
+
+    auto& rp = m_renderParams;
+    int w = rp.w;
+    int h = rp.h;
+
+    rp.w = std::max(1, static_cast<int>(w * m_resolutionScale + 0.5));
+    rp.h = std::max(1, static_cast<int>(h * m_resolutionScale + 0.5));
+
+    // Only interactive frames are perturbed. Deep exports go through the CPU
+    // perturbation engine.
+    bool perturbing = preparePerturbation();
+
+    // Drawn again without a reference, a deep view would come out in blocks,
+    // so the last frame is scaled up to the view instead, as a frame at a
+    // reduced resolution is
+    if (m_awaitingReference && canHoldTexture()) {
+      GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_texture));
+      GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                               GL_LINEAR));
+    }
+    else {
+      m_perturbing = perturbing;
+
+      GL_CHECK(glDeleteTextures(1, &m_texture));
+      m_texture = renderWithOrbitState();
+      m_textureView = m_view;
+      m_textureAspect = static_cast<double>(w) / h;
+
+      if (m_autoMaxIterations) {
+        requestIterationStats();
+      }
+
+      if (rp.w != w || rp.h != h) {
+        GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_texture));
+        GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                                 GL_LINEAR));
+      }
+    }
+
+    rp.w = w;
+    rp.h = h;
   }
 
   drawFromTexture();
 }
 
 void Mandelbrot::render() {
-  GL_CHECK(glUseProgram(m_program.id));
+  if (m_perturbing) {
+    renderPerturbed();
+    return;
+  }
+
+  m_profiler.beginStage(FrameProfiler::UNIFORMS);
+
+  selectProgram();
+  GL_CHECK(glUseProgram(m_program->id));
   GL_CHECK(glViewport(0, 0, m_renderParams.w, m_renderParams.h));
   updateUniforms();
 
+  GL_CHECK(glActiveTexture(GL_TEXTURE0 + PALETTE_TEXTURE_UNIT));
+  GL_CHECK(glBindTexture(GL_TEXTURE_2D, m_paletteTexture));
+  GL_CHECK(glActiveTexture(GL_TEXTURE0));
+
+  m_profiler.endStage(FrameProfiler::UNIFORMS);
+  m_profiler.beginStage(FrameProfiler::RENDER);
+
+  drawQuad();
+
+  m_profiler.endStage(FrameProfiler::RENDER);
+}
+
+void Mandelbrot::drawQuad() {
   GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
 
   GL_CHECK(glEnableVertexAttribArray(0));
@@ -389,9 +1420,8 @@ void Mandelbrot::render() {
   GL_CHECK(glDisableVertexAttribArray(0));
 }
 
-double Mandelbrot::computeMagnification() const {
-  return (INITIAL_YMAX - INITIAL_YMIN) /
-         (m_renderParams.ymax - m_renderParams.ymin);
+const View& Mandelbrot::getView() const {
+  return m_view;
 }
 
 double Mandelbrot::getXMin() const {
@@ -413,3 +1443,23 @@ double Mandelbrot::getYMax() const {
 int Mandelbrot::getMaxIterations() const {
   return m_renderParams.maxIterations;
 }
+
+bool Mandelbrot::getAutoMaxIterations() const {
+  return m_autoMaxIterations;
+}
+
+const IterationStats& Mandelbrot::getIterationStats() const {
+  return m_iterationStats;
+}
+
+const string& Mandelbrot::getColourSchemeImpl() const {
+  return m_activeComputeColourImpl;
+}
+
+FrameProfiler& Mandelbrot::profiler() {
+  return m_profiler;
+}
+
+const FrameProfiler& Mandelbrot::profiler() const {
+  return m_profiler;
+}
@@ -2,7 +2,20 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <functional>
+#include <future>
+#include <memory>
 #include "gl.hpp"
+#include "iteration_data.hpp"
+#include "frame_profiler.hpp"
+#include "program_cache.hpp"
+#include "palette.hpp"
+#include "iteration_stats.hpp"
+#include "reference_cache.hpp"
+#include "reference_orbit.hpp"
+#include "thread_pool.hpp"
+#include "view.hpp"
 
 extern const std::map<std::string, std::string> PRESETS;
 
@@ -11,18 +24,25 @@ class OfflineRenderStatus {
 
 public:
   OfflineRenderStatus() {}
-  OfflineRenderStatus(int w, int h, int stripH);
+  OfflineRenderStatus(int w, int h, int stripH, int maxSamples);
+
+  // Average samples per pixel over the strips drawn so far
+  double samplesPerPixel() const;
 
   int w = 0;
   int h = 0;
   int progress = 0;
   uint8_t* data = nullptr;
+  // Set if escape results are collected alongside the image
+  IterationData* iterations = nullptr;
 
 private:
   int stripsDrawn = 0;
   int stripH = 0;
   int totalStrips = 0;
   int finalStripH = 0;
+  int maxSamples = 1;
+  long long samples = 0;
 };
 
 class Mandelbrot {
@@ -34,31 +54,72 @@ public:
   void resize(int w, int y);
   void draw(bool fromTexture);
 
+  // Zooms by mag, centred on the pixel at (x, y) from the top left
   void screenSpaceZoom(double x, double y, double mag);
+  // Zooms to show the rectangle between two pixels, keeping the aspect ratio
   void screenSpaceZoom(double x0, double y0, double x1, double y1);
-  void graphSpaceZoom(double x, double y, double mag);
+  void setView(const View& view);
   void reset();
 
   void setMaxIterations(int maxI);
+  // If enabled, the iteration limit is adjusted after each interactive
+  // frame to the smallest that resolves the image
+  void setAutoMaxIterations(bool enabled);
+  // Interactive frames are rendered at this fraction of the canvas size and
+  // upsampled when drawn
+  void setResolutionScale(double scale);
   void setColourScheme(const std::string& presetName);
   void setColourSchemeImpl(const std::string& computeColourImpl);
 
+  const View& getView() const;
+  // Bounds of the view in double precision, for the shaders and CPU engines
   double getXMin() const;
   double getXMax() const;
   double getYMin() const;
   double getYMax() const;
   int getMaxIterations() const;
+  bool getAutoMaxIterations() const;
+  // Statistics of the last interactive frame, collected in auto mode
+  const IterationStats& getIterationStats() const;
+  const std::string& getColourSchemeImpl() const;
+  // Empty if the active colour scheme couldn't be baked into a palette
+  const Palette& getPalette() const;
 
-  double computeMagnification() const;
+  // True if the current view is beyond single precision and is rendered
+  // with the double precision shader
+  bool usingDoublePrecision() const;
+  // True if the last interactive frame was too deep for double precision
+  // and was rendered by perturbation
+  bool usingPerturbation() const;
+  // True while a reference orbit for perturbation is being computed. The
+  // view should be drawn again once it's done.
+  bool referencePending() const;
+  // In auto mode, each frame's statistics are read back from the GPU without
+  // waiting for them, and applied at the start of the next frame or by
+  // calling this once they've arrived. Returns true if they had, in which
+  // case the iteration limit may have changed.
+  bool collectIterationStats();
+  // True while a frame's statistics are on their way back from the GPU
+  bool iterationStatsPending() const;
 
-  void renderToMainMemoryBuffer(int w, int h);
+  // If maxSamples is greater than 1, pixels in high variance regions get up
+  // to that many samples. If iterations is given, each pixel's escape result
+  // is written to it too, and there's one sample per pixel.
+  void renderToMainMemoryBuffer(int w, int h, int maxSamples = 1,
+                                IterationData* iterations = nullptr);
   const OfflineRenderStatus& continueOfflineRender();
 
+  void colourIterationData(const IterationData& data, uint8_t* buffer);
+
+  FrameProfiler& profiler();
+  const FrameProfiler& profiler() const;
+
 private:
   bool m_initialised = false;
 
-  struct {
+  struct MandelbrotProgram {
     GLuint id = 0;
+    bool doublePrecision = false;
 
     // Uniforms
     struct {
@@ -69,15 +130,136 @@ private:
       GLuint xmax;
       GLuint ymin;
       GLuint ymax;
+      GLuint aaMaxSamples;
+      GLuint aaThreshold;
+      GLuint usePalette;
+      GLuint smoothPalette;
+      GLuint palette;
+      GLuint resume;
+      GLuint state;
+      GLuint stateFp64;
+    } u;
+  };
+
+  MandelbrotProgram m_floatProgram;
+  // Only compiled if the driver supports GL_ARB_gpu_shader_fp64
+  MandelbrotProgram m_doubleProgram;
+  // Whichever of the above suits the current zoom
+  MandelbrotProgram* m_program = &m_floatProgram;
+
+  // Samples computeColour into a palette texture
+  struct {
+    GLuint id = 0;
+
+    // Uniforms
+    struct {
+      GLuint entries;
+      GLuint iterationOffset;
+      GLuint lastZ;
+    } u;
+  } m_paletteProgram;
+
+  // Iterates pixels as offsets from a reference orbit held in a texture. In
+  // double precision if the driver supports GL_ARB_gpu_shader_fp64.
+  struct {
+    GLuint id = 0;
+    bool doublePrecision = false;
+
+    // Uniforms
+    struct {
+      GLuint maxIterations;
+      GLuint orbit;
+      GLuint orbitLength;
+      GLuint reference;
+      GLuint pixelSize;
+      GLuint usePalette;
+      GLuint smoothPalette;
+      GLuint palette;
+    } u;
+  } m_perturbationProgram;
+
+  // Colours precomputed iteration data with the active colour scheme.
+  // Compiled on first use.
+  struct {
+    GLuint id = 0;
+    std::string computeColourImpl;
+
+    // Uniforms
+    struct {
+      GLuint maxIterations;
     } u;
-  } m_program;
+  } m_colourProgram;
+
+  // Per-pixel orbit state from the last interactive render, so raising the
+  // iteration limit only continues the pixels that hadn't escaped
+  struct {
+    GLuint texture = 0;
+    // Only for double precision renders
+    GLuint fp64Texture = 0;
+    int w = 0;
+    int h = 0;
+    int maxIterations = 0;
+    double xmin = 0.0;
+    double xmax = 0.0;
+    double ymin = 0.0;
+    double ymax = 0.0;
+    // False if perturbed
+    bool resumable = false;
+    // Only resumed by the program that rendered it
+    bool doublePrecision = false;
+  } m_orbitState;
+  bool m_resumeFromOrbitState = false;
+
+  // A coarse grid of a frame's orbit state being copied into a pixel pack
+  // buffer for IterationStats, with a fence the GPU passes once it's there
+  struct {
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    int w = 0;
+    int h = 0;
+    int maxIterations = 0;
+  } m_statsReadback;
+
+  // Reference orbits for views too deep for double precision. They're
+  // computed on m_orbitThread, while frames are drawn with the last one that
+  // suits, or in double precision until there is one.
+  ReferenceCache m_references;
+  std::future<std::shared_ptr<const ReferenceOrbit>> m_pendingOrbit;
+  // The orbit in m_orbitTexture
+  std::shared_ptr<const ReferenceOrbit> m_uploadedOrbit;
+  GLuint m_orbitTexture = 0;
+  // Set for a frame rendered by perturbation, with the reference's position
+  // in pixels from the bottom left corner
+  bool m_perturbing = false;
+  // Set when a frame wants perturbation but no reference suits yet and one
+  // is being computed
+  bool m_awaitingReference = false;
+  double m_referenceX = 0.0;
+  double m_referenceY = 0.0;
+
+  bool m_autoMaxIterations = false;
+  IterationStats m_iterationStats;
 
   GLuint m_texProgram = 0;
+  GLint m_texOffsetLocation = -1;
+  GLint m_texScaleLocation = -1;
+  GLuint m_paletteTexture = 0;
+  Palette m_palette;
   GLuint m_texture = 0;
+  // What m_texture shows, and the canvas's width over height at the time
+  View m_textureView;
+  double m_textureAspect = 1.0;
+  double m_resolutionScale = 1.0;
   GLuint m_vao = 0;
   GLuint m_vbo = 0;
 
   OfflineRenderStatus m_offlineRenderStatus;
+  FrameProfiler m_profiler;
+  ProgramCache m_programCache;
+
+  // The bounds in m_renderParams are derived from this whenever it or the
+  // canvas size changes
+  View m_view;
 
   struct {
     int w;
@@ -87,20 +269,51 @@ private:
     double xmax;
     double ymin;
     double ymax;
+    int aaMaxSamples;
   } m_renderParams, m_renderParamsBackup;
 
-  std::string m_mandelbrotVertShaderPath;
-  std::string m_mandelbrotFragShaderPath;
-  std::string m_texVertShaderPath;
-  std::string m_texFragShaderPath;
+  std::string m_mandelbrotVertShaderName;
+  std::string m_mandelbrotFragShaderName;
+  std::string m_texVertShaderName;
+  std::string m_texFragShaderName;
+  std::string m_colourFragShaderName;
+  std::string m_paletteFragShaderName;
+  std::string m_perturbationFragShaderName;
 
   std::string m_activeComputeColourImpl;
 
+  void updateBounds();
   void initUniforms();
+  void initUniforms(MandelbrotProgram& program);
+  void initPerturbationUniforms();
+  void selectProgram();
+  bool preparePerturbation();
+  void requestReferenceOrbit();
+  bool uploadReferenceOrbit(const std::shared_ptr<const ReferenceOrbit>& orbit);
+  void renderPerturbed();
   void updateUniforms();
   void render();
+  bool canHoldTexture() const;
   void drawFromTexture();
   void compileProgram_(const std::string& computeColourImpl);
+  void compileColourProgram();
+  void bakePalette(const std::string& computeColourImpl);
+  std::vector<float> renderPaletteSamples(int entries, int iterationOffset,
+                                          float zx, float zy,
+                                          bool keepTexture);
   GLuint renderToTexture(int w, int h);
+  GLuint renderWithOrbitState();
+  bool canResumeFromOrbitState() const;
+  void discardOrbitState();
+  void requestIterationStats();
+  GLuint renderToTexture(int w, int h, const std::function<void()>& fnDraw,
+                         GLint internalFormat = GL_RGB);
+  void drawQuad();
   void renderStripToMainMemoryBuffer(uint8_t* buffer);
+  void renderAntiAliasedStrip(uint8_t* buffer, int w, int h);
+  void renderIterationStrip(uint8_t* buffer, PixelResult* pixels, int w,
+                            int h);
+
+  // Declared last, so an orbit being computed finishes before the rest goes
+  ThreadPool m_orbitThread;
 };
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include "nucleus.hpp"
+#include "reference_orbit.hpp"
+
+// Same bailout as the engines
+static const double RADIUS = 10000.0;
+
+// Newton's method roughly doubles the correct bits each step once it's
+// close, but can wander for a while from a poor starting point
+static const int MAX_NEWTON_STEPS = 64;
+
+// Converged once a step is this many bits above the least significant bit
+// of the precision, as rounding keeps later steps from getting smaller
+static const unsigned long NEWTON_NOISE_BITS = 16;
+
+// A minibrot of size 1, i.e. the whole set, fits a view of height 4
+static const double LOG2_MINIBROT_VIEW_SCALE = 2.0;
+
+// Each disc searched for a period is half the size of the last
+static const int MAX_SEARCH_DISCS = 8;
+
+// log2 of the magnitude of x + iy, which may be beyond a double's range
+static double log2Magnitude(const BigFloat& x, const BigFloat& y) {
+  if (mpf_sgn(x.get()) == 0 && mpf_sgn(y.get()) == 0) {
+    return -HUGE_VAL;
+  }
+
+  long expX = 0;
+  long expY = 0;
+  double dx = x.toDouble(expX);
+  double dy = y.toDouble(expY);
+
+  // Rescale the smaller part to the larger's exponent
+  long exp = std::max(expX, expY);
+  dx = std::ldexp(dx, static_cast<int>(std::max(-2000L, expX - exp)));
+  dy = std::ldexp(dy, static_cast<int>(std::max(-2000L, expY - exp)));
+
+  return 0.5 * std::log2(dx * dx + dy * dy) + exp;
+}
+
+int findPeriod(const BigFloat& x, const BigFloat& y, double radius,
+               int maxPeriod) {
+  unsigned long bits = x.precision();
+
+  BigFloat zx(x);
+  BigFloat zy(y);
+  BigFloat xx(bits);
+  BigFloat yy(bits);
+  BigFloat xy(bits);
+
+  // Bounds how far the orbit of any point in the disc can be from z
+  double r = radius;
+
+  for (int n = 1; n <= maxPeriod; ++n) {
+    double zxd = zx.toDouble();
+    double zyd = zy.toDouble();
+    double az = std::sqrt(zxd * zxd + zyd * zyd);
+
+    if (az < r) {
+      return n;
+    }
+    if (az * az > RADIUS) {
+      return 0;
+    }
+
+    // |(z + e)^2 - z^2| <= 2|z||e| + |e|^2, and c adds up to radius
+    r = r * (2.0 * az + r) + radius;
+
+    mpf_mul(xx.get(), zx.get(), zx.get());
+    mpf_mul(yy.get(), zy.get(), zy.get());
+    mpf_mul(xy.get(), zx.get(), zy.get());
+
+    mpf_sub(zx.get(), xx.get(), yy.get());
+    mpf_add(zx.get(), zx.get(), x.get());
+    mpf_mul_2exp(zy.get(), xy.get(), 1);
+    mpf_add(zy.get(), zy.get(), y.get());
+  }
+
+  return 0;
+}
+
+// Size estimate from the orbit's derivatives, after Robert Munafo's and
+// Claude Heiland-Allen's work on minibrot sizes
+static bool estimateLog2Size(const Nucleus& nucleus, double& log2Size) {
+  typedef std::complex<double> complex_t;
+
+  ReferenceOrbit orbit(nucleus.x, nucleus.y, nucleus.period - 1, RADIUS);
+  if (orbit.escaped()) {
+    return false;
+  }
+
+  // l is held as l * 2^-lExp, as it grows beyond a double's range
+  complex_t l(1.0, 0.0);
+  long lExp = 0;
+  complex_t b(1.0, 0.0);
+
+  // Z_i-1 in the orbit is z_i, counting from z_0 = 0
+  for (int i = 1; i < nucleus.period; ++i) {
+    complex_t z(orbit.re()[i - 1], orbit.im()[i - 1]);
+    l = 2.0 * z * l;
+
+    int exp = 0;
+    std::frexp(std::abs(l), &exp);
+    l = complex_t(std::ldexp(l.real(), -exp), std::ldexp(l.imag(), -exp));
+    lExp += exp;
+
+    complex_t inverse = 1.0 / l;
+    b += complex_t(std::ldexp(inverse.real(), static_cast<int>(-lExp)),
+                   std::ldexp(inverse.imag(), static_cast<int>(-lExp)));
+  }
+
+  // size = 1 / |b l^2|
+  log2Size = -std::log2(std::abs(b)) - 2.0 * (std::log2(std::abs(l)) + lExp);
+
+  return std::isfinite(log2Size);
+}
+
+bool findNucleus(const BigFloat& x, const BigFloat& y, int period,
+                 unsigned long precisionBits, double maxDistance,
+                 Nucleus& nucleus) {
+  BigFloat cx(x);
+  BigFloat cy(y);
+  cx.setPrecision(precisionBits);
+  cy.setPrecision(precisionBits);
+
+  BigFloat zx(precisionBits);
+  BigFloat zy(precisionBits);
+  BigFloat dx(precisionBits);
+  BigFloat dy(precisionBits);
+  BigFloat t0(precisionBits);
+  BigFloat t1(precisionBits);
+  BigFloat t2(precisionBits);
+  BigFloat stepX(precisionBits);
+  BigFloat stepY(precisionBits);
+
+  double tolerance = -static_cast<double>(precisionBits - NEWTON_NOISE_BITS);
+  bool converged = false;
+
+  for (int step = 0; step < MAX_NEWTON_STEPS && !converged; ++step) {
+    // z_period(c) and its derivative dz/dc, from z_0 = 0
+    mpf_set_ui(zx.get(), 0);
+    mpf_set_ui(zy.get(), 0);
+    mpf_set_ui(dx.get(), 0);
+    mpf_set_ui(dy.get(), 0);
+
+    for (int i = 0; i < period; ++i) {
+      // dz -> 2 z dz + 1
+      mpf_mul(t0.get(), zx.get(), dx.get());
+      mpf_mul(t1.get(), zy.get(), dy.get());
+      mpf_sub(t0.get(), t0.get(), t1.get());
+      mpf_mul(t1.get(), zx.get(), dy.get());
+      mpf_mul(t2.get(), zy.get(), dx.get());
+      mpf_add(t1.get(), t1.get(), t2.get());
+      mpf_mul_2exp(dx.get(), t0.get(), 1);
+      mpf_add_ui(dx.get(), dx.get(), 1);
+      mpf_mul_2exp(dy.get(), t1.get(), 1);
+
+      // z -> z^2 + c
+      mpf_mul(t0.get(), zx.get(), zx.get());
+      mpf_mul(t1.get(), zy.get(), zy.get());
+      mpf_mul(t2.get(), zx.get(), zy.get());
+      mpf_sub(zx.get(), t0.get(), t1.get());
+      mpf_add(zx.get(), zx.get(), cx.get());
+      mpf_mul_2exp(zy.get(), t2.get(), 1);
+      mpf_add(zy.get(), zy.get(), cy.get());
+    }
+
+    // step = z / dz
+    mpf_mul(t0.get(), dx.get(), dx.get());
+    mpf_mul(t1.get(), dy.get(), dy.get());
+    mpf_add(t2.get(), t0.get(), t1.get());
+    if (mpf_sgn(t2.get()) == 0) {
+      return false;
+    }
+
+    mpf_mul(t0.get(), zx.get(), dx.get());
+    mpf_mul(t1.get(), zy.get(), dy.get());
+    mpf_add(stepX.get(), t0.get(), t1.get());
+    mpf_div(stepX.get(), stepX.get(), t2.get());
+
+    mpf_mul(t0.get(), zy.get(), dx.get());
+    mpf_mul(t1.get(), zx.get(), dy.get());
+    mpf_sub(stepY.get(), t0.get(), t1.get());
+    mpf_div(stepY.get(), stepY.get(), t2.get());
+
+    mpf_sub(cx.get(), cx.get(), stepX.get());
+    mpf_sub(cy.get(), cy.get(), stepY.get());
+
+    converged = log2Magnitude(stepX, stepY) < tolerance;
+  }
+
+  if (!converged) {
+    return false;
+  }
+
+  mpf_sub(t0.get(), cx.get(), x.get());
+  mpf_sub(t1.get(), cy.get(), y.get());
+  if (log2Magnitude(t0, t1) > std::log2(maxDistance)) {
+    return false;
+  }
+
+  Nucleus result;
+  result.x = cx;
+  result.y = cy;
+  result.period = period;
+
+  if (!estimateLog2Size(result, result.log2Size)) {
+    return false;
+  }
+
+  nucleus = result;
+  return true;
+}
+
+bool findNearestMinibrot(const View& view, int maxPeriod, Nucleus& nucleus) {
+  double radius = view.height();
+
+  // The ball method can overestimate, and Newton's method can settle on
+  // another nucleus of the same period outside the view, so smaller discs
+  // are tried, which find higher periods nearer the centre
+  for (int i = 0; i < MAX_SEARCH_DISCS; ++i, radius *= 0.5) {
+    int period = findPeriod(view.x(), view.y(), radius, maxPeriod);
+    if (period == 0) {
+      return false;
+    }
+
+    if (findNucleus(view.x(), view.y(), period, view.precisionBits(),
+                    view.height(), nucleus)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool findMinibrotView(const View& view, int maxPeriod, View& result) {
+  Nucleus nucleus;
+  if (!findNearestMinibrot(view, maxPeriod, nucleus)) {
+    return false;
+  }
+
+  double log2Height = std::min(view.log2Height(),
+                               nucleus.log2Size + LOG2_MINIBROT_VIEW_SCALE);
+  View zoomed(nucleus.x, nucleus.y, log2Height);
+
+  // Found to the view's precision, which isn't enough to zoom in on it
+  if (zoomed.precisionBits() > view.precisionBits() &&
+      !findNucleus(nucleus.x, nucleus.y, nucleus.period,
+                   zoomed.precisionBits(), view.height(), nucleus)) {
+    return false;
+  }
+
+  result = View(nucleus.x, nucleus.y, log2Height);
+  return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "big_float.hpp"
+#include "view.hpp"
+
+// The centre of a minibrot or bulb: the point whose orbit returns to exactly
+// zero after period steps
+struct Nucleus {
+  BigFloat x;
+  BigFloat y;
+  int period = 0;
+  // Of the minibrot's approximate radius. Deep minibrots are far smaller
+  // than a double can hold.
+  double log2Size = 0.0;
+};
+
+// Lowest period, up to maxPeriod, of a nucleus that may lie within radius of
+// (x, y), by the ball method: a disc of that radius is iterated along with
+// the point until it contains zero. Returns 0 if none is found, or if the
+// point escapes first. Iterates at the precision of x.
+int findPeriod(const BigFloat& x, const BigFloat& y, double radius,
+               int maxPeriod);
+
+// Finds the nucleus of the given period nearest (x, y) by Newton's method, at
+// precisionBits. Returns false if it doesn't converge, or converges more than
+// maxDistance away.
+bool findNucleus(const BigFloat& x, const BigFloat& y, int period,
+                 unsigned long precisionBits, double maxDistance,
+                 Nucleus& nucleus);
+
+// The most prominent minibrot in the view, i.e. the one with the lowest
+// period, up to maxPeriod, within a view height of the centre. Its nucleus
+// is found to the view's precision. Slow for deep views, so best run on a
+// worker thread.
+bool findNearestMinibrot(const View& view, int maxPeriod, Nucleus& nucleus);
+
+// As findNearestMinibrot, giving a view centred on the minibrot and zoomed to
+// fit it, or kept at the given view's zoom if that's deeper
+bool findMinibrotView(const View& view, int maxPeriod, View& result);
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "palette.hpp"
+
+static uint8_t toByte(float c) {
+  return static_cast<uint8_t>(std::max(0.f, std::min(1.f, c)) * 255.f + 0.5f);
+}
+
+Palette::Palette(std::vector<float> rgb, bool smooth)
+  : m_rgb(std::move(rgb)),
+    m_smooth(smooth) {
+
+  if (m_rgb.size() < 6 || m_rgb.size() % 3 != 0) {
+    throw std::invalid_argument("Palette needs at least one entry plus the "
+                                "interior colour");
+  }
+}
+
+bool Palette::empty() const {
+  return m_rgb.empty();
+}
+
+int Palette::entries() const {
+  return static_cast<int>(m_rgb.size() / 3) - 1;
+}
+
+bool Palette::smooth() const {
+  return m_smooth;
+}
+
+const std::vector<float>& Palette::data() const {
+  return m_rgb;
+}
+
+void Palette::colour(const PixelResult& px, int maxIterations,
+                     uint8_t* rgb) const {
+  int n = entries();
+  const float* c = nullptr;
+  float mixed[3];
+
+  if (px.i >= maxIterations) {
+    c = &m_rgb[n * 3];
+  }
+  else {
+    float f = px.i;
+    if (m_smooth) {
+      f -= std::log2(0.5f * std::log(px.zx * px.zx + px.zy * px.zy));
+    }
+
+    // Entry k sits at k / n of the maximum. Interpolate between entries as
+    // GL_LINEAR does between texel centres.
+    float x = std::max(0.f, std::min(static_cast<float>(n - 1),
+                                     f / maxIterations * n));
+    int k = static_cast<int>(x);
+    int k1 = std::min(k + 1, n - 1);
+    float a = x - k;
+
+    for (int j = 0; j < 3; ++j) {
+      mixed[j] = m_rgb[k * 3 + j] + (m_rgb[k1 * 3 + j] - m_rgb[k * 3 + j]) * a;
+    }
+    c = mixed;
+  }
+
+  rgb[0] = toByte(c[0]);
+  rgb[1] = toByte(c[1]);
+  rgb[2] = toByte(c[2]);
+}
+
+void Palette::colour(const IterationData& data, uint8_t* buffer) const {
+  for (size_t i = 0; i < data.pixels.size(); ++i) {
+    colour(data.pixels[i], data.maxIterations, buffer + i * 3);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "iteration_data.hpp"
+
+// A colour scheme baked into a lookup table indexed by iteration count as a
+// fraction of the maximum, so colouring a pixel is one interpolated fetch.
+// The table holds entries() RGB triples followed by the colour of points
+// that don't escape. Lookups here match the shader's, so the CPU and GPU
+// give the same colours.
+class Palette {
+public:
+  Palette() {}
+  // rgb holds entries + 1 triples in [0, 1]. If smooth is true the index
+  // is the continuous iteration count, which needs the final z.
+  Palette(std::vector<float> rgb, bool smooth);
+
+  bool empty() const;
+  int entries() const;
+  bool smooth() const;
+  const std::vector<float>& data() const;
+
+  void colour(const PixelResult& px, int maxIterations, uint8_t* rgb) const;
+  // Writes w * h RGB triples, bottom row first
+  void colour(const IterationData& data, uint8_t* buffer) const;
+
+private:
+  std::vector<float> m_rgb;
+  bool m_smooth = false;
+};
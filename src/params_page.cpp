@@ -16,10 +16,12 @@ static const double MAX_ZOOM_PER_FRAME = 10.0;
 
 wxDEFINE_EVENT(APPLY_PARAMS_EVENT, ApplyParamsEvent);
 
-ApplyParamsEvent::ApplyParamsEvent(int maxI, double zoomAmount,
-                                   double targetFps, double zoomPerFrame)
+ApplyParamsEvent::ApplyParamsEvent(int maxI, bool autoMaxI,
+                                   double zoomAmount, double targetFps,
+                                   double zoomPerFrame)
   : wxCommandEvent(APPLY_PARAMS_EVENT),
     maxI(maxI),
+    autoMaxI(autoMaxI),
     zoomAmount(zoomAmount),
     targetFps(targetFps),
     zoomPerFrame(zoomPerFrame) {}
@@ -27,6 +29,7 @@ ApplyParamsEvent::ApplyParamsEvent(int maxI, double zoomAmount,
 ApplyParamsEvent::ApplyParamsEvent(const ApplyParamsEvent& cpy)
   : wxCommandEvent(cpy),
     maxI(cpy.maxI),
+    autoMaxI(cpy.autoMaxI),
     zoomAmount(cpy.zoomAmount),
     targetFps(cpy.targetFps),
     zoomPerFrame(cpy.zoomPerFrame) {}
@@ -63,6 +66,14 @@ wxStaticBoxSizer* ParamsPage::constructRenderParamsPanel(wxWindow* parent) {
   string strMaxI = numberToString(DEFAULT_MAX_ITERATIONS, false);
   m_txtMaxIterations = constructTextBox(box, strMaxI);
   m_txtMaxIterations->SetValidator(wxTextValidator(wxFILTER_DIGITS));
+  m_chkAutoMaxIterations = new wxCheckBox(box, wxID_ANY,
+                                          wxGetTranslation("Auto"));
+  m_chkAutoMaxIterations->SetToolTip(wxGetTranslation("Adjust max iterations "
+                                                      "after each frame to "
+                                                      "the smallest that "
+                                                      "resolves the image"));
+  m_chkAutoMaxIterations->Bind(wxEVT_CHECKBOX,
+                               &ParamsPage::onAutoMaxIterationsToggle, this);
   auto lblZoomAmount = constructLabel(box,
                                       wxGetTranslation("Zoom amount"));
   m_txtZoomAmount = constructTextBox(box, numberToString(DEFAULT_ZOOM, false));
@@ -72,6 +83,8 @@ wxStaticBoxSizer* ParamsPage::constructRenderParamsPanel(wxWindow* parent) {
   grid->AddSpacer(10);
   grid->Add(lblMaxI, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
   grid->Add(m_txtMaxIterations, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->AddSpacer(1);
+  grid->Add(m_chkAutoMaxIterations, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
   grid->Add(lblZoomAmount, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
   grid->Add(m_txtZoomAmount, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
 
@@ -126,10 +139,20 @@ void ParamsPage::onApplyParamsClick(wxCommandEvent&) {
                                                 MIN_ZOOM_PER_FRAME,
                                                 MAX_ZOOM_PER_FRAME);
 
-  ApplyParamsEvent event(maxI, zoomAmount, targetFps, zoomPerFrame);
+  bool autoMaxI = m_chkAutoMaxIterations->GetValue();
+
+  ApplyParamsEvent event(maxI, autoMaxI, zoomAmount, targetFps, zoomPerFrame);
   wxPostEvent(this, event);
 }
 
+void ParamsPage::onAutoMaxIterationsToggle(wxCommandEvent&) {
+  m_txtMaxIterations->Enable(!m_chkAutoMaxIterations->GetValue());
+}
+
+void ParamsPage::setMaxIterations(int maxI) {
+  m_txtMaxIterations->ChangeValue(numberToString(maxI, false));
+}
+
 void ParamsPage::disable() {
   m_btnApply->Disable();
 }
@@ -9,14 +9,15 @@ wxDECLARE_EVENT(APPLY_PARAMS_EVENT, ApplyParamsEvent);
 
 class ApplyParamsEvent : public wxCommandEvent {
 public:
-  ApplyParamsEvent(int maxI, double zoomAmount, double targetFps,
-                   double zoomPerFrame);
+  ApplyParamsEvent(int maxI, bool autoMaxI, double zoomAmount,
+                   double targetFps, double zoomPerFrame);
   
   ApplyParamsEvent(const ApplyParamsEvent& cpy);
 
   wxEvent* Clone() const override;
 
   int maxI;
+  bool autoMaxI;
   double zoomAmount;
   double targetFps;
   double zoomPerFrame;
@@ -28,14 +29,18 @@ public:
 
   void disable();
   void enable();
+  // Shows the limit chosen in auto mode
+  void setMaxIterations(int maxI);
 
 private:
   wxStaticBoxSizer* constructRenderParamsPanel(wxWindow* parent);
   wxStaticBoxSizer* constructFlyThroughParamsPanel(wxWindow* parent);
 
   void onApplyParamsClick(wxCommandEvent& e);
+  void onAutoMaxIterationsToggle(wxCommandEvent& e);
 
   wxTextCtrl* m_txtMaxIterations;
+  wxCheckBox* m_chkAutoMaxIterations;
   wxTextCtrl* m_txtZoomAmount;
   wxTextCtrl* m_txtTargetFps;
   wxTextCtrl* m_txtZoomPerFrame;
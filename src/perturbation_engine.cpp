@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include "perturbation_engine.hpp"
+#include "nucleus.hpp"
+
+// Same bailout as the other engines, so iteration counts are comparable
+static const double RADIUS = 10000.0;
+
+// Pauldelbrot's test: a pixel is glitched once |Z + dz| < tolerance * |Z|,
+// as its offset then holds too few significant bits of the full value
+static const double GLITCH_TOLERANCE = 1e-3;
+
+// A frame that still has glitches after this many references is given up
+// on, and its remaining glitched pixels are left as they are
+static const int MAX_REFERENCES = 256;
+
+// Looking for a nucleus costs several times its period in high precision
+// iterations, so periods are only searched up to this fraction of the
+// iteration limit, beyond which the search could take longer than a
+// reference orbit at the centre
+static const int NUCLEUS_PERIOD_DIVISOR = 16;
+
+// References are computed with this many bits more than the view needs, so
+// they can be reused as it's zoomed into by up to 2^this
+static const unsigned long REFERENCE_HEADROOM_BITS = 16;
+
+static const size_t MAX_CACHED_REFERENCES = 16;
+
+// Pixels are handed out to threads in runs of this many
+static const int PIXELS_PER_TASK = 256;
+
+// Perturbation is used once a pixel spans fewer than this many double
+// precision ulps of the largest coordinate in view
+static const double MIN_DOUBLE_ULPS_PER_PIXEL = 16.0;
+
+// Iterates the offset of the pixel at dc from the reference orbit.
+// Returns false if the pixel glitched.
+static bool iteratePixel(const ReferenceOrbit& orbit, double dcx, double dcy,
+                         int maxI, PixelResult& result) {
+  const double* re = orbit.re();
+  const double* im = orbit.im();
+  const double* reLo = orbit.reLo();
+  const double* imLo = orbit.imLo();
+  int length = orbit.length();
+
+  const double tolerance = GLITCH_TOLERANCE * GLITCH_TOLERANCE;
+
+  // z = Z + dz, starting from z_0 = c
+  double dx = dcx;
+  double dy = dcy;
+  double zx = re[0] + dx;
+  double zy = im[0] + dy;
+
+  int i = 0;
+  for (; i < maxI; ++i) {
+    // The reference escaped before this pixel did, so can't take it further
+    if (i >= length) {
+      result = PixelResult{static_cast<float>(i), static_cast<float>(zx),
+                           static_cast<float>(zy)};
+      return false;
+    }
+
+    stepDelta(re[i], im[i], reLo[i], imLo[i], dcx, dcy, dx, dy);
+
+    double Zx = re[i + 1];
+    double Zy = im[i + 1];
+    zx = Zx + dx;
+    zy = Zy + dy;
+
+    double r = zx * zx + zy * zy;
+    if (r > RADIUS) {
+      break;
+    }
+
+    if (r < tolerance * (Zx * Zx + Zy * Zy)) {
+      result = PixelResult{static_cast<float>(i), static_cast<float>(zx),
+                           static_cast<float>(zy)};
+      return false;
+    }
+  }
+
+  result = PixelResult{static_cast<float>(i), static_cast<float>(zx),
+                       static_cast<float>(zy)};
+  return true;
+}
+
+// Groups of glitched pixels that touch, including diagonally, largest first.
+// Each group has usually gone wrong against the same part of the reference
+// orbit, so one new reference fixes most of it.
+static std::vector<std::vector<int>> findClusters(
+  const std::vector<uint8_t>& glitched, int w, int h) {
+
+  std::vector<std::vector<int>> clusters;
+  std::vector<uint8_t> visited(glitched.size(), 0);
+  std::vector<int> stack;
+
+  for (int start = 0; start < w * h; ++start) {
+    if (!glitched[start] || visited[start]) {
+      continue;
+    }
+
+    std::vector<int> cluster;
+    stack.push_back(start);
+    visited[start] = 1;
+
+    while (!stack.empty()) {
+      int idx = stack.back();
+      stack.pop_back();
+      cluster.push_back(idx);
+
+      int col = idx % w;
+      int row = idx / w;
+
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          int c = col + dx;
+          int r = row + dy;
+          if (c < 0 || c >= w || r < 0 || r >= h) {
+            continue;
+          }
+
+          int n = r * w + c;
+          if (glitched[n] && !visited[n]) {
+            visited[n] = 1;
+            stack.push_back(n);
+          }
+        }
+      }
+    }
+
+    clusters.push_back(std::move(cluster));
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const std::vector<int>& a, const std::vector<int>& b) {
+    return a.size() > b.size();
+  });
+
+  return clusters;
+}
+
+// The cluster's pixel nearest its centroid, so the reference is always
+// inside the cluster even if it's not convex
+static int clusterCentre(const std::vector<int>& cluster, int w) {
+  double sumX = 0.0;
+  double sumY = 0.0;
+  for (int idx : cluster) {
+    sumX += idx % w;
+    sumY += idx / w;
+  }
+
+  double cx = sumX / cluster.size();
+  double cy = sumY / cluster.size();
+
+  int best = cluster.front();
+  double bestDist = std::numeric_limits<double>::max();
+
+  for (int idx : cluster) {
+    double dx = idx % w - cx;
+    double dy = idx / w - cy;
+    double dist = dx * dx + dy * dy;
+
+    if (dist < bestDist) {
+      bestDist = dist;
+      best = idx;
+    }
+  }
+
+  return best;
+}
+
+PerturbationEngine::PerturbationEngine(unsigned int numThreads,
+                                       ThreadPool::Priority priority)
+  : m_references(MAX_CACHED_REFERENCES),
+    m_threads(numThreads, priority) {}
+
+void PerturbationEngine::clearCache() {
+  m_references.clear();
+}
+
+bool PerturbationEngine::needed(const View& view, int h) {
+  double pixelSize = view.height() / h;
+  double extent = std::max(std::fabs(view.x().toDouble()),
+                           std::fabs(view.y().toDouble())) + view.height();
+  double ulp = extent * std::numeric_limits<double>::epsilon();
+
+  return pixelSize < ulp * MIN_DOUBLE_ULPS_PER_PIXEL;
+}
+
+ReferenceOrbit PerturbationEngine::computeReference(
+  const PerturbationParams& params, double refX, double refY) const {
+
+  View view = params.view;
+  view.translate((refX - 0.5 * params.w) / params.h,
+                 (refY - 0.5 * params.h) / params.h);
+
+  BigFloat x(view.x());
+  BigFloat y(view.y());
+  x.setPrecision(view.precisionBits() + REFERENCE_HEADROOM_BITS);
+  y.setPrecision(view.precisionBits() + REFERENCE_HEADROOM_BITS);
+
+  return ReferenceOrbit(x, y, params.maxIterations, RADIUS);
+}
+
+ReferenceCache::Entry PerturbationEngine::nucleusReference(
+  const PerturbationParams& params, double& refX, double& refY) const {
+
+  ReferenceCache::Entry entry;
+
+  Nucleus nucleus;
+  int maxPeriod = params.maxIterations / NUCLEUS_PERIOD_DIVISOR;
+  if (!findNearestMinibrot(params.view, maxPeriod, nucleus)) {
+    return entry;
+  }
+
+  double dx = 0.0;
+  double dy = 0.0;
+  params.view.offsetOf(nucleus.x, nucleus.y, dx, dy);
+
+  double x = 0.5 * params.w + dx * params.h;
+  double y = 0.5 * params.h + dy * params.h;
+
+  if (x < 0.0 || x > params.w || y < 0.0 || y > params.h) {
+    return entry;
+  }
+
+  refX = x;
+  refY = y;
+
+  BigFloat nx(nucleus.x);
+  BigFloat ny(nucleus.y);
+  nx.setPrecision(params.view.precisionBits() + REFERENCE_HEADROOM_BITS);
+  ny.setPrecision(params.view.precisionBits() + REFERENCE_HEADROOM_BITS);
+
+  // The orbit is back at zero at Z_period-1, so it's only needed up to
+  // there, and pixels that reach it rebase onto its start
+  entry.orbit = std::make_shared<ReferenceOrbit>(nx, ny, nucleus.period - 1,
+                                                 RADIUS);
+  entry.period = nucleus.period;
+
+  return entry;
+}
+
+void PerturbationEngine::renderPixels(const PerturbationParams& params,
+                                      const ReferenceOrbit& orbit,
+                                      double refX, double refY,
+                                      const std::vector<int>& pixels,
+                                      IterationData& data) {
+  double pixelSize = params.view.height() / params.h;
+  int numPixels = static_cast<int>(pixels.size());
+
+  DeltaKernel kernel = selectDeltaKernel(params.maxSimd);
+  std::atomic<int> next(0);
+
+  auto renderRuns = [&]() {
+    std::vector<double> runDcx(PIXELS_PER_TASK);
+    std::vector<double> runDcy(PIXELS_PER_TASK);
+
+    int first = 0;
+    while ((first = next.fetch_add(PIXELS_PER_TASK)) < numPixels) {
+      int last = std::min(numPixels, first + PIXELS_PER_TASK);
+
+      for (int k = first; k < last; ++k) {
+        int idx = pixels[k];
+        runDcx[k - first] = (idx % params.w + 0.5 - refX) * pixelSize;
+        runDcy[k - first] = (idx / params.w + 0.5 - refY) * pixelSize;
+      }
+
+      if (params.glitchMethod == PerturbationParams::REBASE) {
+        kernel(orbit, runDcx.data(), runDcy.data(), &pixels[first],
+               last - first, params.maxIterations, data.pixels.data());
+        continue;
+      }
+
+      for (int k = first; k < last; ++k) {
+        int idx = pixels[k];
+        double dcx = runDcx[k - first];
+        double dcy = runDcy[k - first];
+
+        bool ok = iteratePixel(orbit, dcx, dcy, params.maxIterations,
+                               data.pixels[idx]);
+        m_glitched[idx] = ok ? 0 : 1;
+      }
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  for (unsigned int i = 0; i < m_threads.numThreads(); ++i) {
+    tasks.push_back(m_threads.run(renderRuns));
+  }
+
+  for (auto& task : tasks) {
+    task.get();
+  }
+}
+
+PerturbationEngine::Stats PerturbationEngine::render(
+  const PerturbationParams& params, IterationData& data) {
+
+  if (data.w != params.w || data.h != params.h) {
+    data = IterationData(params.w, params.h);
+  }
+  data.maxIterations = params.maxIterations;
+
+  int numPixels = params.w * params.h;
+  m_glitched.assign(numPixels, 0);
+
+  Stats stats;
+
+  // The first reference is one from an earlier render, a nucleus in view,
+  // or else the centre
+  double refX = 0.5 * params.w;
+  double refY = 0.5 * params.h;
+
+  std::vector<int> all(numPixels);
+  for (int i = 0; i < numPixels; ++i) {
+    all[i] = i;
+  }
+
+  bool nuclei = params.glitchMethod == PerturbationParams::REBASE &&
+                params.nucleusReference;
+
+  ReferenceCache::Entry first;
+  if (m_references.find(params, nuclei, first, refX, refY)) {
+    stats.reusedReference = true;
+  }
+  else {
+    if (nuclei) {
+      first = nucleusReference(params, refX, refY);
+    }
+    if (!first.orbit) {
+      first.orbit = std::make_shared<ReferenceOrbit>(
+        computeReference(params, refX, refY));
+    }
+
+    m_references.add(first);
+  }
+
+  stats.period = first.period;
+
+  renderPixels(params, *first.orbit, refX, refY, all, data);
+  stats.references = 1;
+
+  while (stats.references < MAX_REFERENCES) {
+    auto clusters = findClusters(m_glitched, params.w, params.h);
+    if (clusters.empty()) {
+      break;
+    }
+
+    // Orbits are inherently serial, so one is computed per thread, for
+    // the largest clusters
+    size_t budget = MAX_REFERENCES - stats.references;
+    size_t numRefs = std::min(std::min(clusters.size(), budget),
+                              static_cast<size_t>(m_threads.numThreads()));
+
+    std::vector<std::pair<double, double>> refs;
+    std::vector<std::future<std::shared_ptr<ReferenceOrbit>>> orbits;
+
+    for (size_t i = 0; i < numRefs; ++i) {
+      int centre = clusterCentre(clusters[i], params.w);
+      double x = centre % params.w + 0.5;
+      double y = centre / params.w + 0.5;
+
+      refs.push_back(std::make_pair(x, y));
+      orbits.push_back(m_threads.run([this, &params, x, y]() {
+        return std::make_shared<ReferenceOrbit>(computeReference(params, x,
+                                                                 y));
+      }));
+    }
+
+    // Glitches elsewhere in the image often have the same cause as those
+    // in the cluster, so every glitched pixel is tried against each new
+    // reference, not just the cluster's
+    for (size_t i = 0; i < numRefs; ++i) {
+      auto orbit = orbits[i].get();
+
+      std::vector<int> glitched;
+      for (int idx = 0; idx < numPixels; ++idx) {
+        if (m_glitched[idx]) {
+          glitched.push_back(idx);
+        }
+      }
+
+      if (glitched.empty()) {
+        continue;
+      }
+
+      renderPixels(params, *orbit, refs[i].first, refs[i].second, glitched,
+                   data);
+      ++stats.references;
+    }
+  }
+
+  stats.glitchedPixels = std::count(m_glitched.begin(), m_glitched.end(), 1);
+
+  return stats;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "delta_kernel.hpp"
+#include "iteration_data.hpp"
+#include "reference_cache.hpp"
+#include "reference_orbit.hpp"
+#include "thread_pool.hpp"
+#include "view.hpp"
+
+struct PerturbationParams {
+  enum GlitchMethod {
+    // Pixels rebase onto the start of the one reference orbit when they
+    // would otherwise lose precision
+    REBASE,
+    // Glitched pixels are detected and rendered again against new
+    // references
+    MULTI_REFERENCE
+  };
+
+  int w = 0;
+  int h = 0;
+  int maxIterations = 0;
+  View view;
+  GlitchMethod glitchMethod = REBASE;
+  // With REBASE, use the nucleus of the most prominent minibrot in view as
+  // the reference if one is found. Its orbit repeats, so only one period of
+  // it is computed.
+  bool nucleusReference = true;
+  // Widest vector instructions REBASE may iterate pixels with, for comparing
+  // them. The widest the CPU has is used, up to this.
+  SimdLevel maxSimd = SIMD_AVX512;
+};
+
+// Renders views too deep for double precision. One reference orbit is
+// computed in arbitrary precision, and each pixel's offset from it is
+// iterated in doubles. A pixel's orbit can stray too far from the reference
+// for that to be accurate. With REBASE, the pixel then restarts its offset
+// from the beginning of the orbit. With MULTI_REFERENCE, it's marked as
+// glitched, glitched pixels that touch are grouped, a new reference is
+// taken from the middle of each of the largest groups, and the glitched
+// pixels are rendered again until none are left. Only the Mandelbrot
+// formula at power 2, with smooth results, is supported.
+//
+// Offsets are doubles, so views must be larger than about 1e-300.
+class PerturbationEngine {
+public:
+  struct Stats {
+    // Including the first. Always 1 with REBASE.
+    int references = 0;
+    // Still glitched when the reference limit was reached. Zero in a clean
+    // frame.
+    size_t glitchedPixels = 0;
+    // Of the first reference, if it's a nucleus, and otherwise 0
+    int period = 0;
+    // True if the first reference was kept from an earlier render
+    bool reusedReference = false;
+  };
+
+  explicit PerturbationEngine(unsigned int numThreads = 0,
+                              ThreadPool::Priority priority =
+                                ThreadPool::NORMAL);
+
+  // True if neighbouring pixels of an image h pixels high can't be told
+  // apart in double precision
+  static bool needed(const View& view, int h);
+
+  // Reuses the first reference of a recent render if it suits
+  Stats render(const PerturbationParams& params, IterationData& data);
+  void clearCache();
+
+private:
+  // The reference is at (refX, refY) in pixels from the bottom left corner
+  void renderPixels(const PerturbationParams& params,
+                    const ReferenceOrbit& orbit, double refX, double refY,
+                    const std::vector<int>& pixels, IterationData& data);
+  ReferenceOrbit computeReference(const PerturbationParams& params,
+                                  double refX, double refY) const;
+  // The orbit is null if there's no nucleus in view
+  ReferenceCache::Entry nucleusReference(const PerturbationParams& params,
+                                         double& refX, double& refY) const;
+
+  ReferenceCache m_references;
+  ThreadPool m_threads;
+  // Per pixel, set by renderPixels
+  std::vector<uint8_t> m_glitched;
+};
@@ -0,0 +1,44 @@
+#include <fstream>
+#include <iterator>
+#include "program_binary.hpp"
+
+using std::string;
+
+// Identifies files written by this version of the layout
+static const uint32_t BINARY_MAGIC = 0x4d425043;
+
+bool writeProgramBinary(const string& filePath, uint32_t format,
+                        const std::vector<char>& binary) {
+  std::ofstream fout(filePath, std::ios::binary);
+  uint32_t magic = BINARY_MAGIC;
+
+  fout.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  fout.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  fout.write(binary.data(), binary.size());
+  fout.close();
+
+  return !fout.fail();
+}
+
+bool readProgramBinary(const string& filePath, uint32_t& format,
+                       std::vector<char>& binary) {
+  std::ifstream fin(filePath, std::ios::binary);
+  if (!fin.good()) {
+    return false;
+  }
+
+  uint32_t magic = 0;
+  fin.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  fin.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+  // The body is read straight from the stream buffer, which leaves the
+  // stream's state alone, so a short file has to be caught here
+  if (!fin.good() || magic != BINARY_MAGIC) {
+    return false;
+  }
+
+  binary.assign(std::istreambuf_iterator<char>(fin),
+                std::istreambuf_iterator<char>());
+
+  return !fin.bad() && !binary.empty();
+}
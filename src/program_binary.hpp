@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A linked program's binary as returned by glGetProgramBinary, saved with
+// its format after a header identifying the version of the file layout.
+//
+// Returns false if filePath can't be written in full
+bool writeProgramBinary(const std::string& filePath, uint32_t format,
+                        const std::vector<char>& binary);
+
+// Returns false if filePath is missing, truncated, from another version of
+// the layout, or holds an empty binary
+bool readProgramBinary(const std::string& filePath, uint32_t& format,
+                       std::vector<char>& binary);
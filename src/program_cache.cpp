@@ -0,0 +1,162 @@
+#include <vector>
+#include <iomanip>
+#include <wx/dir.h>
+#include <wx/filename.h>
+#include "program_cache.hpp"
+#include "program_binary.hpp"
+#include "render_utils.hpp"
+#include "exception.hpp"
+#include "utils.hpp"
+
+using std::string;
+
+static uint64_t fnv1a(const string& text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static string glString(GLenum name) {
+  const GLubyte* str = GL_CHECK(glGetString(name));
+  return str == nullptr ? "" : reinterpret_cast<const char*>(str);
+}
+
+ProgramCache::ProgramCache() {
+  m_dirPath = userDataPath("shader_cache");
+}
+
+void ProgramCache::queryDriver() {
+  m_driverId = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" +
+               glString(GL_VERSION) + "\n";
+
+  if (GLEW_ARB_get_program_binary) {
+    GLint numFormats = 0;
+    GL_CHECK(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats));
+    m_binariesSupported = numFormats > 0;
+  }
+
+  m_driverQueried = true;
+}
+
+string ProgramCache::binaryPath(uint64_t key) const {
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+  return joinPaths(m_dirPath, ss.str());
+}
+
+GLuint ProgramCache::getProgram(const string& vertShaderName,
+                                const string& fragShaderName,
+                                const string& substitution) {
+
+  return getProgramFromSource(shaderSource(vertShaderName),
+                              shaderSource(fragShaderName, substitution));
+}
+
+GLuint ProgramCache::getProgramFromSource(const string& vertShaderSrc,
+                                          const string& fragShaderSrc) {
+  if (!m_driverQueried) {
+    queryDriver();
+  }
+
+  uint64_t key = fnv1a(m_driverId + vertShaderSrc + '\0' + fragShaderSrc);
+
+  auto it = m_programs.find(key);
+  if (it != m_programs.end()) {
+    ++it->second.refCount;
+    GL_CHECK(glUseProgram(it->second.id));
+    return it->second.id;
+  }
+
+  GLuint program = loadBinary(key);
+
+  if (program == 0) {
+    program = compileProgramFromSource(vertShaderSrc, fragShaderSrc,
+                                       m_binariesSupported);
+    saveBinary(key, program);
+  }
+
+  GL_CHECK(glUseProgram(program));
+  m_programs[key] = Entry{program, 1};
+
+  return program;
+}
+
+void ProgramCache::releaseProgram(GLuint program) {
+  if (program == 0) {
+    return;
+  }
+
+  for (auto it = m_programs.begin(); it != m_programs.end(); ++it) {
+    if (it->second.id == program) {
+      if (--it->second.refCount == 0) {
+        GL_CHECK(glDeleteProgram(program));
+        m_programs.erase(it);
+      }
+      return;
+    }
+  }
+}
+
+GLuint ProgramCache::loadBinary(uint64_t key) const {
+  if (!m_binariesSupported) {
+    return 0;
+  }
+
+  uint32_t format = 0;
+  std::vector<char> binary;
+  if (!readProgramBinary(binaryPath(key), format, binary)) {
+    return 0;
+  }
+
+  GLuint program = GL_CHECK(glCreateProgram());
+
+  // Drivers may reject binaries from another build even when the version
+  // strings match. That isn't an error; the program is just recompiled.
+  glProgramBinary(program, format, binary.data(), binary.size());
+  glGetError();
+
+  GLint linked = GL_FALSE;
+  GL_CHECK(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+
+  if (linked != GL_TRUE) {
+    GL_CHECK(glDeleteProgram(program));
+    return 0;
+  }
+
+  return program;
+}
+
+void ProgramCache::saveBinary(uint64_t key, GLuint program) const {
+  if (!m_binariesSupported) {
+    return;
+  }
+
+  GLint length = 0;
+  GL_CHECK(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  GL_CHECK(glGetProgramBinary(program, length, nullptr, &format,
+                              binary.data()));
+
+  if (!wxFileName::DirExists(m_dirPath)) {
+    wxDir::Make(m_dirPath, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL);
+  }
+
+  // Written to a temporary file first so a partly written binary is never
+  // picked up
+  string path = binaryPath(key);
+  string tmpPath = path + ".tmp";
+
+  if (!writeProgramBinary(tmpPath, format, binary)) {
+    return;
+  }
+
+  wxRenameFile(tmpPath, path, true);
+}
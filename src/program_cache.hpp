@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include "gl.hpp"
+
+// Hands out linked programs keyed by a hash of their source text and the GL
+// driver. Programs are counted per caller, and deleted once each caller that
+// got one has released it, so callers must not delete them. Where the driver
+// supports it, program binaries are also saved under the user data directory
+// so later runs skip compilation.
+class ProgramCache {
+public:
+  ProgramCache();
+
+  // Must be called with a GL context current. Throws ShaderException if
+  // the program has to be compiled and fails.
+  // Shaders are named as in shaderSource()
+  GLuint getProgram(const std::string& vertShaderName,
+                    const std::string& fragShaderName,
+                    const std::string& substitution = "");
+
+  GLuint getProgramFromSource(const std::string& vertShaderSrc,
+                              const std::string& fragShaderSrc);
+
+  // Gives back a program from getProgram(). Does nothing if program is 0.
+  void releaseProgram(GLuint program);
+
+private:
+  void queryDriver();
+  std::string binaryPath(uint64_t key) const;
+  GLuint loadBinary(uint64_t key) const;
+  void saveBinary(uint64_t key, GLuint program) const;
+
+  bool m_driverQueried = false;
+  bool m_binariesSupported = false;
+  std::string m_driverId;
+  std::string m_dirPath;
+  struct Entry {
+    GLuint id;
+    int refCount;
+  };
+
+  std::map<uint64_t, Entry> m_programs;
+};
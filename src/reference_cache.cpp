@@ -0,0 +1,85 @@
+#include <cmath>
+#include <limits>
+#include "reference_cache.hpp"
+#include "perturbation_engine.hpp"
+
+// A reference can be this many view heights outside the view. Pixels are
+// then further from it, so their offsets are larger, but still small.
+static const double MAX_DISTANCE_OUTSIDE = 0.5;
+
+ReferenceCache::ReferenceCache(size_t maxEntries)
+  : m_maxEntries(maxEntries) {}
+
+bool ReferenceCache::find(const PerturbationParams& params, bool allowNuclei,
+                          Entry& entry, double& refX, double& refY) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  double aspect = static_cast<double>(params.w) / params.h;
+  double maxX = 0.5 * aspect + MAX_DISTANCE_OUTSIDE;
+  double maxY = 0.5 + MAX_DISTANCE_OUTSIDE;
+  unsigned long bits = params.view.precisionBits();
+
+  auto best = m_entries.end();
+  double bestDist = std::numeric_limits<double>::max();
+  double bestX = 0.0;
+  double bestY = 0.0;
+
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    const ReferenceOrbit& orbit = *it->orbit;
+
+    if (it->period > 0 && !allowNuclei) {
+      continue;
+    }
+    // Rounding in a less precise orbit would show at this depth
+    if (orbit.x().precision() < bits) {
+      continue;
+    }
+    // Pixels could outlive it
+    if (it->period == 0 && !orbit.escaped() &&
+        orbit.length() < params.maxIterations) {
+      continue;
+    }
+
+    double dx = 0.0;
+    double dy = 0.0;
+    params.view.offsetOf(orbit.x(), orbit.y(), dx, dy);
+
+    if (std::fabs(dx) > maxX || std::fabs(dy) > maxY) {
+      continue;
+    }
+
+    double dist = dx * dx + dy * dy;
+    if (dist < bestDist) {
+      best = it;
+      bestDist = dist;
+      bestX = dx;
+      bestY = dy;
+    }
+  }
+
+  if (best == m_entries.end()) {
+    return false;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, best);
+
+  entry = m_entries.front();
+  refX = 0.5 * params.w + bestX * params.h;
+  refY = 0.5 * params.h + bestY * params.h;
+
+  return true;
+}
+
+void ReferenceCache::add(const Entry& entry) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_entries.push_front(entry);
+  while (m_entries.size() > m_maxEntries) {
+    m_entries.pop_back();
+  }
+}
+
+void ReferenceCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include "reference_orbit.hpp"
+
+struct PerturbationParams;
+
+// Reference orbits kept between renders. Panning or zooming a deep view
+// moves the reference only slightly relative to it, so while the reference
+// is still in or near the view its orbit is reused and only the pixels are
+// iterated again.
+class ReferenceCache {
+public:
+  struct Entry {
+    std::shared_ptr<const ReferenceOrbit> orbit;
+    // Non-zero if the orbit is one period of a nucleus's, in which case it
+    // serves any iteration limit
+    int period = 0;
+  };
+
+  explicit ReferenceCache(size_t maxEntries);
+
+  // The entry nearest the view's centre that's within half a view height of
+  // it, precise enough for it, and reaching params.maxIterations. Nuclei are
+  // only returned if allowNuclei is set. Sets refX and refY to its position
+  // in pixels from the bottom left corner.
+  bool find(const PerturbationParams& params, bool allowNuclei, Entry& entry,
+            double& refX, double& refY);
+  // Evicts the least recently used entry if the cache is full
+  void add(const Entry& entry);
+  void clear();
+
+private:
+  size_t m_maxEntries;
+  std::mutex m_mutex;
+  // Most recently used first
+  std::list<Entry> m_entries;
+};
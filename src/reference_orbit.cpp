@@ -0,0 +1,104 @@
+#include "reference_orbit.hpp"
+
+// Splits z into hi, z as a double, and lo, what that leaves out as a double.
+// rest is scratch, at z's precision.
+static void split(const BigFloat& z, BigFloat& rest, double& hi, double& lo) {
+  hi = z.toDouble();
+  mpf_set_d(rest.get(), hi);
+  mpf_sub(rest.get(), z.get(), rest.get());
+  lo = rest.toDouble();
+}
+
+ReferenceOrbit::ReferenceOrbit(const BigFloat& x, const BigFloat& y,
+                               int maxIterations, double radius)
+  : m_x(x),
+    m_y(y) {
+
+  unsigned long bits = x.precision();
+
+  BigFloat zx(x);
+  BigFloat zy(y);
+  BigFloat xx(bits);
+  BigFloat yy(bits);
+  BigFloat xy(bits);
+  BigFloat rest(bits);
+
+  double re;
+  double im;
+  double reLo;
+  double imLo;
+
+  // Z_-1 = 0, for pixels rebased onto the start of the orbit
+  m_re.reserve(maxIterations + 2);
+  m_im.reserve(maxIterations + 2);
+  m_reLo.reserve(maxIterations + 2);
+  m_imLo.reserve(maxIterations + 2);
+  m_re.push_back(0.0);
+  m_im.push_back(0.0);
+  m_reLo.push_back(0.0);
+  m_imLo.push_back(0.0);
+
+  split(zx, rest, re, reLo);
+  split(zy, rest, im, imLo);
+  m_re.push_back(re);
+  m_im.push_back(im);
+  m_reLo.push_back(reLo);
+  m_imLo.push_back(imLo);
+
+  for (int i = 0; i < maxIterations; ++i) {
+    mpf_mul(xx.get(), zx.get(), zx.get());
+    mpf_mul(yy.get(), zy.get(), zy.get());
+    mpf_mul(xy.get(), zx.get(), zy.get());
+
+    mpf_sub(zx.get(), xx.get(), yy.get());
+    mpf_add(zx.get(), zx.get(), x.get());
+    mpf_mul_2exp(zy.get(), xy.get(), 1);
+    mpf_add(zy.get(), zy.get(), y.get());
+
+    split(zx, rest, re, reLo);
+    split(zy, rest, im, imLo);
+
+    m_re.push_back(re);
+    m_im.push_back(im);
+    m_reLo.push_back(reLo);
+    m_imLo.push_back(imLo);
+    m_length = i + 1;
+
+    if (re * re + im * im > radius) {
+      m_escaped = true;
+      break;
+    }
+  }
+}
+
+const BigFloat& ReferenceOrbit::x() const {
+  return m_x;
+}
+
+const BigFloat& ReferenceOrbit::y() const {
+  return m_y;
+}
+
+int ReferenceOrbit::length() const {
+  return m_length;
+}
+
+bool ReferenceOrbit::escaped() const {
+  return m_escaped;
+}
+
+const double* ReferenceOrbit::re() const {
+  return m_re.data() + 1;
+}
+
+const double* ReferenceOrbit::im() const {
+  return m_im.data() + 1;
+}
+
+const double* ReferenceOrbit::reLo() const {
+  return m_reLo.data() + 1;
+}
+
+const double* ReferenceOrbit::imLo() const {
+  return m_imLo.data() + 1;
+}
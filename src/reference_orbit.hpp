@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include "big_float.hpp"
+
+// The orbit of one point, computed in arbitrary precision and kept as pairs
+// of doubles. Perturbation rendering iterates each pixel's small offset from
+// this orbit in double precision instead of iterating the pixel itself.
+class ReferenceOrbit {
+public:
+  // Same recurrence as the other engines: Z_0 = C and Z_n+1 = Z_n^2 + C,
+  // stopping once |Z|^2 passes radius or after maxIterations steps. C is
+  // used at its own precision.
+  ReferenceOrbit(const BigFloat& x, const BigFloat& y, int maxIterations,
+                 double radius);
+
+  const BigFloat& x() const;
+  const BigFloat& y() const;
+
+  // Steps taken. Z_0 to Z_length() are stored, so a pixel can be iterated
+  // against the orbit for this many steps.
+  int length() const;
+  // True if the orbit stopped because it escaped
+  bool escaped() const;
+
+  // Real and imaginary parts, in separate arrays so a pixel loop reads them
+  // sequentially. Index -1 holds 0, which Z_0 follows if the orbit is
+  // started from the origin.
+  const double* re() const;
+  const double* im() const;
+  // What re() and im() leave out, so Z = re + reLo to about twice double
+  // precision. Deep pixels iterated against the rounded orbit alone pick up
+  // its rounding error in every step's 2 Z dz.
+  const double* reLo() const;
+  const double* imLo() const;
+
+private:
+  BigFloat m_x;
+  BigFloat m_y;
+  int m_length = 0;
+  bool m_escaped = false;
+  std::vector<double> m_re;
+  std::vector<double> m_im;
+  std::vector<double> m_reLo;
+  std::vector<double> m_imLo;
+};
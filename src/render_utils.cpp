@@ -1,33 +1,77 @@
 #include <vector>
 #include <fstream>
+#include <cstdlib>
 #include "render_utils.hpp"
 #include "exception.hpp"
+#include "utils.hpp"
+#include "embedded_shaders.hpp"
 
 using std::string;
 using std::vector;
 
-static string doSubstitution(const string& path, const string& searchString,
+static const char* SHADER_DIR_ENV_VAR = "MANDELBROT_SHADER_DIR";
+static const string SUBSTITUTION_MARKER = "COMPUTE_COLOUR_IMPL";
+
+static string readShaderFile(const string& dir, const string& name,
                              const string& substitution) {
+  string path = joinPaths(dir, name);
 
   std::ifstream fin(path);
+  if (!fin.good()) {
+    throw ShaderException(path, "File not found");
+  }
+
   string text{std::istreambuf_iterator<char>(fin),
               std::istreambuf_iterator<char>()};
 
-  if (searchString.length() > 0) {
-    auto idx = text.find(searchString);
-    auto len = searchString.length();
-    text.replace(idx, len, substitution);
+  auto idx = text.find(SUBSTITUTION_MARKER);
+  if (idx != string::npos) {
+    text.replace(idx, SUBSTITUTION_MARKER.length(), substitution);
   }
 
   return text;
 }
 
-GLuint loadShaderWithSubstitution(const string& srcPath, GLuint type,
-                                  const string& searchString,
-                                  const string& substitution) {
-  GLuint shaderId = GL_CHECK(glCreateShader(type));
+string shaderSource(const string& name, const string& substitution) {
+  const char* overrideDir = std::getenv(SHADER_DIR_ENV_VAR);
+  if (overrideDir != nullptr && overrideDir[0] != '\0') {
+    return readShaderFile(overrideDir, name, substitution);
+  }
+
+  auto it = EMBEDDED_SHADERS.find(name);
+  if (it == EMBEDDED_SHADERS.end()) {
+    throw ShaderException(name, "No embedded shader with this name");
+  }
+
+  const EmbeddedShader& shader = it->second;
+  if (!shader.hasMarker) {
+    return shader.prefix;
+  }
+
+  return string(shader.prefix) + substitution + shader.suffix;
+}
+
+string insertAfterVersion(const string& shaderSrc, const string& text) {
+  string src = shaderSrc;
+
+  size_t idx = 0;
+  if (src.compare(0, 8, "#version") == 0) {
+    idx = src.find('\n');
+    if (idx == string::npos) {
+      src += '\n';
+      idx = src.length() - 1;
+    }
+    ++idx;
+  }
+
+  src.insert(idx, text);
 
-  string shaderSrc = doSubstitution(srcPath, searchString, substitution);
+  return src;
+}
+
+static GLuint compileShader(const string& shaderSrc, GLuint type,
+                            const string& name) {
+  GLuint shaderId = GL_CHECK(glCreateShader(type));
 
   GLint result = GL_FALSE;
   int infoLogLen = 0;
@@ -41,29 +85,27 @@ GLuint loadShaderWithSubstitution(const string& srcPath, GLuint type,
   if (infoLogLen > 0) {
     vector<char> errMsg(infoLogLen + 1);
     GL_CHECK(glGetShaderInfoLog(shaderId, infoLogLen, NULL, errMsg.data()));
-    throw ShaderException(srcPath, errMsg.data());
+
+    if (name.empty()) {
+      throw ShaderException(errMsg.data());
+    }
+    throw ShaderException(name, errMsg.data());
   }
 
   return shaderId;
 }
 
-GLuint loadShader(const string& srcPath, GLuint type) {
-  return loadShaderWithSubstitution(srcPath, type, "", "");
-}
-
-GLuint compileProgram(const string& vertShaderPath,
-                      const string& fragShaderPath,
-                      const string& searchString,
-                      const string& substitution) {
-
-  GLuint vertShader = loadShader(vertShaderPath, GL_VERTEX_SHADER);
-  GLuint fragShader =
-    loadShaderWithSubstitution(fragShaderPath, GL_FRAGMENT_SHADER,
-                               searchString, substitution);
-
+static GLuint linkProgram(GLuint vertShader, GLuint fragShader,
+                          bool retrievable) {
   GLuint program = GL_CHECK(glCreateProgram());
   GL_CHECK(glAttachShader(program, vertShader));
   GL_CHECK(glAttachShader(program, fragShader));
+
+  if (retrievable) {
+    GL_CHECK(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                 GL_TRUE));
+  }
+
   GL_CHECK(glLinkProgram(program));
 
   GLint result = GL_FALSE;
@@ -88,3 +130,12 @@ GLuint compileProgram(const string& vertShaderPath,
 
   return program;
 }
+
+GLuint compileProgramFromSource(const string& vertShaderSrc,
+                                const string& fragShaderSrc,
+                                bool retrievable) {
+  GLuint vertShader = compileShader(vertShaderSrc, GL_VERTEX_SHADER, "");
+  GLuint fragShader = compileShader(fragShaderSrc, GL_FRAGMENT_SHADER, "");
+
+  return linkProgram(vertShader, fragShader, retrievable);
+}
@@ -3,11 +3,21 @@
 #include <string>
 #include "gl.hpp"
 
-GLuint loadShader(const std::string& path, GLuint type);
-GLuint loadShaderWithSubstitution(const std::string& path, GLuint type,
-                                  const std::string& searchString,
-                                  const std::string& substitution);
-GLuint compileProgram(const std::string& vertShaderPath,
-                      const std::string& fragShaderPath,
-                      const std::string& searchString = "",
-                      const std::string& substitution = "");
+// Returns the source of one of the shaders in data/, with its
+// COMPUTE_COLOUR_IMPL marker (if any) replaced by substitution. Sources are
+// embedded at build time. If the MANDELBROT_SHADER_DIR environment variable
+// is set, they're read from that directory instead, so shaders can be
+// edited without rebuilding.
+std::string shaderSource(const std::string& name,
+                         const std::string& substitution = "");
+
+// Inserts text after a shader's #version line, e.g. to enable extensions or
+// define macros
+std::string insertAfterVersion(const std::string& shaderSrc,
+                               const std::string& text);
+
+// If retrievable is true, the driver is asked to keep the program binary
+// available to glGetProgramBinary
+GLuint compileProgramFromSource(const std::string& vertShaderSrc,
+                                const std::string& fragShaderSrc,
+                                bool retrievable = false);
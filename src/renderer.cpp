@@ -1,6 +1,5 @@
 #include "renderer.hpp"
 #include "exception.hpp"
-#include "render_utils.hpp"
 #include "utils.hpp"
 
 #define INIT_GUARD \
@@ -16,14 +15,37 @@ static const int FLOATS_PER_RECT = VERTS_PER_RECT * FLOATS_PER_VERT;
 
 static const GLfloat COLOUR[3] = { 0.0f, 1.0f, 0.0f };
 
+static const double HUD_X = 10.0;
+static const double HUD_Y = 10.0;
+static const double HUD_W = 300.0;
+static const double HUD_GRAPH_H = 80.0;
+static const double HUD_BAR_H = 8.0;
+static const double HUD_MARGIN = 4.0;
+
+static const GLfloat HUD_BACKGROUND[3] = { 0.1f, 0.1f, 0.1f };
+static const GLfloat HUD_BUDGET_LINE[3] = { 1.0f, 1.0f, 1.0f };
+static const GLfloat HUD_WITHIN_BUDGET[3] = { 0.2f, 0.8f, 0.2f };
+static const GLfloat HUD_OVER_BUDGET[3] = { 0.9f, 0.2f, 0.2f };
+static const GLfloat HUD_PERCENTILES[3][3] = {
+  { 1.0f, 1.0f, 1.0f },   // p50
+  { 1.0f, 0.8f, 0.0f },   // p95
+  { 1.0f, 0.3f, 0.0f }    // p99
+};
+static const GLfloat HUD_STAGES[FrameProfiler::NUM_STAGES][3] = {
+  { 0.9f, 0.9f, 0.2f },   // Uniforms
+  { 0.2f, 0.6f, 1.0f },   // Render
+  { 0.8f, 0.3f, 0.9f },   // Texture draw
+  { 0.6f, 0.6f, 0.6f }    // Swap
+};
+
 Renderer::Renderer(std::function<void()> fnMakeGlContextCurrent)
   : m_fnMakeGlContextCurrent(fnMakeGlContextCurrent) {
 
   m_w = 100;
   m_h = 100;
 
-  m_vertShaderPath = appDataPath("simple_vert_shader.glsl");
-  m_fragShaderPath = appDataPath("simple_frag_shader.glsl");
+  m_vertShaderName = "simple_vert_shader.glsl";
+  m_fragShaderName = "simple_frag_shader.glsl";
 }
 
 void Renderer::initialise(int w, int h) {
@@ -57,13 +79,14 @@ void Renderer::initialise(int w, int h) {
 
   m_brot.initialise(w, h);
 
-  m_program.id = compileProgram(m_vertShaderPath, m_fragShaderPath);
+  m_program.id = m_programCache.getProgram(m_vertShaderName, m_fragShaderName);
   initUniforms();
 
   GL_CHECK(glGenVertexArrays(1, &m_program.vao));
   GL_CHECK(glBindVertexArray(m_program.vao));
 
   GL_CHECK(glGenBuffers(1, &m_program.vbo));
+  GL_CHECK(glGenBuffers(1, &m_program.hudVbo));
 
   GLfloat vertexBufferData[4 * FLOATS_PER_RECT];
   memset(vertexBufferData, 0, sizeof(vertexBufferData));
@@ -116,6 +139,120 @@ void Renderer::drawSelectionRect(double x, double y, double w, double h) {
   }
 }
 
+void Renderer::addHudRect(double x, double y, double w, double h,
+                          const GLfloat* colour, std::vector<GLfloat>& verts,
+                          std::vector<const GLfloat*>& colours) const {
+  if (w <= 0.0 || h <= 0.0) {
+    return;
+  }
+
+  size_t offset = verts.size();
+  verts.resize(offset + FLOATS_PER_RECT);
+  makeRectangle(x, y, w, h, verts.data() + offset);
+  colours.push_back(colour);
+}
+
+void Renderer::drawProfilerHud(double frameBudget) {
+  INIT_GUARD
+  m_fnMakeGlContextCurrent();
+
+  const FrameProfiler& profiler = m_brot.profiler();
+
+  std::vector<GLfloat> verts;
+  std::vector<const GLfloat*> colours;
+
+  // Times are drawn so that the frame budget is half the available space
+  auto scale = [frameBudget](double t, double size) {
+    return std::min(size, 0.5 * size * t / frameBudget);
+  };
+
+  int numBars = 2 + FrameProfiler::NUM_STAGES;
+  double panelH = HUD_GRAPH_H + numBars * (HUD_BAR_H + HUD_MARGIN) +
+                  2.0 * HUD_MARGIN;
+
+  addHudRect(HUD_X, HUD_Y, HUD_W + 2.0 * HUD_MARGIN, panelH, HUD_BACKGROUND,
+             verts, colours);
+
+  double x0 = HUD_X + HUD_MARGIN;
+  double y0 = HUD_Y + HUD_MARGIN;
+
+  // Graph of recent frame times, newest on the right
+  std::vector<double> frameTimes = profiler.frameTimes();
+  double barW = 2.0;
+  size_t maxBars = static_cast<size_t>(HUD_W / barW);
+  size_t first = frameTimes.size() > maxBars ? frameTimes.size() - maxBars : 0;
+
+  for (size_t i = first; i < frameTimes.size(); ++i) {
+    double t = frameTimes[i];
+    double h = scale(t, HUD_GRAPH_H);
+    double x = x0 + HUD_W - (frameTimes.size() - i) * barW;
+
+    addHudRect(x, y0 + HUD_GRAPH_H - h, barW, h,
+               t <= frameBudget ? HUD_WITHIN_BUDGET : HUD_OVER_BUDGET, verts,
+               colours);
+  }
+
+  addHudRect(x0, y0 + 0.5 * HUD_GRAPH_H, HUD_W, 1.0, HUD_BUDGET_LINE, verts,
+             colours);
+
+  double y = y0 + HUD_GRAPH_H + HUD_MARGIN;
+
+  // Stacked bars of the latest CPU and GPU time per stage
+  for (int gpu = 0; gpu <= 1; ++gpu) {
+    double x = x0;
+
+    for (int i = 0; i < FrameProfiler::NUM_STAGES; ++i) {
+      auto stage = static_cast<FrameProfiler::Stage>(i);
+      double t = gpu ? profiler.latestGpuTime(stage) :
+                       profiler.latestCpuTime(stage);
+      double w = std::min(scale(t, HUD_W), x0 + HUD_W - x);
+
+      addHudRect(x, y, w, HUD_BAR_H, HUD_STAGES[i], verts, colours);
+      x += w;
+    }
+
+    y += HUD_BAR_H + HUD_MARGIN;
+  }
+
+  // Percentile markers for each stage's CPU time and for the whole frame
+  auto addPercentiles = [&](const FrameProfiler::Percentiles& p,
+                            const GLfloat* colour) {
+    addHudRect(x0, y + 0.25 * HUD_BAR_H, scale(p.p99, HUD_W),
+               0.5 * HUD_BAR_H, colour, verts, colours);
+
+    const double values[] = { p.p50, p.p95, p.p99 };
+    for (int i = 0; i < 3; ++i) {
+      addHudRect(x0 + scale(values[i], HUD_W) - 1.0, y, 2.0, HUD_BAR_H,
+                 HUD_PERCENTILES[i], verts, colours);
+    }
+
+    y += HUD_BAR_H + HUD_MARGIN;
+  };
+
+  for (int i = 0; i < FrameProfiler::NUM_STAGES; ++i) {
+    auto stage = static_cast<FrameProfiler::Stage>(i);
+    addPercentiles(profiler.cpuPercentiles(stage), HUD_STAGES[i]);
+  }
+  addPercentiles(profiler.framePercentiles(), HUD_WITHIN_BUDGET);
+
+  GL_CHECK(glUseProgram(m_program.id));
+
+  GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_program.hudVbo));
+  GL_CHECK(glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(),
+                        verts.data(), GL_STREAM_DRAW));
+
+  GL_CHECK(glEnableVertexAttribArray(0));
+  GL_CHECK(glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0));
+
+  for (size_t i = 0; i < colours.size(); ++i) {
+    GL_CHECK(glUniform3f(m_program.u.colour, colours[i][0], colours[i][1],
+                         colours[i][2]));
+    GL_CHECK(glDrawArrays(GL_TRIANGLES, i * VERTS_PER_RECT, VERTS_PER_RECT));
+  }
+
+  GL_CHECK(glDisableVertexAttribArray(0));
+}
+
 void Renderer::drawMandelbrot(bool fromTexture) {
   INIT_GUARD
   m_fnMakeGlContextCurrent();
@@ -128,6 +265,12 @@ void Renderer::finish() {
   GL_CHECK(glFlush());
 }
 
+void Renderer::waitForGpu() {
+  INIT_GUARD
+  m_fnMakeGlContextCurrent();
+  GL_CHECK(glFinish());
+}
+
 void Renderer::resize(int w, int h) {
   INIT_GUARD
   m_fnMakeGlContextCurrent();
@@ -206,11 +349,6 @@ void Renderer::makeSelectionRect(double x, double y, double w, double h) {
                            sizeof(GLfloat) * 4 * FLOATS_PER_RECT, verts));
 }
 
-void Renderer::graphSpaceZoom(double x, double y, double mag) {
-  m_fnMakeGlContextCurrent();
-  m_brot.graphSpaceZoom(x, y, mag);
-}
-
 void Renderer::screenSpaceZoom(double x, double y, double mag) {
   m_fnMakeGlContextCurrent();
   m_brot.screenSpaceZoom(x, y, mag);
@@ -221,6 +359,11 @@ void Renderer::screenSpaceZoom(double x0, double y0, double x1, double y1) {
   m_brot.screenSpaceZoom(x0, y0, x1, y1);
 }
 
+void Renderer::setView(const View& view) {
+  m_fnMakeGlContextCurrent();
+  m_brot.setView(view);
+}
+
 void Renderer::resetZoom() {
   m_fnMakeGlContextCurrent();
   m_brot.reset();
@@ -231,6 +374,14 @@ void Renderer::setMaxIterations(int maxI) {
   m_brot.setMaxIterations(maxI);
 }
 
+void Renderer::setAutoMaxIterations(bool enabled) {
+  m_brot.setAutoMaxIterations(enabled);
+}
+
+void Renderer::setResolutionScale(double scale) {
+  m_brot.setResolutionScale(scale);
+}
+
 void Renderer::setColourScheme(const std::string& presetName) {
   m_fnMakeGlContextCurrent();
   m_brot.setColourScheme(presetName);
@@ -241,6 +392,10 @@ void Renderer::setColourSchemeImpl(const std::string& computeColourImpl) {
   m_brot.setColourSchemeImpl(computeColourImpl);
 }
 
+const View& Renderer::getView() const {
+  return m_brot.getView();
+}
+
 double Renderer::getXMin() const {
   return m_brot.getXMin();
 }
@@ -261,16 +416,60 @@ int Renderer::getMaxIterations() const {
   return m_brot.getMaxIterations();
 }
 
-double Renderer::computeMagnification() const {
-  return m_brot.computeMagnification();
+bool Renderer::getAutoMaxIterations() const {
+  return m_brot.getAutoMaxIterations();
+}
+
+const std::string& Renderer::getColourSchemeImpl() const {
+  return m_brot.getColourSchemeImpl();
+}
+
+const Palette& Renderer::getPalette() const {
+  return m_brot.getPalette();
+}
+
+bool Renderer::usingDoublePrecision() const {
+  return m_brot.usingDoublePrecision();
+}
+
+bool Renderer::usingPerturbation() const {
+  return m_brot.usingPerturbation();
 }
 
-void Renderer::renderToMainMemoryBuffer(int w, int h) {
+bool Renderer::referencePending() const {
+  return m_brot.referencePending();
+}
+
+bool Renderer::collectIterationStats() {
   m_fnMakeGlContextCurrent();
-  m_brot.renderToMainMemoryBuffer(w, h);
+  return m_brot.collectIterationStats();
+}
+
+bool Renderer::iterationStatsPending() const {
+  return m_brot.iterationStatsPending();
+}
+
+void Renderer::renderToMainMemoryBuffer(int w, int h, int maxSamples,
+                                        IterationData* iterations) {
+  m_fnMakeGlContextCurrent();
+  m_brot.renderToMainMemoryBuffer(w, h, maxSamples, iterations);
 }
 
 const OfflineRenderStatus& Renderer::continueOfflineRender() {
   m_fnMakeGlContextCurrent();
   return m_brot.continueOfflineRender();
 }
+
+void Renderer::colourIterationData(const IterationData& data,
+                                   uint8_t* buffer) {
+  m_fnMakeGlContextCurrent();
+  m_brot.colourIterationData(data, buffer);
+}
+
+FrameProfiler& Renderer::profiler() {
+  return m_brot.profiler();
+}
+
+const FrameProfiler& Renderer::profiler() const {
+  return m_brot.profiler();
+}
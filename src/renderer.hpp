@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "mandelbrot.hpp"
 
 class Renderer {
@@ -13,27 +14,47 @@ public:
   void clear(uint8_t r, uint8_t g, uint8_t b);
   void drawMandelbrot(bool fromTexture = false);
   void drawSelectionRect(double x, double y, double w, double h);
+  // Draws frame time graphs from the profiler, scaled so that frameBudget
+  // (in seconds) is half the graph height
+  void drawProfilerHud(double frameBudget);
   void finish();
+  void waitForGpu();
 
-  void graphSpaceZoom(double x, double y, double mag);
   void screenSpaceZoom(double x, double y, double mag);
   void screenSpaceZoom(double x0, double y0, double x1, double y1);
+  void setView(const View& view);
   void resetZoom();
 
   void setMaxIterations(int maxI);
+  void setAutoMaxIterations(bool enabled);
+  void setResolutionScale(double scale);
   void setColourScheme(const std::string& presetName);
   void setColourSchemeImpl(const std::string& computeColourImpl);
 
+  const View& getView() const;
   double getXMin() const;
   double getXMax() const;
   double getYMin() const;
   double getYMax() const;
   int getMaxIterations() const;
+  bool getAutoMaxIterations() const;
+  const std::string& getColourSchemeImpl() const;
+  const Palette& getPalette() const;
+
+  bool usingDoublePrecision() const;
+  bool usingPerturbation() const;
+  bool referencePending() const;
+  bool collectIterationStats();
+  bool iterationStatsPending() const;
+
+  void renderToMainMemoryBuffer(int w, int h, int maxSamples = 1,
+                                IterationData* iterations = nullptr);
+  const OfflineRenderStatus& continueOfflineRender();
 
-  double computeMagnification() const;
+  void colourIterationData(const IterationData& data, uint8_t* buffer);
 
-  void renderToMainMemoryBuffer(int w, int h);
-  const OfflineRenderStatus& continueOfflineRender();
+  FrameProfiler& profiler();
+  const FrameProfiler& profiler() const;
 
 private:
   bool m_initialised = false;
@@ -43,6 +64,7 @@ private:
   std::function<void()> m_fnMakeGlContextCurrent;
 
   Mandelbrot m_brot;
+  ProgramCache m_programCache;
 
   struct {
     GLuint id;
@@ -54,14 +76,18 @@ private:
 
     GLuint vao;
     GLuint vbo;
+    GLuint hudVbo;
   } m_program;
 
-  std::string m_vertShaderPath;
-  std::string m_fragShaderPath;
+  std::string m_vertShaderName;
+  std::string m_fragShaderName;
 
   void initUniforms();
   void updateUniforms(const float colour[3]);
   void makeSelectionRect(double x, double y, double w, double h);
+  void addHudRect(double x, double y, double w, double h,
+                  const GLfloat* colour, std::vector<GLfloat>& verts,
+                  std::vector<const GLfloat*>& colours) const;
   void makeRectangle(double x, double y, double w, double h,
                      GLfloat* verts) const;
   double screenToClipSpaceX(double x) const;
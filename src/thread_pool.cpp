@@ -0,0 +1,88 @@
+#include <algorithm>
+#include "thread_pool.hpp"
+
+#ifdef WIN32
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+// Highest nice value, i.e. lowest priority
+static const int LOW_PRIORITY_NICE = 19;
+
+static void lowerThreadPriority() {
+#if defined(WIN32)
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__APPLE__)
+  setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#else
+  // On Linux the nice value belongs to the thread, not the process
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), LOW_PRIORITY_NICE);
+#endif
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads, Priority priority) {
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int i = 0; i < numThreads; ++i) {
+    m_threads.push_back(std::thread([this, priority]() {
+      workerLoop(priority);
+    }));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+unsigned int ThreadPool::numThreads() const {
+  return static_cast<unsigned int>(m_threads.size());
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(task);
+  }
+  m_cv.notify_one();
+}
+
+void ThreadPool::workerLoop(Priority priority) {
+  if (priority == LOW) {
+    lowerThreadPriority();
+  }
+
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]() {
+        return m_stopping || !m_tasks.empty();
+      });
+
+      // Finish any queued work before stopping
+      if (m_tasks.empty()) {
+        return;
+      }
+
+      task = m_tasks.front();
+      m_tasks.pop_front();
+    }
+
+    task();
+  }
+}
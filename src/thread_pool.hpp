@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+class ThreadPool {
+public:
+  // Low priority threads only run when the rest of the app leaves a core
+  // idle, for background work that mustn't slow down interaction
+  enum Priority {
+    NORMAL,
+    LOW
+  };
+
+  // If numThreads is 0, one thread per hardware core is started
+  explicit ThreadPool(unsigned int numThreads = 0,
+                      Priority priority = NORMAL);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template<typename F>
+  std::future<typename std::result_of<F()>::type> run(F fn);
+
+  unsigned int numThreads() const;
+
+private:
+  void enqueue(std::function<void()> task);
+  void workerLoop(Priority priority);
+
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stopping = false;
+};
+
+template<typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::run(F fn) {
+  typedef typename std::result_of<F()>::type result_t;
+
+  auto task = std::make_shared<std::packaged_task<result_t()>>(fn);
+  std::future<result_t> future = task->get_future();
+
+  enqueue([task]() {
+    (*task)();
+  });
+
+  return future;
+}
@@ -0,0 +1,255 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "thumbnail_cache.hpp"
+#include "iteration_stats.hpp"
+#include "utils.hpp"
+
+using std::string;
+
+static const char MAGIC[4] = { 'M', 'B', 'T', 'N' };
+
+// Rendering threads. Few, so that even at low priority they don't compete
+// with export or video for cores.
+static const unsigned int RENDER_THREADS = 2;
+
+// Thumbnails choose their own iteration limit, as the main view does in
+// auto mode, so they don't depend on the current setting
+static const int MIN_ITERATIONS = 64;
+static const int MAX_ITERATIONS = 100000;
+static const int INITIAL_ITERATIONS = 256;
+static const int MAX_ITERATION_PASSES = 8;
+
+// 64-bit FNV-1a
+static uint64_t hash(const string& s) {
+  uint64_t h = 14695981039346656037ull;
+  for (char c : s) {
+    h ^= static_cast<uint8_t>(c);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static bool readThumbnail(const string& filePath, int w, int h,
+                          std::vector<uint8_t>& rgb) {
+  std::ifstream fin(filePath, std::ios::binary);
+  if (!fin.good()) {
+    return false;
+  }
+
+  char magic[4];
+  uint32_t size[2];
+  fin.read(magic, sizeof(magic));
+  fin.read(reinterpret_cast<char*>(size), sizeof(size));
+
+  if (!fin.good() || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      size[0] != static_cast<uint32_t>(w) ||
+      size[1] != static_cast<uint32_t>(h)) {
+
+    return false;
+  }
+
+  rgb.resize(w * h * 3);
+  fin.read(reinterpret_cast<char*>(rgb.data()), rgb.size());
+
+  return fin.good();
+}
+
+static void writeThumbnail(const string& filePath, int w, int h,
+                           const std::vector<uint8_t>& rgb) {
+  // Written under a temporary name, so a partial file is never loaded
+  string tmpPath = filePath + ".tmp";
+
+  {
+    std::ofstream fout(tmpPath, std::ios::binary);
+    uint32_t size[2] = { static_cast<uint32_t>(w), static_cast<uint32_t>(h) };
+
+    fout.write(MAGIC, sizeof(MAGIC));
+    fout.write(reinterpret_cast<const char*>(size), sizeof(size));
+    fout.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+
+    if (!fout.good()) {
+      return;
+    }
+  }
+
+  std::remove(filePath.c_str());
+  std::rename(tmpPath.c_str(), filePath.c_str());
+}
+
+// Lays out escape results as the shader's orbit state, for IterationStats
+static std::vector<float> toOrbitState(const IterationData& data) {
+  std::vector<float> state(data.pixels.size() * 4);
+
+  for (size_t i = 0; i < data.pixels.size(); ++i) {
+    const PixelResult& px = data.pixels[i];
+
+    state[i * 4 + 0] = px.zx;
+    state[i * 4 + 1] = px.zy;
+    state[i * 4 + 2] = px.i;
+    state[i * 4 + 3] = px.i < data.maxIterations ? 1.f : 0.f;
+  }
+
+  return state;
+}
+
+ThumbnailCache::ThumbnailCache(const string& dirPath, int w, int h,
+                               fnColour_t fnColour)
+  : m_dirPath(dirPath),
+    m_w(w),
+    m_h(h),
+    m_fnColour(fnColour),
+    m_generation(0),
+    m_engine(RENDER_THREADS, ThreadPool::LOW),
+    m_deepEngine(RENDER_THREADS, ThreadPool::LOW),
+    m_renderer(1, ThreadPool::LOW),
+    m_loader(1, ThreadPool::LOW) {}
+
+ThumbnailCache::~ThumbnailCache() {
+  // Queued jobs see this and return straight away
+  ++m_generation;
+}
+
+void ThumbnailCache::cancel() {
+  ++m_generation;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_results.clear();
+}
+
+void ThumbnailCache::setColourScheme(const string& computeColourImpl) {
+  cancel();
+  m_computeColourImpl = computeColourImpl;
+}
+
+void ThumbnailCache::request(const string& name, const View& view) {
+  std::stringstream key;
+  key << view.xString() << " " << view.yString() << " "
+      << view.magnificationString(17) << " " << m_w << "x" << m_h << "\n"
+      << m_computeColourImpl;
+
+  std::stringstream fileName;
+  fileName << std::hex << std::setw(16) << std::setfill('0')
+           << hash(key.str()) << ".thumb";
+
+  Job job{name, joinPaths(m_dirPath, fileName.str()), view, m_generation};
+
+  m_loader.run([this, job]() {
+    load(job);
+  });
+}
+
+bool ThumbnailCache::current(const Job& job) const {
+  return job.generation == m_generation;
+}
+
+void ThumbnailCache::load(const Job& job) {
+  if (!current(job)) {
+    return;
+  }
+
+  Result result;
+  result.job = job;
+
+  if (!readThumbnail(job.filePath, m_w, m_h, result.rgb)) {
+    m_renderer.run([this, job]() {
+      render(job);
+    });
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_results.push_back(std::move(result));
+}
+
+void ThumbnailCache::render(const Job& job) {
+  if (!current(job)) {
+    return;
+  }
+
+  int maxIterations = INITIAL_ITERATIONS;
+
+  Result result;
+  result.job = job;
+
+  for (int pass = 0; pass < MAX_ITERATION_PASSES; ++pass) {
+    renderView(job.view, maxIterations, result.data);
+
+    // Abandoned part way through, e.g. the colour scheme has changed
+    if (!current(job)) {
+      return;
+    }
+
+    auto state = toOrbitState(result.data);
+    auto stats = IterationStats::fromOrbitState(state.data(), m_w, m_h,
+                                                maxIterations);
+    int maxI = stats.suggestMaxIterations(MIN_ITERATIONS, MAX_ITERATIONS);
+
+    if (maxI == maxIterations) {
+      break;
+    }
+    maxIterations = maxI;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_results.push_back(std::move(result));
+}
+
+void ThumbnailCache::renderView(const View& view, int maxIterations,
+                                IterationData& data) {
+  if (PerturbationEngine::needed(view, m_h)) {
+    PerturbationParams params;
+    params.w = m_w;
+    params.h = m_h;
+    params.maxIterations = maxIterations;
+    params.view = view;
+
+    m_deepEngine.render(params, data);
+    return;
+  }
+
+  IterationParams params;
+  params.w = m_w;
+  params.h = m_h;
+  params.maxIterations = maxIterations;
+  view.getBounds(static_cast<double>(m_w) / m_h, params.xmin, params.xmax,
+                 params.ymin, params.ymax);
+
+  m_engine.render(params, data);
+}
+
+std::vector<ThumbnailCache::Thumbnail> ThumbnailCache::collect() {
+  std::vector<Result> results;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    results.swap(m_results);
+  }
+
+  std::vector<Thumbnail> thumbnails;
+
+  for (auto& result : results) {
+    if (!current(result.job)) {
+      continue;
+    }
+
+    if (result.rgb.empty()) {
+      result.rgb.resize(m_w * m_h * 3);
+      m_fnColour(result.data, result.rgb.data());
+
+      writeThumbnail(result.job.filePath, m_w, m_h, result.rgb);
+    }
+
+    Thumbnail thumbnail;
+    thumbnail.name = result.job.name;
+    thumbnail.w = m_w;
+    thumbnail.h = m_h;
+    thumbnail.rgb = std::move(result.rgb);
+
+    thumbnails.push_back(std::move(thumbnail));
+  }
+
+  return thumbnails;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include "cpu_engine.hpp"
+#include "perturbation_engine.hpp"
+#include "thread_pool.hpp"
+#include "view.hpp"
+
+// Small previews of saved locations. Each is stored on disk under a key made
+// from the location and the colour scheme, so it's only rendered again when
+// one of those changes. Loading and rendering happen on low priority
+// threads, and finished thumbnails are picked up by polling collect().
+class ThumbnailCache {
+public:
+  typedef std::function<void(const IterationData&, uint8_t*)> fnColour_t;
+
+  struct Thumbnail {
+    std::string name;
+    int w = 0;
+    int h = 0;
+    // RGB, bottom row first
+    std::vector<uint8_t> rgb;
+  };
+
+  // Thumbnails are stored in dirPath, which must exist. Renders are coloured
+  // with fnColour when they're collected.
+  ThumbnailCache(const std::string& dirPath, int w, int h, fnColour_t fnColour);
+  ~ThumbnailCache();
+
+  // Drops queued work and any thumbnails not yet collected
+  void cancel();
+  // Cancels, as thumbnails in the old scheme are no longer wanted
+  void setColourScheme(const std::string& computeColourImpl);
+
+  // Queues a thumbnail, loading it from disk if it's there and rendering it
+  // otherwise
+  void request(const std::string& name, const View& view);
+
+  // Thumbnails finished since the last call. New renders are coloured and
+  // written to disk here, on the calling thread.
+  std::vector<Thumbnail> collect();
+
+private:
+  struct Job {
+    std::string name;
+    std::string filePath;
+    View view;
+    int generation;
+  };
+
+  struct Result {
+    Job job;
+    // Empty if the thumbnail was rendered rather than loaded
+    std::vector<uint8_t> rgb;
+    IterationData data;
+  };
+
+  void load(const Job& job);
+  void render(const Job& job);
+  // With perturbation if the view is too deep for doubles
+  void renderView(const View& view, int maxIterations, IterationData& data);
+  bool current(const Job& job) const;
+
+  std::string m_dirPath;
+  int m_w;
+  int m_h;
+  fnColour_t m_fnColour;
+  std::string m_computeColourImpl;
+  // Incremented to discard queued jobs
+  std::atomic<int> m_generation;
+  std::mutex m_mutex;
+  std::vector<Result> m_results;
+  CpuEngine m_engine;
+  PerturbationEngine m_deepEngine;
+  // Declared last, so they finish before the members they use are
+  // destroyed. The loader hands work to the renderer, so it goes first.
+  ThreadPool m_renderer;
+  ThreadPool m_loader;
+};
@@ -33,11 +33,11 @@ string userDataPath(const string& relPath) {
   return joinPaths(standardPaths.GetUserDataDir(), relPath);
 }
 
-string numberToString(double d, bool scientific) {
+string numberToString(double d, bool scientific, int precision) {
   std::stringstream ss;
   if (scientific) {
     ss << std::scientific;
   }
-  ss << d;
+  ss << std::setprecision(precision) << d;
   return ss.str();
 }
@@ -19,7 +19,7 @@ const char SEPARATOR = '/';
 std::string versionString();
 std::string appDataPath(const std::string& relPath = "");
 std::string userDataPath(const std::string& relPath = "");
-std::string numberToString(double d, bool scientific);
+std::string numberToString(double d, bool scientific, int precision = 6);
 
 template <typename T_FIRST, typename ...T_REST>
 std::string joinPaths(T_FIRST first, T_REST... rest) {
@@ -0,0 +1,219 @@
+#include "video_page.hpp"
+#include "utils.hpp"
+#include "wx_helpers.hpp"
+
+using std::string;
+
+static const double DEFAULT_DURATION = 10.0;
+static const double MIN_DURATION = 0.1;
+static const double MAX_DURATION = 3600.0;
+static const double DEFAULT_FPS = 30.0;
+static const double MIN_FPS = 1.0;
+static const double MAX_FPS = 120.0;
+static const long DEFAULT_VIDEO_WIDTH = 1280;
+static const long DEFAULT_VIDEO_HEIGHT = 720;
+static const long MIN_VIDEO_SIZE = 16;
+static const long MAX_VIDEO_SIZE = 7680;
+
+wxDEFINE_EVENT(RENDER_VIDEO_EVENT, RenderVideoEvent);
+
+RenderVideoEvent::RenderVideoEvent(const VideoParams& params,
+                                   const string& startLocation,
+                                   const string& endLocation)
+  : wxCommandEvent(RENDER_VIDEO_EVENT),
+    params(params),
+    startLocation(startLocation),
+    endLocation(endLocation) {}
+
+RenderVideoEvent::RenderVideoEvent(const RenderVideoEvent& cpy)
+  : wxCommandEvent(cpy),
+    params(cpy.params),
+    startLocation(cpy.startLocation),
+    endLocation(cpy.endLocation) {}
+
+wxEvent* RenderVideoEvent::Clone() const {
+  return new RenderVideoEvent(*this);
+}
+
+VideoPage::VideoPage(wxWindow* parent)
+  : wxNotebookPage(parent, wxID_ANY) {
+
+  m_btnRender = new wxButton(this, wxID_ANY, wxGetTranslation("Render"));
+  m_btnRender->Bind(wxEVT_BUTTON, &VideoPage::onRenderClick, this);
+
+  m_progressBar = new wxGauge(this, wxID_ANY, 100);
+
+  auto vbox = new wxBoxSizer(wxVERTICAL);
+  vbox->Add(constructTimelinePanel(this), 0, wxEXPAND | wxALL, 10);
+  vbox->Add(constructOutputPanel(this), 0,
+            wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  vbox->Add(m_btnRender, 0, wxALIGN_RIGHT | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  vbox->Add(m_progressBar, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM |
+                              wxRESERVE_SPACE_EVEN_IF_HIDDEN, 10);
+
+  setLocationNames({});
+  m_progressBar->Hide();
+
+  SetSizer(vbox);
+}
+
+wxStaticBoxSizer* VideoPage::constructTimelinePanel(wxWindow* parent) {
+  auto boxSizer = new wxStaticBoxSizer(wxVERTICAL, parent,
+                                       wxGetTranslation("Timeline"));
+  auto box = boxSizer->GetStaticBox();
+
+  auto grid = new wxFlexGridSizer(2);
+  boxSizer->Add(grid, 1, wxEXPAND);
+
+  auto lblStart = constructLabel(box, wxGetTranslation("Start"));
+  m_choStart = new wxChoice(box, wxID_ANY);
+
+  auto lblEnd = constructLabel(box, wxGetTranslation("End"));
+  m_choEnd = new wxChoice(box, wxID_ANY);
+
+  auto lblDuration = constructLabel(box, wxGetTranslation("Duration (s)"));
+  m_txtDuration = constructTextBox(box, numberToString(DEFAULT_DURATION,
+                                                       false));
+  m_txtDuration->SetValidator(wxTextValidator(wxFILTER_NUMERIC));
+
+  auto lblFps = constructLabel(box, wxGetTranslation("Frame rate"));
+  m_txtFps = constructTextBox(box, numberToString(DEFAULT_FPS, false));
+  m_txtFps->SetValidator(wxTextValidator(wxFILTER_NUMERIC));
+
+  grid->AddSpacer(10);
+  grid->AddSpacer(10);
+  grid->Add(lblStart, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_choStart, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblEnd, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_choEnd, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblDuration, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtDuration, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblFps, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtFps, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+
+  grid->AddGrowableCol(0);
+  grid->AddGrowableCol(1);
+
+  return boxSizer;
+}
+
+wxStaticBoxSizer* VideoPage::constructOutputPanel(wxWindow* parent) {
+  auto boxSizer = new wxStaticBoxSizer(wxVERTICAL, parent,
+                                       wxGetTranslation("Output"));
+  auto box = boxSizer->GetStaticBox();
+
+  auto grid = new wxFlexGridSizer(2);
+  boxSizer->Add(grid, 1, wxEXPAND);
+
+  auto lblWidth = constructLabel(box, wxGetTranslation("Width"));
+  m_txtWidth = constructTextBox(box, std::to_string(DEFAULT_VIDEO_WIDTH));
+  m_txtWidth->SetValidator(wxTextValidator(wxFILTER_DIGITS));
+
+  auto lblHeight = constructLabel(box, wxGetTranslation("Height"));
+  m_txtHeight = constructTextBox(box, std::to_string(DEFAULT_VIDEO_HEIGHT));
+  m_txtHeight->SetValidator(wxTextValidator(wxFILTER_DIGITS));
+
+  auto lblFormat = constructLabel(box, wxGetTranslation("Format"));
+  m_choFormat = new wxChoice(box, wxID_ANY);
+  m_choFormat->Append(wxGetTranslation("PNG sequence"));
+  m_choFormat->Append(wxGetTranslation("Video (ffmpeg)"));
+  m_choFormat->SetSelection(VideoParams::PNG_SEQUENCE);
+
+  m_chkSynthesise = new wxCheckBox(box, wxID_ANY,
+                                   wxGetTranslation("Synthesise frames from "
+                                                    "keyframes"));
+  m_chkSynthesise->SetToolTip(wxGetTranslation("Render one keyframe per 2x "
+                                               "zoom and resample the frames "
+                                               "from them. Much faster, but "
+                                               "not used if the start and "
+                                               "end are the same size."));
+
+  grid->AddSpacer(10);
+  grid->AddSpacer(10);
+  grid->Add(lblWidth, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtWidth, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblHeight, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_txtHeight, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(lblFormat, 0, wxEXPAND | wxLEFT | wxRIGHT | wxBOTTOM, 10);
+  grid->Add(m_choFormat, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+  grid->AddSpacer(1);
+  grid->Add(m_chkSynthesise, 0, wxEXPAND | wxRIGHT | wxBOTTOM, 10);
+
+  grid->AddGrowableCol(0);
+  grid->AddGrowableCol(1);
+
+  return boxSizer;
+}
+
+void VideoPage::setLocationNames(const std::vector<string>& names) {
+  for (wxChoice* choice : { m_choStart, m_choEnd }) {
+    wxString selection = choice->GetStringSelection();
+
+    choice->Clear();
+    choice->Append(wxGetTranslation("Current view"));
+    for (const string& name : names) {
+      choice->Append(name);
+    }
+
+    if (!choice->SetStringSelection(selection)) {
+      choice->SetSelection(0);
+    }
+  }
+}
+
+string VideoPage::getLocationName(const wxChoice& choice) const {
+  if (choice.GetSelection() <= 0) {
+    return "";
+  }
+
+  return choice.GetStringSelection().ToStdString();
+}
+
+void VideoPage::setBusy(bool busy) {
+  if (busy) {
+    m_progressBar->SetValue(0);
+    m_progressBar->Show();
+    m_btnRender->Disable();
+  }
+  else {
+    m_progressBar->Hide();
+    m_btnRender->Enable();
+  }
+}
+
+void VideoPage::setProgress(int progress) {
+  m_progressBar->SetValue(progress);
+}
+
+void VideoPage::onRenderClick(wxCommandEvent&) {
+  VideoParams params;
+  params.duration = getBoundedValue<double>(*m_txtDuration, MIN_DURATION,
+                                            MAX_DURATION);
+  params.fps = getBoundedValue<double>(*m_txtFps, MIN_FPS, MAX_FPS);
+  params.w = getBoundedValue<long>(*m_txtWidth, MIN_VIDEO_SIZE,
+                                   MAX_VIDEO_SIZE);
+  params.h = getBoundedValue<long>(*m_txtHeight, MIN_VIDEO_SIZE,
+                                   MAX_VIDEO_SIZE);
+  params.format = static_cast<VideoParams::Format>(m_choFormat->GetSelection());
+  params.synthesiseFrames = m_chkSynthesise->GetValue();
+
+  if (params.format == VideoParams::PNG_SEQUENCE) {
+    wxDirDialog dirDialog(this, wxGetTranslation("Save frames to"));
+    if (dirDialog.ShowModal() == wxID_CANCEL) {
+      return;
+    }
+    params.outputPath = dirDialog.GetPath().ToStdString();
+  }
+  else {
+    wxFileDialog fileDialog(this, wxGetTranslation("Save video as"), "", "",
+                            "MP4 files (*.mp4)|*.mp4", wxFD_SAVE);
+    if (fileDialog.ShowModal() == wxID_CANCEL) {
+      return;
+    }
+    params.outputPath = fileDialog.GetPath().ToStdString();
+  }
+
+  RenderVideoEvent event(params, getLocationName(*m_choStart),
+                         getLocationName(*m_choEnd));
+  wxPostEvent(this, event);
+}
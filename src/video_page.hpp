@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <wx/wx.h>
+#include <wx/notebook.h>
+#include "video_renderer.hpp"
+
+class RenderVideoEvent;
+
+wxDECLARE_EVENT(RENDER_VIDEO_EVENT, RenderVideoEvent);
+
+class RenderVideoEvent : public wxCommandEvent {
+public:
+  // An empty location name means the current view
+  RenderVideoEvent(const VideoParams& params, const std::string& startLocation,
+                   const std::string& endLocation);
+  RenderVideoEvent(const RenderVideoEvent& cpy);
+
+  wxEvent* Clone() const override;
+
+  VideoParams params;
+  std::string startLocation;
+  std::string endLocation;
+};
+
+class VideoPage : public wxNotebookPage {
+public:
+  VideoPage(wxWindow* parent);
+
+  void setLocationNames(const std::vector<std::string>& names);
+  void setBusy(bool busy);
+  void setProgress(int progress);
+
+private:
+  wxStaticBoxSizer* constructTimelinePanel(wxWindow* parent);
+  wxStaticBoxSizer* constructOutputPanel(wxWindow* parent);
+  std::string getLocationName(const wxChoice& choice) const;
+
+  void onRenderClick(wxCommandEvent& e);
+
+  wxChoice* m_choStart;
+  wxChoice* m_choEnd;
+  wxTextCtrl* m_txtDuration;
+  wxTextCtrl* m_txtFps;
+  wxTextCtrl* m_txtWidth;
+  wxTextCtrl* m_txtHeight;
+  wxChoice* m_choFormat;
+  wxCheckBox* m_chkSynthesise;
+  wxButton* m_btnRender;
+  wxGauge* m_progressBar;
+};
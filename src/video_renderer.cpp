@@ -0,0 +1,620 @@
+#include <cmath>
+#include <cerrno>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <wx/image.h>
+#include "video_renderer.hpp"
+#include "utils.hpp"
+
+#ifdef WIN32
+  #define NOMINMAX
+  #include <windows.h>
+  #include <io.h>
+  #include <fcntl.h>
+#else
+  #include <fcntl.h>
+  #include <spawn.h>
+  #include <unistd.h>
+  #include <sys/wait.h>
+  extern char** environ;
+#endif
+
+using std::string;
+namespace chrono = std::chrono;
+
+static const size_t QUEUE_CAPACITY = 4;
+
+static double secondsSince(const chrono::high_resolution_clock::time_point& t) {
+  return chrono::duration_cast<chrono::duration<double>>(
+    chrono::high_resolution_clock::now() - t).count();
+}
+
+double StageStats::framesPerSecond() const {
+  return busySeconds > 0.0 ? frames / busySeconds : 0.0;
+}
+
+VideoRenderer::VideoRenderer(const VideoParams& params, fnColour_t fnColour)
+  : m_params(params),
+    m_path(params.keyframes),
+    m_fnColour(fnColour),
+    m_renderedFrames(QUEUE_CAPACITY),
+    m_colouredFrames(QUEUE_CAPACITY),
+    m_synthesisedFrames(QUEUE_CAPACITY),
+    m_cancelled(false),
+    m_failed(false),
+    m_framesEncoded(0),
+    m_finished(false) {
+
+  m_numFrames = std::max(1, static_cast<int>(std::round(params.duration *
+                                                        params.fps)));
+
+  // Keyframes may be off the path by up to half a pixel
+  double tolerance = 0.5 / params.h;
+  if (params.synthesiseFrames && !m_path.zoomsAboutFixedPoint(tolerance)) {
+    m_params.synthesiseFrames = false;
+    m_synthesisDeclined = true;
+  }
+  m_path.fixedPoint(m_fixedX, m_fixedY);
+
+  double doublings = m_path.maxLog2Height() - m_path.minLog2Height();
+  m_numKeyframes = std::max(1, static_cast<int>(std::ceil(doublings - 1e-9)))
+                   + 1;
+
+  m_stats.resize(4);
+  m_stats[RENDER].name = "Render";
+  m_stats[COLOUR].name = "Colour";
+  m_stats[SYNTHESISE].name = "Synthesise";
+  m_stats[ENCODE].name = "Encode";
+}
+
+VideoRenderer::~VideoRenderer() {
+  cancel();
+}
+
+void VideoRenderer::start() {
+  openEncoder();
+
+  if (m_failed) {
+    return;
+  }
+
+  m_renderThread = std::thread([this]() {
+    renderLoop();
+  });
+
+  if (m_params.synthesiseFrames) {
+    m_synthesiseThread = std::thread([this]() {
+      synthesiseLoop();
+    });
+  }
+
+  m_encodeThread = std::thread([this]() {
+    encodeLoop();
+  });
+}
+
+void VideoRenderer::cancel() {
+  m_cancelled = true;
+
+  m_renderedFrames.close();
+  m_colouredFrames.close();
+  m_synthesisedFrames.close();
+
+  if (m_renderThread.joinable()) {
+    m_renderThread.join();
+  }
+  if (m_synthesiseThread.joinable()) {
+    m_synthesiseThread.join();
+  }
+  if (m_encodeThread.joinable()) {
+    m_encodeThread.join();
+  }
+
+  closeEncoder();
+}
+
+double VideoRenderer::frameTime(int frame) const {
+  if (m_numFrames < 2) {
+    return 0.0;
+  }
+
+  return m_params.duration * frame / (m_numFrames - 1);
+}
+
+void VideoRenderer::renderView(const View& view, int w, int h,
+                               IterationData& data) {
+  if (PerturbationEngine::needed(view, h)) {
+    PerturbationParams params;
+    params.w = w;
+    params.h = h;
+    params.maxIterations = m_params.maxIterations;
+    params.view = view;
+
+    m_deepEngine.render(params, data);
+    return;
+  }
+
+  IterationParams params;
+  params.w = w;
+  params.h = h;
+  params.maxIterations = m_params.maxIterations;
+  view.getBounds(static_cast<double>(w) / h, params.xmin, params.xmax,
+                 params.ymin, params.ymax);
+
+  m_engine.render(params, data);
+}
+
+View VideoRenderer::frameView(int frame) const {
+  return m_path.interpolate(frameTime(frame));
+}
+
+double VideoRenderer::keyframeLog2Height(int keyframe) const {
+  return m_path.maxLog2Height() - keyframe;
+}
+
+int VideoRenderer::keyframeForFrame(int frame) const {
+  double k = m_path.maxLog2Height() - frameView(frame).log2Height();
+  return std::max(0, std::min(m_numKeyframes - 2,
+                              static_cast<int>(std::floor(k))));
+}
+
+View VideoRenderer::keyframeView(int keyframe) const {
+  return m_path.viewAt(keyframeLog2Height(keyframe));
+}
+
+void VideoRenderer::renderLoop() {
+  for (int i = 0; i < numRenderedFrames() && !m_cancelled; ++i) {
+    auto t = chrono::high_resolution_clock::now();
+
+    RenderedFrame frame;
+    frame.data.reset(new IterationData);
+
+    if (m_params.synthesiseFrames) {
+      // Keyframes are rendered in the order the video passes through them
+      frame.index = m_path.zoomingIn() ? i : m_numKeyframes - 1 - i;
+      renderView(keyframeView(frame.index), 2 * m_params.w, 2 * m_params.h,
+                 *frame.data);
+    }
+    else {
+      frame.index = i;
+      renderView(frameView(i), m_params.w, m_params.h, *frame.data);
+    }
+
+    recordStageTime(RENDER, secondsSince(t));
+
+    if (!m_renderedFrames.push(std::move(frame))) {
+      break;
+    }
+  }
+}
+
+bool VideoRenderer::continueRender() {
+  if (m_failed || m_cancelled || m_finished) {
+    return false;
+  }
+
+  if (m_colouredFrames.full()) {
+    std::this_thread::sleep_for(chrono::milliseconds(10));
+    return true;
+  }
+
+  RenderedFrame frame;
+  if (m_renderedFrames.popFor(frame, chrono::milliseconds(10))) {
+    auto t = chrono::high_resolution_clock::now();
+
+    ColouredFrame coloured;
+    coloured.index = frame.index;
+    coloured.w = frame.data->w;
+    coloured.h = frame.data->h;
+    coloured.rgb.resize(frame.data->w * frame.data->h * 3);
+    m_fnColour(*frame.data, coloured.rgb.data());
+
+    recordStageTime(COLOUR, secondsSince(t));
+
+    m_colouredFrames.push(std::move(coloured));
+  }
+
+  return true;
+}
+
+static void sampleBilinear(const uint8_t* rgb, int w, int h, double x,
+                           double y, uint8_t* dst) {
+  x = std::max(0.0, std::min(x, w - 1.0));
+  y = std::max(0.0, std::min(y, h - 1.0));
+
+  int x0 = static_cast<int>(x);
+  int y0 = static_cast<int>(y);
+  int x1 = std::min(x0 + 1, w - 1);
+  int y1 = std::min(y0 + 1, h - 1);
+  double fx = x - x0;
+  double fy = y - y0;
+
+  const uint8_t* p00 = rgb + (y0 * w + x0) * 3;
+  const uint8_t* p10 = rgb + (y0 * w + x1) * 3;
+  const uint8_t* p01 = rgb + (y1 * w + x0) * 3;
+  const uint8_t* p11 = rgb + (y1 * w + x1) * 3;
+
+  for (int c = 0; c < 3; ++c) {
+    double top = p00[c] + fx * (p10[c] - p00[c]);
+    double bottom = p01[c] + fx * (p11[c] - p01[c]);
+    dst[c] = static_cast<uint8_t>(top + fy * (bottom - top) + 0.5);
+  }
+}
+
+void VideoRenderer::synthesiseFrame(int frame, const ColouredFrame& outer,
+                                    const ColouredFrame& inner,
+                                    ColouredFrame& out) const {
+  int w = m_params.w;
+  int h = m_params.h;
+
+  // How far the frame is zoomed in relative to the outer keyframe, in [1, 2]
+  double r = std::exp2(keyframeLog2Height(outer.index) -
+                       frameView(frame).log2Height());
+  double fx = m_fixedX;
+  double fy = m_fixedY;
+
+  out.index = frame;
+  out.w = w;
+  out.h = h;
+  out.rgb.resize(w * h * 3);
+
+  for (int py = 0; py < h; ++py) {
+    // Offset from the centre in units of frame height
+    double uy = (py + 0.5 - 0.5 * h) / h;
+
+    for (int px = 0; px < w; ++px) {
+      double ux = (px + 0.5 - 0.5 * w) / h;
+      uint8_t* dst = out.rgb.data() + (py * w + px) * 3;
+
+      // The fixed point is at the same place in every frame and keyframe,
+      // and everything else moves away from it as the view is zoomed
+      double ix = (2.0 * (ux - fx) / r + fx) * inner.h + 0.5 * inner.w - 0.5;
+      double iy = (2.0 * (uy - fy) / r + fy) * inner.h + 0.5 * inner.h - 0.5;
+
+      if (ix >= 0.0 && ix <= inner.w - 1 && iy >= 0.0 && iy <= inner.h - 1) {
+        sampleBilinear(inner.rgb.data(), inner.w, inner.h, ix, iy, dst);
+      }
+      else {
+        double ox = ((ux - fx) / r + fx) * outer.h + 0.5 * outer.w - 0.5;
+        double oy = ((uy - fy) / r + fy) * outer.h + 0.5 * outer.h - 0.5;
+        sampleBilinear(outer.rgb.data(), outer.w, outer.h, ox, oy, dst);
+      }
+    }
+  }
+}
+
+void VideoRenderer::synthesiseLoop() {
+  std::map<int, ColouredFrame> keyframes;
+
+  for (int i = 0; i < m_numFrames; ++i) {
+    int k = keyframeForFrame(i);
+
+    while (keyframes.count(k) == 0 || keyframes.count(k + 1) == 0) {
+      ColouredFrame keyframe;
+      if (!m_colouredFrames.pop(keyframe)) {
+        return;
+      }
+      keyframes[keyframe.index] = std::move(keyframe);
+    }
+
+    // The video only moves one way through the keyframes, so any others
+    // won't be needed again
+    for (auto j = keyframes.begin(); j != keyframes.end();) {
+      if (j->first != k && j->first != k + 1) {
+        j = keyframes.erase(j);
+      }
+      else {
+        ++j;
+      }
+    }
+
+    auto t = chrono::high_resolution_clock::now();
+
+    ColouredFrame frame;
+    synthesiseFrame(i, keyframes[k], keyframes[k + 1], frame);
+
+    recordStageTime(SYNTHESISE, secondsSince(t));
+
+    if (!m_synthesisedFrames.push(std::move(frame))) {
+      return;
+    }
+  }
+}
+
+void VideoRenderer::encodeLoop() {
+  auto& frames = m_params.synthesiseFrames ? m_synthesisedFrames :
+                                             m_colouredFrames;
+
+  for (int i = 0; i < m_numFrames; ++i) {
+    ColouredFrame frame;
+    if (!frames.pop(frame)) {
+      break;
+    }
+
+    auto t = chrono::high_resolution_clock::now();
+
+    if (!writeFrame(frame)) {
+      break;
+    }
+
+    recordStageTime(ENCODE, secondsSince(t));
+
+    ++m_framesEncoded;
+  }
+
+  // Wait for the encoder to flush before reporting completion
+  closeEncoder();
+  m_finished = true;
+}
+
+#ifdef WIN32
+// Quotes an argument so the child's C runtime parses it back unchanged
+static string quoteArgument(const string& arg) {
+  if (!arg.empty() && arg.find_first_of(" \t\n\v\"") == string::npos) {
+    return arg;
+  }
+
+  string quoted = "\"";
+  size_t backslashes = 0;
+  for (char c : arg) {
+    if (c == '\\') {
+      ++backslashes;
+      continue;
+    }
+    // Backslashes are only special before a quote
+    quoted.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+    quoted += c;
+    backslashes = 0;
+  }
+  quoted.append(2 * backslashes, '\\');
+  quoted += '"';
+
+  return quoted;
+}
+#endif
+
+// The encoder is started directly rather than through a shell, so nothing
+// in the output path is interpreted as shell syntax
+void VideoRenderer::openEncoder() {
+  if (m_params.format != VideoParams::ENCODER_PIPE) {
+    return;
+  }
+
+  std::stringstream size;
+  size << m_params.w << "x" << m_params.h;
+  std::stringstream fps;
+  fps << m_params.fps;
+
+  std::vector<string> args{m_params.encoder, "-y", "-loglevel", "error",
+                           "-f", "rawvideo", "-pix_fmt", "rgb24",
+                           "-s", size.str(), "-r", fps.str(), "-i", "-",
+                           "-pix_fmt", "yuv420p", m_params.outputPath};
+
+#ifdef WIN32
+  string cmdLine;
+  for (const string& arg : args) {
+    cmdLine += (cmdLine.empty() ? "" : " ") + quoteArgument(arg);
+  }
+
+  SECURITY_ATTRIBUTES sa{};
+  sa.nLength = sizeof(sa);
+  sa.bInheritHandle = TRUE;
+
+  HANDLE readEnd = nullptr;
+  HANDLE writeEnd = nullptr;
+  if (!CreatePipe(&readEnd, &writeEnd, &sa, 0)) {
+    setError("Failed to start encoder: " + cmdLine);
+    return;
+  }
+  // Only the encoder's end of the pipe is inherited
+  SetHandleInformation(writeEnd, HANDLE_FLAG_INHERIT, 0);
+
+  STARTUPINFOA si{};
+  si.cb = sizeof(si);
+  si.dwFlags = STARTF_USESTDHANDLES;
+  si.hStdInput = readEnd;
+  si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+  si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+  PROCESS_INFORMATION pi{};
+  BOOL started = CreateProcessA(nullptr, &cmdLine[0], nullptr, nullptr, TRUE,
+                                CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
+  CloseHandle(readEnd);
+
+  if (!started) {
+    CloseHandle(writeEnd);
+    setError("Failed to start encoder: " + cmdLine);
+    return;
+  }
+  CloseHandle(pi.hThread);
+  m_encoderProcess = pi.hProcess;
+
+  int fd = _open_osfhandle(reinterpret_cast<intptr_t>(writeEnd),
+                           _O_WRONLY | _O_BINARY);
+  if (fd == -1) {
+    CloseHandle(writeEnd);
+  }
+  else if ((m_pipe = _fdopen(fd, "wb")) == nullptr) {
+    _close(fd);
+  }
+#else
+  std::vector<char*> argv;
+  for (string& arg : args) {
+    argv.push_back(&arg[0]);
+  }
+  argv.push_back(nullptr);
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    setError("Failed to start encoder: " + m_params.encoder);
+    return;
+  }
+  // Keep the pipe out of any other child processes. The encoder's copy of
+  // the read end, made by dup2, stays open.
+  fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+
+  pid_t pid;
+  int err = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(),
+                         environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(fds[0]);
+
+  if (err != 0) {
+    close(fds[1]);
+    setError("Failed to start encoder: " + m_params.encoder);
+    return;
+  }
+  m_encoderPid = pid;
+
+  m_pipe = fdopen(fds[1], "w");
+  if (m_pipe == nullptr) {
+    close(fds[1]);
+  }
+#endif
+
+  if (m_pipe == nullptr) {
+    setError("Failed to open pipe to encoder");
+  }
+}
+
+void VideoRenderer::closeEncoder() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Closing the pipe ends the encoder's input, so it can finish the file
+  if (m_pipe != nullptr) {
+    fclose(m_pipe);
+    m_pipe = nullptr;
+  }
+
+  bool succeeded = true;
+#ifdef WIN32
+  if (m_encoderProcess == nullptr) {
+    return;
+  }
+  DWORD exitCode = 1;
+  WaitForSingleObject(m_encoderProcess, INFINITE);
+  GetExitCodeProcess(m_encoderProcess, &exitCode);
+  CloseHandle(m_encoderProcess);
+  m_encoderProcess = nullptr;
+  succeeded = exitCode == 0;
+#else
+  if (m_encoderPid == -1) {
+    return;
+  }
+  int status = 0;
+  while (waitpid(m_encoderPid, &status, 0) == -1 && errno == EINTR) {}
+  m_encoderPid = -1;
+  succeeded = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+
+  if (!succeeded && !m_cancelled && m_error.empty()) {
+    m_error = "Encoder exited with an error";
+    m_failed = true;
+  }
+}
+
+bool VideoRenderer::writeFrame(const ColouredFrame& frame) {
+  int w = m_params.w;
+  int h = m_params.h;
+  size_t stride = w * 3;
+
+  if (m_params.format == VideoParams::ENCODER_PIPE) {
+    // Frames are stored bottom row first
+    for (int row = h - 1; row >= 0; --row) {
+      if (fwrite(frame.rgb.data() + row * stride, 1, stride, m_pipe) !=
+          stride) {
+
+        setError("Failed to write frame to encoder");
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  std::stringstream ss;
+  ss << "frame_" << std::setw(6) << std::setfill('0') << frame.index << ".png";
+  string filePath = joinPaths(m_params.outputPath, ss.str());
+
+  wxImage image(w, h, const_cast<uint8_t*>(frame.rgb.data()), true);
+  if (!image.Mirror(false).SaveFile(filePath, wxBITMAP_TYPE_PNG)) {
+    setError("Failed to write " + filePath);
+    return false;
+  }
+
+  return true;
+}
+
+void VideoRenderer::recordStageTime(Stage stage, double seconds) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_stats[stage].frames++;
+  m_stats[stage].busySeconds += seconds;
+}
+
+void VideoRenderer::setError(const string& msg) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_error.empty()) {
+    m_error = msg;
+  }
+  m_failed = true;
+}
+
+int VideoRenderer::numFrames() const {
+  return m_numFrames;
+}
+
+bool VideoRenderer::synthesisingFrames() const {
+  return m_params.synthesiseFrames;
+}
+
+int VideoRenderer::numRenderedFrames() const {
+  return m_params.synthesiseFrames ? m_numKeyframes : m_numFrames;
+}
+
+int VideoRenderer::progress() const {
+  return 100 * m_framesEncoded / m_numFrames;
+}
+
+const string& VideoRenderer::getError() const {
+  return m_error;
+}
+
+std::vector<StageStats> VideoRenderer::getStageStats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+string VideoRenderer::stageStatsString() const {
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+
+  auto stats = getStageStats();
+  for (size_t i = 0; i < stats.size(); ++i) {
+    if (i == SYNTHESISE && !m_params.synthesiseFrames) {
+      continue;
+    }
+    if (i > 0) {
+      ss << ", ";
+    }
+    ss << stats[i].name << " " << stats[i].framesPerSecond() << "/s";
+  }
+
+  if (m_params.synthesiseFrames) {
+    ss << " (" << m_numKeyframes << " keyframes for " << m_numFrames
+       << " frames)";
+  }
+  else if (m_synthesisDeclined) {
+    ss << " (every frame rendered, as the path isn't a zoom)";
+  }
+
+  return ss.str();
+}
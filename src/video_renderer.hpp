@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstdio>
+#include "iteration_data.hpp"
+#include "blocking_queue.hpp"
+#include "cpu_engine.hpp"
+#include "perturbation_engine.hpp"
+#include "zoom_path.hpp"
+
+struct VideoParams {
+  enum Format {
+    PNG_SEQUENCE,
+    ENCODER_PIPE
+  };
+
+  int w = 1280;
+  int h = 720;
+  double fps = 30.0;
+  double duration = 10.0;
+  int maxIterations = 0;
+  std::vector<Keyframe> keyframes;
+  Format format = PNG_SEQUENCE;
+  // Directory for a PNG sequence, or the file the encoder writes to
+  std::string outputPath;
+  std::string encoder = "ffmpeg";
+  // Render keyframes at successive 2x zoom levels and resample the video
+  // frames from them, rather than rendering every frame. Ignored unless the
+  // keyframes make a zoom about a fixed point.
+  bool synthesiseFrames = false;
+};
+
+struct StageStats {
+  std::string name;
+  int frames = 0;
+  double busySeconds = 0.0;
+
+  double framesPerSecond() const;
+};
+
+// Renders a zoom movie offline. Frames are iterated on the CPU, by
+// perturbation where they're too deep for doubles, then coloured by
+// the caller (on the thread that owns the GL context) and encoded on a
+// third thread, with bounded queues between the stages so all three run at
+// once.
+//
+// When synthesising frames, only one keyframe per doubling of magnification
+// is rendered, at twice the video resolution. Each video frame is resampled
+// from the pair of keyframes that bracket its magnification, taking the
+// inner, more detailed keyframe wherever it covers the frame. That only
+// works for a zoom about a fixed point, so pans between views of the same
+// size are rendered frame by frame.
+class VideoRenderer {
+public:
+  typedef std::function<void(const IterationData&, uint8_t*)> fnColour_t;
+
+  VideoRenderer(const VideoParams& params, fnColour_t fnColour);
+  ~VideoRenderer();
+
+  void start();
+  // Colours any frames that are ready. Returns false once the video is
+  // complete, or if an error occurred.
+  bool continueRender();
+  void cancel();
+
+  int numFrames() const;
+  // False if synthesis wasn't asked for, or the path can't have frames
+  // synthesised
+  bool synthesisingFrames() const;
+  int numRenderedFrames() const;
+  int progress() const;
+  const std::string& getError() const;
+  std::vector<StageStats> getStageStats() const;
+  std::string stageStatsString() const;
+
+  View frameView(int frame) const;
+  View keyframeView(int keyframe) const;
+
+private:
+  struct RenderedFrame {
+    int index;
+    std::unique_ptr<IterationData> data;
+  };
+
+  struct ColouredFrame {
+    int index;
+    int w;
+    int h;
+    std::vector<uint8_t> rgb;
+  };
+
+  enum Stage {
+    RENDER,
+    COLOUR,
+    SYNTHESISE,
+    ENCODE
+  };
+
+  double frameTime(int frame) const;
+  double keyframeLog2Height(int keyframe) const;
+  int keyframeForFrame(int frame) const;
+  void renderView(const View& view, int w, int h, IterationData& data);
+  void synthesiseFrame(int frame, const ColouredFrame& outer,
+                       const ColouredFrame& inner, ColouredFrame& out) const;
+
+  void renderLoop();
+  void synthesiseLoop();
+  void encodeLoop();
+  void openEncoder();
+  void closeEncoder();
+  bool writeFrame(const ColouredFrame& frame);
+  void recordStageTime(Stage stage, double seconds);
+  void setError(const std::string& msg);
+
+  VideoParams m_params;
+  ZoomPath m_path;
+  fnColour_t m_fnColour;
+  int m_numFrames = 0;
+  int m_numKeyframes = 0;
+  // Synthesis was asked for, but the path isn't a zoom about a fixed point
+  bool m_synthesisDeclined = false;
+  // Where the fixed point is in each frame, in frame heights from the centre
+  double m_fixedX = 0.0;
+  double m_fixedY = 0.0;
+  CpuEngine m_engine;
+  PerturbationEngine m_deepEngine;
+  BlockingQueue<RenderedFrame> m_renderedFrames;
+  BlockingQueue<ColouredFrame> m_colouredFrames;
+  BlockingQueue<ColouredFrame> m_synthesisedFrames;
+  std::thread m_renderThread;
+  std::thread m_synthesiseThread;
+  std::thread m_encodeThread;
+  std::atomic<bool> m_cancelled;
+  std::atomic<bool> m_failed;
+  std::atomic<int> m_framesEncoded;
+  std::atomic<bool> m_finished;
+  FILE* m_pipe = nullptr;
+#ifdef WIN32
+  void* m_encoderProcess = nullptr;
+#else
+  int m_encoderPid = -1;
+#endif
+  std::string m_error;
+  std::vector<StageStats> m_stats;
+  mutable std::mutex m_mutex;
+};
@@ -0,0 +1,178 @@
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "view.hpp"
+
+using std::string;
+
+static const double INITIAL_X = -0.5;
+static const double INITIAL_Y = 0.0;
+// The view is 4 high at magnification 1
+static const double INITIAL_LOG2_HEIGHT = 2.0;
+
+// Bits of the centre above the view's height: enough for coordinates up to
+// 4 in magnitude, then enough for a 65536 pixel image, with some to spare for
+// rounding as the view is moved around
+static const unsigned long INTEGER_BITS = 3;
+static const unsigned long PIXEL_BITS = 16;
+static const unsigned long GUARD_BITS = 32;
+// Shallow views still get the precision of a double and more
+static const unsigned long MIN_PRECISION_BITS = 64;
+
+View::View()
+  : m_x(INITIAL_X, MIN_PRECISION_BITS),
+    m_y(INITIAL_Y, MIN_PRECISION_BITS),
+    m_log2Height(INITIAL_LOG2_HEIGHT) {}
+
+View::View(const BigFloat& x, const BigFloat& y, double log2Height)
+  : m_x(x),
+    m_y(y),
+    m_log2Height(log2Height) {
+
+  updatePrecision();
+}
+
+View View::fromStrings(const string& x, const string& y,
+                       const string& magnification) {
+  BigFloat mag = BigFloat::fromString(magnification, MIN_PRECISION_BITS);
+  if (mpf_sgn(mag.get()) <= 0) {
+    throw std::invalid_argument("Magnification must be positive");
+  }
+
+  // Taken apart first, as it can be beyond the range of a double
+  long exp = 0;
+  double d = mag.toDouble(exp);
+  double log2Height = INITIAL_LOG2_HEIGHT - (std::log2(d) + exp);
+
+  return fromStrings(x, y, log2Height);
+}
+
+View View::fromStrings(const string& x, const string& y, double log2Height) {
+  View view;
+  view.m_log2Height = log2Height;
+  view.m_x = BigFloat::fromString(x, view.precisionBits());
+  view.m_y = BigFloat::fromString(y, view.precisionBits());
+
+  return view;
+}
+
+const BigFloat& View::x() const {
+  return m_x;
+}
+
+const BigFloat& View::y() const {
+  return m_y;
+}
+
+double View::log2Height() const {
+  return m_log2Height;
+}
+
+double View::height() const {
+  return std::exp2(m_log2Height);
+}
+
+double View::magnification() const {
+  return std::exp2(INITIAL_LOG2_HEIGHT - m_log2Height);
+}
+
+double View::log10Magnification() const {
+  return (INITIAL_LOG2_HEIGHT - m_log2Height) * std::log10(2.0);
+}
+
+unsigned long View::precisionBits() const {
+  double depth = std::max(0.0, std::ceil(-m_log2Height));
+
+  return std::max(MIN_PRECISION_BITS,
+                  static_cast<unsigned long>(depth) + INTEGER_BITS +
+                  PIXEL_BITS + GUARD_BITS);
+}
+
+// Guard bits aren't shown, as they'd only be noise
+static size_t significantDigits(const View& view) {
+  unsigned long bits = view.precisionBits() - GUARD_BITS;
+  return static_cast<size_t>(std::ceil(bits * std::log10(2.0)));
+}
+
+string View::xString() const {
+  return m_x.toString(significantDigits(*this));
+}
+
+string View::yString() const {
+  return m_y.toString(significantDigits(*this));
+}
+
+string View::magnificationString(int precision) const {
+  double log10Mag = log10Magnification();
+  double exponent = std::floor(log10Mag);
+  double mantissa = std::pow(10.0, log10Mag - exponent);
+
+  // Otherwise e.g. 9.9999999 would be shown as 10.000000
+  if (mantissa >= 10.0 - 0.5 * std::pow(10.0, -precision)) {
+    mantissa /= 10.0;
+    exponent += 1.0;
+  }
+
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(precision) << mantissa << "e"
+     << (exponent < 0 ? "-" : "+") << std::setw(2) << std::setfill('0')
+     << static_cast<long>(std::fabs(exponent));
+
+  return ss.str();
+}
+
+void View::translate(double dx, double dy) {
+  // The height is split into a power of two, which can be far beyond a
+  // double's range, and a factor that isn't
+  double exponent = std::floor(m_log2Height);
+  double scale = std::exp2(m_log2Height - exponent);
+
+  m_x.addScaled(dx * scale, static_cast<long>(exponent));
+  m_y.addScaled(dy * scale, static_cast<long>(exponent));
+}
+
+// The difference can be far too small for a double, so it's taken apart
+// and scaled by the height's exponent first
+static double offsetInHeights(const BigFloat& a, const BigFloat& b,
+                              double log2Height) {
+  BigFloat diff(a);
+  mpf_sub(diff.get(), a.get(), b.get());
+
+  long exp = 0;
+  double d = diff.toDouble(exp);
+
+  return d * std::exp2(static_cast<double>(exp) - log2Height);
+}
+
+void View::offsetOf(const BigFloat& x, const BigFloat& y, double& dx,
+                    double& dy) const {
+  dx = offsetInHeights(x, m_x, m_log2Height);
+  dy = offsetInHeights(y, m_y, m_log2Height);
+}
+
+void View::zoom(double mag) {
+  m_log2Height -= std::log2(mag);
+  updatePrecision();
+}
+
+void View::getBounds(double aspect, double& xmin, double& xmax, double& ymin,
+                     double& ymax) const {
+  double x = m_x.toDouble();
+  double y = m_y.toDouble();
+  double h = height();
+  double w = h * aspect;
+
+  xmin = x - 0.5 * w;
+  xmax = x + 0.5 * w;
+  ymin = y - 0.5 * h;
+  ymax = y + 0.5 * h;
+}
+
+void View::updatePrecision() {
+  unsigned long bits = precisionBits();
+
+  m_x.setPrecision(bits);
+  m_y.setPrecision(bits);
+}
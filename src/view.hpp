@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include "big_float.hpp"
+
+// The part of the complex plane being looked at, as a centre point and the
+// height of the view as a power of two. The centre has as many bits as it
+// takes to place a pixel at the current depth, so views can be far smaller
+// than doubles can tell apart while shallow ones stay cheap.
+class View {
+public:
+  // The whole set
+  View();
+  View(const BigFloat& x, const BigFloat& y, double log2Height);
+
+  // Throws std::invalid_argument if any of them aren't numbers or the
+  // magnification isn't positive
+  static View fromStrings(const std::string& x, const std::string& y,
+                          const std::string& magnification);
+  // Throws std::invalid_argument if x or y isn't a number
+  static View fromStrings(const std::string& x, const std::string& y,
+                          double log2Height);
+
+  const BigFloat& x() const;
+  const BigFloat& y() const;
+  double log2Height() const;
+  // May underflow to zero when deep
+  double height() const;
+  // May overflow to infinity when deep
+  double magnification() const;
+  double log10Magnification() const;
+  unsigned long precisionBits() const;
+
+  // With enough digits to place a pixel
+  std::string xString() const;
+  std::string yString() const;
+  // In scientific notation, however large
+  std::string magnificationString(int precision = 6) const;
+
+  // Moves the centre by dx and dy multiples of the view's height
+  void translate(double dx, double dy);
+  // The reverse: how far (x, y) is from the centre, in view heights
+  void offsetOf(const BigFloat& x, const BigFloat& y, double& dx,
+                double& dy) const;
+  // Shrinks the view by a factor of mag, keeping the centre
+  void zoom(double mag);
+
+  // Corners of the view for an aspect ratio of width / height. Only
+  // meaningful while the view is large enough for doubles.
+  void getBounds(double aspect, double& xmin, double& xmax, double& ymin,
+                 double& ymax) const;
+
+private:
+  void updatePrecision();
+
+  BigFloat m_x;
+  BigFloat m_y;
+  double m_log2Height;
+};
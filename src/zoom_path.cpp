@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include "zoom_path.hpp"
+
+// Heights closer than this in log2 are the same
+static const double SAME_HEIGHT = 1e-9;
+
+// Beyond this many doublings, 2^n - 1 rounds to 2^n
+static const double MAX_EXACT_DOUBLINGS = 64.0;
+// Beyond this many, 2^n overflows a double
+static const double MAX_DOUBLINGS = 1000.0;
+
+// 2^n - 1, accurate for small n
+static double exp2m1(double n) {
+  return std::expm1(n * std::log(2.0));
+}
+
+// How far a view 2^l times the height of the deeper of two views, which
+// are 2^L apart, has moved from the deeper one's centre to the other's:
+// (2^l - 1) / (2^L - 1)
+static double centreFraction(double l, double L) {
+  if (L <= MAX_EXACT_DOUBLINGS) {
+    return exp2m1(l) / exp2m1(L);
+  }
+  if (l <= MAX_DOUBLINGS) {
+    return exp2m1(l) * std::exp2(-L);
+  }
+
+  return std::exp2(l - L);
+}
+
+// The view a fraction u of the way from a to b
+static View between(const Keyframe& a, const Keyframe& b, double u) {
+  double log2H0 = a.view.log2Height();
+  double log2H1 = b.view.log2Height();
+  double log2Height = log2H0 + u * (log2H1 - log2H0);
+
+  // Offsets are taken from the deeper view, so they're never too small for
+  // a double
+  bool bDeeper = log2H1 <= log2H0;
+  const View& deep = bDeeper ? b.view : a.view;
+  const View& other = bDeeper ? a.view : b.view;
+  double L = other.log2Height() - deep.log2Height();
+
+  double f = 0.0;
+  if (L > SAME_HEIGHT) {
+    f = centreFraction(log2Height - deep.log2Height(), L);
+  }
+  else {
+    f = bDeeper ? 1.0 - u : u;
+  }
+
+  double dx = 0.0;
+  double dy = 0.0;
+  deep.offsetOf(other.x(), other.y(), dx, dy);
+
+  View view = deep;
+  view.translate(f * dx, f * dy);
+
+  return View(view.x(), view.y(), log2Height);
+}
+
+ZoomPath::ZoomPath(const std::vector<Keyframe>& keyframes)
+  : m_keyframes(keyframes) {
+
+  std::stable_sort(m_keyframes.begin(), m_keyframes.end(),
+                   [](const Keyframe& a, const Keyframe& b) {
+    return a.time < b.time;
+  });
+}
+
+const std::vector<Keyframe>& ZoomPath::keyframes() const {
+  return m_keyframes;
+}
+
+View ZoomPath::interpolate(double t) const {
+  size_t k = 0;
+  while (k + 2 < m_keyframes.size() && m_keyframes[k + 1].time < t) {
+    ++k;
+  }
+
+  const Keyframe& kf0 = m_keyframes[k];
+  const Keyframe& kf1 = m_keyframes[std::min(k + 1, m_keyframes.size() - 1)];
+
+  double u = 0.0;
+  if (kf1.time > kf0.time) {
+    u = std::max(0.0, std::min(1.0, (t - kf0.time) / (kf1.time - kf0.time)));
+  }
+
+  return between(kf0, kf1, u);
+}
+
+double ZoomPath::minLog2Height() const {
+  return deepest().view.log2Height();
+}
+
+double ZoomPath::maxLog2Height() const {
+  return shallowest().view.log2Height();
+}
+
+bool ZoomPath::zoomingIn() const {
+  return m_keyframes.back().view.log2Height() <=
+         m_keyframes.front().view.log2Height();
+}
+
+const Keyframe& ZoomPath::deepest() const {
+  return zoomingIn() ? m_keyframes.back() : m_keyframes.front();
+}
+
+const Keyframe& ZoomPath::shallowest() const {
+  return zoomingIn() ? m_keyframes.front() : m_keyframes.back();
+}
+
+bool ZoomPath::zoomsAboutFixedPoint(double tolerance) const {
+  const View& deep = deepest().view;
+  const View& shallow = shallowest().view;
+  double L = shallow.log2Height() - deep.log2Height();
+
+  double dx = 0.0;
+  double dy = 0.0;
+  deep.offsetOf(shallow.x(), shallow.y(), dx, dy);
+
+  // A pan, or a still shot if the centre doesn't move either
+  if (L <= SAME_HEIGHT) {
+    return m_keyframes.size() == 1 ||
+           (std::abs(dx) <= tolerance && std::abs(dy) <= tolerance);
+  }
+
+  bool in = zoomingIn();
+
+  for (size_t i = 0; i < m_keyframes.size(); ++i) {
+    const View& view = m_keyframes[i].view;
+
+    if (i > 0) {
+      double prev = m_keyframes[i - 1].view.log2Height();
+      if (in ? view.log2Height() > prev : view.log2Height() < prev) {
+        return false;
+      }
+    }
+
+    // Where the keyframe should be, in the deepest view's heights
+    double l = view.log2Height() - deep.log2Height();
+    double f = centreFraction(l, L);
+
+    double ox = 0.0;
+    double oy = 0.0;
+    deep.offsetOf(view.x(), view.y(), ox, oy);
+
+    double scale = std::exp2(-l);
+    if (std::abs(ox - f * dx) * scale > tolerance ||
+        std::abs(oy - f * dy) * scale > tolerance) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+View ZoomPath::viewAt(double log2Height) const {
+  const Keyframe& deep = deepest();
+  const Keyframe& shallow = shallowest();
+  double L = shallow.view.log2Height() - deep.view.log2Height();
+
+  if (L <= SAME_HEIGHT) {
+    const View& view = deep.view;
+    return View(view.x(), view.y(), log2Height);
+  }
+
+  // Extrapolated as far as it has to be, so there are keyframes a little
+  // deeper than the path goes
+  double u = (log2Height - shallow.view.log2Height()) / -L;
+  return between(shallow, deep, u);
+}
+
+void ZoomPath::fixedPoint(double& dx, double& dy) const {
+  const View& deep = deepest().view;
+  const View& shallow = shallowest().view;
+  double L = shallow.log2Height() - deep.log2Height();
+
+  dx = 0.0;
+  dy = 0.0;
+  if (L <= SAME_HEIGHT) {
+    return;
+  }
+
+  // The centre is at the fraction centreFraction(l, L) of the way from the
+  // deepest centre to the shallowest. That's linear in the height 2^l, so
+  // it reaches the fixed point where the height would be zero.
+  deep.offsetOf(shallow.x(), shallow.y(), dx, dy);
+
+  double k = L > MAX_EXACT_DOUBLINGS ? std::exp2(-L) : 1.0 / exp2m1(L);
+  dx *= -k;
+  dy *= -k;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "view.hpp"
+
+struct Keyframe {
+  double time;
+  View view;
+};
+
+// The views a zoom movie passes through, interpolated between keyframes.
+// There must be at least one keyframe.
+//
+// Between two keyframes the view zooms at a constant rate, and the centre
+// moves in proportion to the change in the view's height. Unless the two
+// are the same size, that's a zoom about a fixed point, which stays at the
+// same place in the frame all the way.
+class ZoomPath {
+public:
+  explicit ZoomPath(const std::vector<Keyframe>& keyframes);
+
+  // Sorted by time
+  const std::vector<Keyframe>& keyframes() const;
+
+  View interpolate(double t) const;
+
+  // Of the shallowest and deepest keyframes
+  double minLog2Height() const;
+  double maxLog2Height() const;
+  // True if the last keyframe is at least as deep as the first
+  bool zoomingIn() const;
+
+  // True if the magnification only changes one way, and the whole path is a
+  // zoom about one fixed point, with every keyframe's centre within
+  // tolerance of it in that keyframe's heights. Only then is every view on
+  // the path a crop of the deeper ones.
+  bool zoomsAboutFixedPoint(double tolerance) const;
+  // On such a path, the view 2^log2Height high
+  View viewAt(double log2Height) const;
+  // On such a path, where the fixed point is, in view heights from the
+  // centre
+  void fixedPoint(double& dx, double& dy) const;
+
+private:
+  const Keyframe& deepest() const;
+  const Keyframe& shallowest() const;
+
+  std::vector<Keyframe> m_keyframes;
+};
@@ -0,0 +1,72 @@
+// Writes program binaries in the shader cache's file layout and reads them
+// back, along with files that should be rejected. Exits with a non-zero
+// status if any check fails.
+//
+// Usage: mandelbrot-program-binary-test [scratch file path]
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "program_binary.hpp"
+
+using std::string;
+
+static bool check(bool ok, const string& name) {
+  std::cout << (ok ? "PASS  " : "FAIL  ") << name << std::endl;
+  return ok;
+}
+
+// Writes the first n bytes of what writeProgramBinary wrote to path
+static void truncate(const string& path, size_t n) {
+  std::vector<char> bytes;
+  {
+    std::ifstream fin(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(fin),
+                 std::istreambuf_iterator<char>());
+  }
+
+  std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+  fout.write(bytes.data(), std::min(n, bytes.size()));
+}
+
+int main(int argc, char** argv) {
+  string path = argc > 1 ? argv[1] : "program_binary_test.bin";
+  bool passed = true;
+
+  std::vector<char> binary;
+  for (int i = 0; i < 1000; ++i) {
+    binary.push_back(static_cast<char>(i * 7));
+  }
+  const uint32_t FORMAT = 0x8e7d;
+
+  uint32_t format = 0;
+  std::vector<char> read;
+
+  passed &= check(writeProgramBinary(path, FORMAT, binary), "write");
+  passed &= check(readProgramBinary(path, format, read) &&
+                    format == FORMAT && read == binary,
+                  "read back");
+
+  // Only the magic number and part of the format
+  truncate(path, 6);
+  passed &= check(!readProgramBinary(path, format, read), "short header");
+
+  truncate(path, 8);
+  passed &= check(!readProgramBinary(path, format, read), "empty binary");
+
+  {
+    std::ofstream fout(path, std::ios::binary | std::ios::trunc);
+    fout << "not a program binary";
+  }
+  passed &= check(!readProgramBinary(path, format, read), "wrong magic");
+
+  std::remove(path.c_str());
+  passed &= check(!readProgramBinary(path, format, read), "missing file");
+
+  std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <gmp.h>
+#include "reference_engine.hpp"
+
+// Same bailout as the other engines, so iteration counts are comparable
+static const double RADIUS = 10000.0;
+
+// Extra bits on top of those needed to resolve a pixel
+static const unsigned long GUARD_BITS = 64;
+
+namespace {
+
+// Working variables for one thread, allocated once per row
+class PointTester {
+public:
+  explicit PointTester(unsigned long bits) {
+    mpf_t* vars[] = { &m_x0, &m_y0, &m_x, &m_y, &m_xx, &m_yy, &m_xy, &m_r };
+    for (mpf_t* v : vars) {
+      mpf_init2(*v, bits);
+    }
+  }
+
+  ~PointTester() {
+    mpf_t* vars[] = { &m_x0, &m_y0, &m_x, &m_y, &m_xx, &m_yy, &m_xy, &m_r };
+    for (mpf_t* v : vars) {
+      mpf_clear(*v);
+    }
+  }
+
+  PointTester(const PointTester&) = delete;
+  PointTester& operator=(const PointTester&) = delete;
+
+  // Same recurrence as the shader: z starts at c and the count is the
+  // number of steps taken before |z|^2 exceeds the bailout
+  PixelResult test(const mpf_t x0, const mpf_t y0, int maxI) {
+    mpf_set(m_x0, x0);
+    mpf_set(m_y0, y0);
+    mpf_set(m_x, x0);
+    mpf_set(m_y, y0);
+
+    int i = 0;
+    for (; i < maxI; ++i) {
+      mpf_mul(m_xx, m_x, m_x);
+      mpf_mul(m_yy, m_y, m_y);
+      mpf_mul(m_xy, m_x, m_y);
+
+      mpf_sub(m_x, m_xx, m_yy);
+      mpf_add(m_x, m_x, m_x0);
+      mpf_mul_2exp(m_y, m_xy, 1);
+      mpf_add(m_y, m_y, m_y0);
+
+      mpf_mul(m_xx, m_x, m_x);
+      mpf_mul(m_yy, m_y, m_y);
+      mpf_add(m_r, m_xx, m_yy);
+
+      if (mpf_get_d(m_r) > RADIUS) {
+        break;
+      }
+    }
+
+    return PixelResult{static_cast<float>(i),
+                       static_cast<float>(mpf_get_d(m_x)),
+                       static_cast<float>(mpf_get_d(m_y))};
+  }
+
+private:
+  mpf_t m_x0;
+  mpf_t m_y0;
+  mpf_t m_x;
+  mpf_t m_y;
+  mpf_t m_xx;
+  mpf_t m_yy;
+  mpf_t m_xy;
+  mpf_t m_r;
+};
+
+}
+
+ReferenceEngine::ReferenceEngine(unsigned int numThreads)
+  : m_threads(numThreads) {}
+
+unsigned long ReferenceEngine::precision(const IterationParams& params) {
+  double pixelSize = std::min((params.xmax - params.xmin) / params.w,
+                              (params.ymax - params.ymin) / params.h);
+
+  double bits = std::max(0.0, -std::log2(pixelSize));
+  return GUARD_BITS + static_cast<unsigned long>(std::ceil(bits));
+}
+
+void ReferenceEngine::render(const IterationParams& params,
+                             IterationData& data) {
+  if (data.w != params.w || data.h != params.h) {
+    data = IterationData(params.w, params.h);
+  }
+  data.maxIterations = params.maxIterations;
+
+  unsigned long bits = precision(params);
+  std::atomic<int> nextRow(0);
+
+  auto renderRows = [&]() {
+    PointTester tester(bits);
+
+    mpf_t xmin, ymin, xScale, yScale, x, y;
+    mpf_t* vars[] = { &xmin, &ymin, &xScale, &yScale, &x, &y };
+    for (mpf_t* v : vars) {
+      mpf_init2(*v, bits);
+    }
+
+    // Pixel centres are computed in full precision from the view bounds
+    mpf_set_d(xmin, params.xmin);
+    mpf_set_d(ymin, params.ymin);
+    mpf_set_d(xScale, params.xmax);
+    mpf_sub(xScale, xScale, xmin);
+    mpf_div_ui(xScale, xScale, params.w);
+    mpf_set_d(yScale, params.ymax);
+    mpf_sub(yScale, yScale, ymin);
+    mpf_div_ui(yScale, yScale, params.h);
+
+    int row = 0;
+    while ((row = nextRow++) < params.h) {
+      mpf_set_d(y, row + 0.5);
+      mpf_mul(y, y, yScale);
+      mpf_add(y, y, ymin);
+
+      PixelResult* dst = data.pixels.data() + row * params.w;
+
+      for (int col = 0; col < params.w; ++col) {
+        mpf_set_d(x, col + 0.5);
+        mpf_mul(x, x, xScale);
+        mpf_add(x, x, xmin);
+
+        dst[col] = tester.test(x, y, params.maxIterations);
+      }
+    }
+
+    for (mpf_t* v : vars) {
+      mpf_clear(*v);
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  for (unsigned int i = 0; i < m_threads.numThreads(); ++i) {
+    tasks.push_back(m_threads.run(renderRows));
+  }
+
+  for (auto& task : tasks) {
+    task.get();
+  }
+}
+
+void ReferenceEngine::render(const PerturbationParams& params,
+                             IterationData& data) {
+  if (data.w != params.w || data.h != params.h) {
+    data = IterationData(params.w, params.h);
+  }
+  data.maxIterations = params.maxIterations;
+
+  unsigned long bits = params.view.precisionBits() + GUARD_BITS;
+  std::atomic<int> nextRow(0);
+
+  auto renderRows = [&]() {
+    PointTester tester(bits);
+
+    int row = 0;
+    while ((row = nextRow++) < params.h) {
+      PixelResult* dst = data.pixels.data() + row * params.w;
+
+      for (int col = 0; col < params.w; ++col) {
+        View pixel = params.view;
+        pixel.translate((col + 0.5 - 0.5 * params.w) / params.h,
+                        (row + 0.5 - 0.5 * params.h) / params.h);
+
+        BigFloat x(pixel.x());
+        BigFloat y(pixel.y());
+        x.setPrecision(bits);
+        y.setPrecision(bits);
+
+        dst[col] = tester.test(x.get(), y.get(), params.maxIterations);
+      }
+    }
+  };
+
+  std::vector<std::future<void>> tasks;
+  for (unsigned int i = 0; i < m_threads.numThreads(); ++i) {
+    tasks.push_back(m_threads.run(renderRows));
+  }
+
+  for (auto& task : tasks) {
+    task.get();
+  }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "iteration_data.hpp"
+#include "thread_pool.hpp"
+#include "perturbation_engine.hpp"
+
+// Computes escape-time data with GMP floats, at a precision that grows with
+// the magnification so rounding never affects the result. Far too slow for
+// interactive use; it's the trusted baseline the fast engines are checked
+// against.
+class ReferenceEngine {
+public:
+  explicit ReferenceEngine(unsigned int numThreads = 0);
+
+  void render(const IterationParams& params, IterationData& data);
+  // For views too deep for doubles. Pixel centres are offset from the view's
+  // centre in the same way as in PerturbationEngine.
+  void render(const PerturbationParams& params, IterationData& data);
+
+  // Bits of mantissa used for the given view
+  static unsigned long precision(const IterationParams& params);
+
+private:
+  ThreadPool m_threads;
+};
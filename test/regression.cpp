@@ -0,0 +1,319 @@
+// Renders each reference location with the high precision reference engine
+// and with every fast headless engine, and compares iteration counts pixel
+// by pixel. The deep locations are compared in the same way against the
+// perturbation engine. Exits with a non-zero status if any engine's mismatch
+// rate at any location exceeds the bound, or any deep pixel's difference
+// does.
+//
+// Usage: mandelbrot-regression [--size 128x96] [--max-iterations 512]
+//                              [--tolerance 1] [--max-mismatch 0.5]
+//                              [--deep-size 64x48] [--max-deep-mismatch 1]
+//                              [--max-deep-diff 5]
+//                              [--engines NAME,...] [--locations NAME,...]
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "engines.hpp"
+#include "reference_locations.hpp"
+#include "reference_engine.hpp"
+
+using std::string;
+
+// In view heights
+static const double DEEP_PAN = 0.1;
+
+struct Options {
+  int w = 128;
+  int h = 96;
+  int maxIterations = 512;
+  // Iteration counts differing by at most this much aren't mismatches
+  int tolerance = 1;
+  // Percentage of mismatched pixels allowed per location
+  double maxMismatch = 0.5;
+  // Deep views are rendered small, as the reference engine is very slow
+  // there
+  int deepW = 64;
+  int deepH = 48;
+  // Deep pixels near the set take thousands of iterations to escape, which
+  // magnifies any rounding, so a few more are allowed to differ. Some of
+  // those differ by hundreds of iterations even in extended precision.
+  double maxDeepMismatch = 1.0;
+  // Largest difference allowed in any deep pixel, as a percentage of the
+  // iteration limit
+  double maxDeepDiff = 5.0;
+  std::vector<string> engines;
+  std::vector<string> locations;
+};
+
+struct Comparison {
+  size_t pixels = 0;
+  size_t exact = 0;
+  size_t withinTolerance = 0;
+  // Pixels that escaped in one render but not the other
+  size_t escapeMismatches = 0;
+  size_t mismatches = 0;
+  int maxDiff = 0;
+  double meanAbsDiff = 0.0;
+
+  double mismatchPercent() const {
+    return pixels > 0 ? 100.0 * mismatches / pixels : 0.0;
+  }
+};
+
+static std::vector<string> split(const string& str, char delim) {
+  std::vector<string> parts;
+  std::stringstream ss(str);
+  string part;
+
+  while (std::getline(ss, part, delim)) {
+    if (!part.empty()) {
+      parts.push_back(part);
+    }
+  }
+
+  return parts;
+}
+
+static bool contains(const std::vector<string>& v, const string& s) {
+  return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+static void usage() {
+  std::cerr << "Usage: mandelbrot-regression [--size WxH] "
+               "[--max-iterations N] [--tolerance N] [--max-mismatch PERCENT] "
+               "[--deep-size WxH] [--max-deep-mismatch PERCENT] "
+               "[--max-deep-diff PERCENT] "
+               "[--engines NAME,...] [--locations NAME,...]" << std::endl;
+}
+
+static bool parseArgs(int argc, char** argv, Options& opts) {
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+
+    if (i + 1 >= argc) {
+      return false;
+    }
+    string value = argv[++i];
+
+    if (arg == "--size") {
+      auto dims = split(value, 'x');
+      if (dims.size() != 2) {
+        return false;
+      }
+      opts.w = std::stoi(dims[0]);
+      opts.h = std::stoi(dims[1]);
+    }
+    else if (arg == "--max-iterations") {
+      opts.maxIterations = std::stoi(value);
+    }
+    else if (arg == "--tolerance") {
+      opts.tolerance = std::stoi(value);
+    }
+    else if (arg == "--max-mismatch") {
+      opts.maxMismatch = std::stod(value);
+    }
+    else if (arg == "--deep-size") {
+      auto dims = split(value, 'x');
+      if (dims.size() != 2) {
+        return false;
+      }
+      opts.deepW = std::stoi(dims[0]);
+      opts.deepH = std::stoi(dims[1]);
+    }
+    else if (arg == "--max-deep-mismatch") {
+      opts.maxDeepMismatch = std::stod(value);
+    }
+    else if (arg == "--max-deep-diff") {
+      opts.maxDeepDiff = std::stod(value);
+    }
+    else if (arg == "--engines") {
+      opts.engines = split(value, ',');
+    }
+    else if (arg == "--locations") {
+      opts.locations = split(value, ',');
+    }
+    else {
+      return false;
+    }
+  }
+
+  return opts.w > 0 && opts.h > 0 && opts.maxIterations > 0 &&
+         opts.deepW > 0 && opts.deepH > 0;
+}
+
+static Comparison compare(const IterationData& reference,
+                          const IterationData& data, int tolerance) {
+  Comparison c;
+  c.pixels = reference.pixels.size();
+
+  double totalDiff = 0.0;
+
+  for (size_t i = 0; i < c.pixels; ++i) {
+    int refI = static_cast<int>(reference.pixels[i].i);
+    int dataI = static_cast<int>(data.pixels[i].i);
+    int diff = std::abs(refI - dataI);
+
+    bool refEscaped = refI < reference.maxIterations;
+    bool dataEscaped = dataI < data.maxIterations;
+
+    totalDiff += diff;
+    c.maxDiff = std::max(c.maxDiff, diff);
+
+    if (refEscaped != dataEscaped) {
+      ++c.escapeMismatches;
+      ++c.mismatches;
+    }
+    else if (diff == 0) {
+      ++c.exact;
+    }
+    else if (diff <= tolerance) {
+      ++c.withinTolerance;
+    }
+    else {
+      ++c.mismatches;
+    }
+  }
+
+  c.meanAbsDiff = c.pixels > 0 ? totalDiff / c.pixels : 0.0;
+
+  return c;
+}
+
+// Written ahead of any notes or FAIL marker, which end the line
+static void printRow(const string& location, const string& engine,
+                     const Comparison& c) {
+  std::cout << std::left << std::setw(20) << location
+            << std::setw(20) << engine << std::right
+            << std::setw(10) << 100.0 * c.exact / c.pixels
+            << std::setw(10) << 100.0 * c.withinTolerance / c.pixels
+            << std::setw(10) << c.escapeMismatches
+            << std::setw(10) << c.maxDiff
+            << std::setw(10) << c.meanAbsDiff
+            << std::setw(12) << c.mismatchPercent();
+}
+
+int main(int argc, char** argv) {
+  Options opts;
+  bool validArgs = false;
+
+  try {
+    validArgs = parseArgs(argc, argv, opts);
+  }
+  catch (const std::exception&) {}
+
+  if (!validArgs) {
+    usage();
+    return 2;
+  }
+
+  std::vector<Engine> engines;
+  for (const Engine& engine : headlessEngines()) {
+    if (!engine.matchesReference) {
+      continue;
+    }
+
+    if (opts.engines.empty() || contains(opts.engines, engine.name)) {
+      engines.push_back(engine);
+    }
+  }
+
+  ReferenceEngine referenceEngine;
+  bool passed = true;
+
+  std::cout << std::left << std::setw(20) << "location"
+            << std::setw(20) << "engine" << std::right
+            << std::setw(10) << "exact%"
+            << std::setw(10) << "within%"
+            << std::setw(10) << "escape"
+            << std::setw(10) << "max diff"
+            << std::setw(10) << "mean diff"
+            << std::setw(12) << "mismatch%" << std::endl;
+
+  std::cout << std::fixed << std::setprecision(3);
+
+  for (const ReferenceLocation& loc : REFERENCE_LOCATIONS) {
+    if (!opts.locations.empty() && !contains(opts.locations, loc.name)) {
+      continue;
+    }
+
+    IterationParams params = referenceParams(loc, opts.w, opts.h,
+                                             opts.maxIterations);
+
+    IterationData reference;
+    referenceEngine.render(params, reference);
+
+    for (const Engine& engine : engines) {
+      IterationData data;
+      engine.render(params, data);
+
+      Comparison c = compare(reference, data, opts.tolerance);
+      bool ok = c.mismatchPercent() <= opts.maxMismatch;
+      passed = passed && ok;
+
+      printRow(loc.name, engine.name, c);
+      std::cout << (ok ? "" : "  FAIL") << std::endl;
+    }
+  }
+
+  std::vector<DeepEngine> deep;
+  for (const DeepEngine& engine : deepEngines()) {
+    if (opts.engines.empty() || contains(opts.engines, engine.name)) {
+      deep.push_back(engine);
+    }
+  }
+
+  for (const DeepLocation& loc : DEEP_LOCATIONS) {
+    if (deep.empty()) {
+      break;
+    }
+    if (!opts.locations.empty() && !contains(opts.locations, loc.name)) {
+      continue;
+    }
+
+    PerturbationParams params = deepParams(loc, opts.deepW, opts.deepH);
+
+    IterationData reference;
+    referenceEngine.render(params, reference);
+
+    // Engines that keep references between renders should reuse the one
+    // from this view, as they would while panning
+    PerturbationParams panned = params;
+    panned.view.translate(DEEP_PAN, DEEP_PAN);
+
+    for (const DeepEngine& engine : deep) {
+      IterationData data;
+      engine.render(panned, data);
+
+      PerturbationEngine::Stats stats = engine.render(params, data);
+
+      Comparison c = compare(reference, data, opts.tolerance);
+      bool ok = c.mismatchPercent() <= opts.maxDeepMismatch &&
+                c.maxDiff <= opts.maxDeepDiff / 100.0 * params.maxIterations;
+      passed = passed && ok;
+
+      printRow(loc.name, engine.name, c);
+      std::cout << "  " << stats.references << " refs, "
+                << stats.glitchedPixels << " glitched";
+      if (stats.period > 0) {
+        std::cout << ", period " << stats.period;
+      }
+      if (stats.reusedReference) {
+        std::cout << ", reused";
+      }
+      std::cout << (ok ? "" : "  FAIL") << std::endl;
+    }
+  }
+
+  std::cout << (passed ? "PASSED" : "FAILED") << " (tolerance "
+            << opts.tolerance << " iterations, max mismatch "
+            << opts.maxMismatch << "%, " << opts.maxDeepMismatch
+            << "% deep, max deep diff " << opts.maxDeepDiff << "%)"
+            << std::endl;
+
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+// Checks how zoom movie paths are interpolated, and which of them are zooms
+// about a fixed point that video frames can be synthesised for. Exits with a
+// non-zero status if any check fails.
+//
+// Usage: mandelbrot-zoom-path-test
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "zoom_path.hpp"
+
+using std::string;
+
+// In view heights, about a pixel of a 1080p frame
+static const double TOLERANCE = 1e-3;
+
+static const char* DEEP_X =
+  "-1.7490441470846436952532512932152418643622938785443102741052";
+static const char* DEEP_Y =
+  "0.0000000000000000000000000000000012683941219876324167384234";
+
+static bool check(bool ok, const string& name) {
+  std::cout << (ok ? "PASS  " : "FAIL  ") << name << std::endl;
+  return ok;
+}
+
+static View view(const string& x, const string& y, const string& mag) {
+  return View::fromStrings(x, y, mag);
+}
+
+// True if b is within tol of a, in a's heights, and the same size
+static bool sameView(const View& a, const View& b, double tol) {
+  double dx = 0.0;
+  double dy = 0.0;
+  a.offsetOf(b.x(), b.y(), dx, dy);
+
+  return std::abs(dx) <= tol && std::abs(dy) <= tol &&
+         std::abs(a.log2Height() - b.log2Height()) <= 1e-9;
+}
+
+// Checks that the point at offset (ux, uy) from the centre of frame, in its
+// heights, is where synthesis takes it from in keyframe
+static bool cropsTo(const ZoomPath& path, const View& frame,
+                    const View& keyframe, double ux, double uy) {
+  double fx = 0.0;
+  double fy = 0.0;
+  path.fixedPoint(fx, fy);
+
+  double r = std::exp2(keyframe.log2Height() - frame.log2Height());
+
+  View point = frame;
+  point.translate(ux, uy);
+
+  double kx = 0.0;
+  double ky = 0.0;
+  keyframe.offsetOf(point.x(), point.y(), kx, ky);
+
+  return std::abs(kx - ((ux - fx) / r + fx)) <= TOLERANCE &&
+         std::abs(ky - ((uy - fy) / r + fy)) <= TOLERANCE;
+}
+
+int main() {
+  bool passed = true;
+
+  // Same size, so the centre moves at a constant rate
+  ZoomPath pan({ Keyframe{0.0, view("-0.5", "0", "10")},
+                 Keyframe{10.0, view("0.5", "0.25", "10")} });
+  passed &= check(!pan.zoomsAboutFixedPoint(TOLERANCE),
+                  "pan isn't a zoom");
+  passed &= check(sameView(pan.interpolate(5.0), view("0", "0.125", "10"),
+                           TOLERANCE),
+                  "pan passes through the midpoint");
+
+  ZoomPath still({ Keyframe{0.0, view("-0.75", "0.1", "10")},
+                   Keyframe{10.0, view("-0.75", "0.1", "10")} });
+  passed &= check(still.zoomsAboutFixedPoint(TOLERANCE),
+                  "still shot can be synthesised");
+
+  ZoomPath zoomIn({ Keyframe{0.0, view("-0.75", "0.1", "1")},
+                    Keyframe{10.0, view("-0.75", "0.1", "1e6")} });
+  passed &= check(zoomIn.zoomsAboutFixedPoint(TOLERANCE),
+                  "zoom into the centre is a zoom");
+  passed &= check(zoomIn.zoomingIn(), "zoom in is zooming in");
+  passed &= check(sameView(zoomIn.interpolate(5.0),
+                           view("-0.75", "0.1", "1e3"), TOLERANCE),
+                  "zoom in is at a constant rate");
+
+  // From the whole set to somewhere deep, as from the default view to a
+  // saved location
+  View start;
+  View end = view(DEEP_X, DEEP_Y, "1e40");
+  ZoomPath deep({ Keyframe{0.0, start}, Keyframe{20.0, end} });
+  passed &= check(deep.zoomsAboutFixedPoint(TOLERANCE),
+                  "zoom to another centre is a zoom");
+  passed &= check(sameView(deep.interpolate(0.0), start, TOLERANCE) &&
+                    sameView(deep.interpolate(20.0), end, TOLERANCE),
+                  "deep zoom starts and ends at its keyframes");
+
+  bool followsPath = true;
+  bool crops = true;
+  for (double t = 0.5; t < 20.0; t += 1.5) {
+    View frame = deep.interpolate(t);
+    followsPath &= sameView(frame, deep.viewAt(frame.log2Height()),
+                            TOLERANCE);
+
+    // The keyframes bracketing it, as synthesis takes them
+    double k = std::floor(deep.maxLog2Height() - frame.log2Height());
+    View outer = deep.viewAt(deep.maxLog2Height() - k);
+    View inner = deep.viewAt(deep.maxLog2Height() - k - 1.0);
+
+    for (double u : { -0.8, -0.25, 0.0, 0.3, 0.8 }) {
+      crops &= cropsTo(deep, frame, outer, u, 0.4 * u);
+      crops &= cropsTo(deep, frame, inner, 0.5 * u, -u);
+    }
+  }
+  passed &= check(followsPath, "deep zoom frames are on the fixed point "
+                               "path");
+  passed &= check(crops, "deep zoom frames are crops of their keyframes");
+
+  // Given out of order
+  ZoomPath zoomOut({ Keyframe{10.0, view("-0.75", "0.1", "1")},
+                     Keyframe{0.0, view("-0.75", "0.1", "1e6")} });
+  passed &= check(zoomOut.zoomsAboutFixedPoint(TOLERANCE),
+                  "zoom out is a zoom");
+  passed &= check(!zoomOut.zoomingIn(), "zoom out is zooming out");
+  passed &= check(zoomOut.keyframes().front().time == 0.0,
+                  "keyframes are sorted");
+
+  // Starts and ends at the same point, but goes somewhere else between
+  ZoomPath detour({ Keyframe{0.0, view("-0.75", "0.1", "1")},
+                    Keyframe{5.0, view("0.25", "0", "1e2")},
+                    Keyframe{10.0, view("-0.75", "0.1", "1e6")} });
+  passed &= check(!detour.zoomsAboutFixedPoint(TOLERANCE),
+                  "detour through another centre isn't a zoom");
+
+  ZoomPath inAndOut({ Keyframe{0.0, view("-0.75", "0.1", "1")},
+                      Keyframe{5.0, view("-0.75", "0.1", "1e6")},
+                      Keyframe{10.0, view("-0.75", "0.1", "1e2")} });
+  passed &= check(!inAndOut.zoomsAboutFixedPoint(TOLERANCE),
+                  "zoom in then out isn't a zoom");
+
+  std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}